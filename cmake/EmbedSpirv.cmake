@@ -0,0 +1,30 @@
+# Writes the SPIR-V module SPIRV to HEADER as a constexpr uint32_t array named NAME.
+# Run with cmake -P; SPIR-V words are little-endian in the file.
+
+file(READ ${SPIRV} HEX HEX)
+string(LENGTH "${HEX}" LENGTH)
+math(EXPR REMAINDER "${LENGTH} % 8")
+if(LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${SPIRV} is not a whole number of SPIR-V words")
+endif()
+
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " WORDS "${HEX}")
+# Eight words to a line; CMake regexes have no {n}.
+set(LINE "")
+foreach(I RANGE 1 8)
+    string(APPEND LINE "0x[0-9a-f]+, ")
+endforeach()
+string(REGEX REPLACE "(${LINE})" "\\1\n    " WORDS "${WORDS}")
+string(REPLACE " \n" "\n" WORDS "${WORDS}")
+string(REGEX REPLACE "[ \n]+$" "" WORDS "${WORDS}")
+get_filename_component(SOURCE ${SPIRV} NAME)
+
+file(WRITE ${HEADER} "// Generated from ${SOURCE} by cmake/EmbedSpirv.cmake.
+#pragma once
+
+#include <cstdint>
+
+inline constexpr uint32_t ${NAME}[] = {
+    ${WORDS}
+};
+")
@@ -0,0 +1,225 @@
+#include "BenchHarness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+
+namespace {
+
+volatile uint64_t gSink = 0;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double sortedPercentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const double rank = p * static_cast<double>(sorted.size() - 1);
+    const size_t below = static_cast<size_t>(rank);
+    const size_t above = std::min(below + 1, sorted.size() - 1);
+    return sorted[below] + (sorted[above] - sorted[below]) * (rank - static_cast<double>(below));
+}
+
+void writeString(std::FILE* out, const std::string& value) {
+    std::fputc('"', out);
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            std::fputc('\\', out);
+            std::fputc(c, out);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            std::fprintf(out, "\\u%04x", c);
+        } else {
+            std::fputc(c, out);
+        }
+    }
+    std::fputc('"', out);
+}
+
+}
+
+void BenchHarness::consume(uint64_t value) {
+    gSink = gSink + value;
+}
+
+BenchHarness::Summary BenchHarness::summarize(const std::vector<double>& samplesMs, size_t items) {
+    Summary summary;
+    if (samplesMs.empty()) {
+        return summary;
+    }
+    std::vector<double> sorted = samplesMs;
+    std::sort(sorted.begin(), sorted.end());
+    const auto count = static_cast<double>(sorted.size());
+    summary.minMs = sorted.front();
+    summary.maxMs = sorted.back();
+    for (double ms : sorted) {
+        summary.meanMs += ms;
+    }
+    summary.meanMs /= count;
+    summary.medianMs = sortedPercentile(sorted, 0.5);
+    summary.p90Ms = sortedPercentile(sorted, 0.9);
+    if (sorted.size() > 1) {
+        double variance = 0.0;
+        for (double ms : sorted) {
+            variance += (ms - summary.meanMs) * (ms - summary.meanMs);
+        }
+        summary.stddevMs = std::sqrt(variance / (count - 1.0));
+        summary.ci95Ms = 1.96 * summary.stddevMs / std::sqrt(count);
+    }
+    if (items > 0 && summary.medianMs > 0.0) {
+        summary.nsPerItem = summary.medianMs * 1e6 / static_cast<double>(items);
+        summary.itemsPerSecond = static_cast<double>(items) * 1000.0 / summary.medianMs;
+    }
+    return summary;
+}
+
+double BenchHarness::percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    return sortedPercentile(values, p);
+}
+
+bool BenchHarness::shouldRun(const std::string& name, const char* kind) const {
+    if (!mOptions.filter.empty() && name.find(mOptions.filter) == std::string::npos) {
+        return false;
+    }
+    if (mOptions.listOnly) {
+        std::printf("%s (%s)\n", name.c_str(), kind);
+        return false;
+    }
+    return true;
+}
+
+void BenchHarness::record(Result result) {
+    result.summary = summarize(result.samplesMs, result.items);
+    std::fprintf(stderr, "%-28s median %9.3f ms  p90 %9.3f ms  max %9.3f ms\n", result.name.c_str(), result.summary.medianMs,
+        result.summary.p90Ms, result.summary.maxMs);
+    mResults.push_back(std::move(result));
+}
+
+void BenchHarness::run(const std::string& name, const char* kind, const char* unit, const Setup& setup) {
+    if (!shouldRun(name, kind)) {
+        return;
+    }
+    // Progress goes to stderr so stdout stays valid JSON.
+    std::fprintf(stderr, "%-28s", name.c_str());
+    std::fflush(stderr);
+    const Body body = setup();
+    for (int i = 0; i < mOptions.warmup; i++) {
+        body();
+    }
+
+    Result result;
+    result.name = name;
+    result.kind = kind;
+    result.unit = unit;
+    for (int i = 0; i < mOptions.repetitions; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t items = body();
+        result.samplesMs.push_back(millisecondsSince(start));
+        // Every repetition does the same work; a body that varies reports its first count.
+        if (i == 0) {
+            result.items = items;
+        }
+    }
+    result.summary = summarize(result.samplesMs, result.items);
+    std::fprintf(stderr, " median %9.3f ms  +-%7.3f ms  %10.1f ns/%s\n", result.summary.medianMs, result.summary.ci95Ms,
+        result.summary.nsPerItem, unit);
+    mResults.push_back(std::move(result));
+}
+
+void BenchHarness::writeJson(std::FILE* out, unsigned workerThreads) const {
+    std::fprintf(out, "{\n  \"schema\": \"minecraft_bench/1\",\n");
+#ifdef NDEBUG
+    std::fprintf(out, "  \"optimized\": true,\n");
+#else
+    std::fprintf(out, "  \"optimized\": false,\n");
+#endif
+    std::fprintf(out, "  \"worker_threads\": %u,\n  \"warmup\": %d,\n  \"repetitions\": %d,\n  \"benchmarks\": [",
+        workerThreads, mOptions.warmup, mOptions.repetitions);
+    for (size_t i = 0; i < mResults.size(); i++) {
+        const Result& result = mResults[i];
+        const Summary& s = result.summary;
+        std::fprintf(out, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+        writeString(out, result.name);
+        std::fprintf(out, ", \"kind\": ");
+        writeString(out, result.kind);
+        std::fprintf(out, ", \"unit\": ");
+        writeString(out, result.unit);
+        std::fprintf(out, ", \"items\": %zu,\n     \"samples_ms\": [", result.items);
+        for (size_t j = 0; j < result.samplesMs.size(); j++) {
+            std::fprintf(out, "%s%.6f", j == 0 ? "" : ", ", result.samplesMs[j]);
+        }
+        std::fprintf(out, "],\n     \"min_ms\": %.6f, \"max_ms\": %.6f, \"mean_ms\": %.6f, \"median_ms\": %.6f, \"p90_ms\": %.6f,"
+            " \"stddev_ms\": %.6f, \"ci95_ms\": %.6f, \"ns_per_item\": %.3f, \"items_per_second\": %.1f",
+            s.minMs, s.maxMs, s.meanMs, s.medianMs, s.p90Ms, s.stddevMs, s.ci95Ms, s.nsPerItem, s.itemsPerSecond);
+        if (!result.metrics.empty()) {
+            std::fprintf(out, ",\n     \"metrics\": {");
+            for (size_t j = 0; j < result.metrics.size(); j++) {
+                std::fprintf(out, "%s", j == 0 ? "" : ", ");
+                writeString(out, result.metrics[j].first);
+                std::fprintf(out, ": %.6f", result.metrics[j].second);
+            }
+            std::fprintf(out, "}");
+        }
+        std::fprintf(out, "}");
+    }
+    std::fprintf(out, "\n  ]\n}\n");
+}
+
+int BenchHarness::compareToBaseline(const std::string& path, double threshold) const {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return -1;
+    }
+    std::string json;
+    char buffer[4096];
+    for (size_t read; (read = std::fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+        json.append(buffer, read);
+    }
+    std::fclose(file);
+    if (json.find("\"schema\": \"minecraft_bench/1\"") == std::string::npos) {
+        return -1;
+    }
+
+    // Only reads what writeJson() writes: each benchmark's name comes before its median, and
+    // its median before its confidence interval.
+    struct Entry {
+        double medianMs;
+        double ci95Ms;
+    };
+    std::map<std::string, Entry> baseline;
+    const std::string nameKey = "{\"name\": \"";
+    const std::string medianKey = "\"median_ms\": ";
+    const std::string ciKey = "\"ci95_ms\": ";
+    for (size_t at = json.find(nameKey); at != std::string::npos; at = json.find(nameKey, at)) {
+        at += nameKey.size();
+        const size_t nameEnd = json.find('"', at);
+        const size_t median = json.find(medianKey, nameEnd);
+        const size_t ci = json.find(ciKey, median);
+        if (nameEnd == std::string::npos || ci == std::string::npos) {
+            break;
+        }
+        baseline[json.substr(at, nameEnd - at)] = {std::strtod(json.c_str() + median + medianKey.size(), nullptr),
+                                                   std::strtod(json.c_str() + ci + ciKey.size(), nullptr)};
+    }
+
+    int regressions = 0;
+    for (const Result& result : mResults) {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end() || it->second.medianMs <= 0.0) {
+            std::fprintf(stderr, "%-28s not in baseline\n", result.name.c_str());
+            continue;
+        }
+        const Entry& before = it->second;
+        const double change = result.summary.medianMs / before.medianMs - 1.0;
+        // A slowdown inside both runs' noise isn't reported, however large it looks.
+        const bool regressed = change > threshold && result.summary.medianMs - before.medianMs > result.summary.ci95Ms + before.ci95Ms;
+        regressions += regressed ? 1 : 0;
+        std::fprintf(stderr, "%-28s %9.3f ms -> %9.3f ms  %+6.1f%%%s\n", result.name.c_str(), before.medianMs, result.summary.medianMs,
+            100.0 * change, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runs named benchmarks with warmup and repetitions and reports every sample plus summary
+// statistics as JSON, so runs can be diffed and tracked by scripts rather than read off a log.
+class BenchHarness {
+    public:
+        struct Options {
+            int warmup = 2;
+            int repetitions = 10;
+            // Only benchmarks whose name contains this run; empty runs everything.
+            std::string filter;
+            bool listOnly = false;
+        };
+
+        struct Summary {
+            double minMs = 0.0;
+            double maxMs = 0.0;
+            double meanMs = 0.0;
+            double medianMs = 0.0;
+            double p90Ms = 0.0;
+            double stddevMs = 0.0;
+            // Half-width of the 95% confidence interval of the mean.
+            double ci95Ms = 0.0;
+            // From the median repetition.
+            double nsPerItem = 0.0;
+            double itemsPerSecond = 0.0;
+        };
+
+        struct Result {
+            std::string name;
+            // "micro" times one operation in a tight loop; "macro" times a whole subsystem.
+            std::string kind;
+            // What one item is, for nsPerItem.
+            std::string unit;
+            size_t items = 0;
+            std::vector<double> samplesMs;
+            Summary summary;
+            // Anything else the benchmark measured, written as-is.
+            std::vector<std::pair<std::string, double>> metrics;
+        };
+
+        // One repetition; returns how many items it processed.
+        using Body = std::function<size_t()>;
+        // Builds the benchmark's inputs and returns its body. Only called when the benchmark runs.
+        using Setup = std::function<Body()>;
+
+        explicit BenchHarness(Options options) : mOptions(std::move(options)) {}
+
+        void run(const std::string& name, const char* kind, const char* unit, const Setup& setup);
+        // For benchmarks that time themselves: whether to run this one, listing it instead under
+        // --list. A benchmark that runs hands its samples to record(), which fills in the summary.
+        bool shouldRun(const std::string& name, const char* kind) const;
+        void record(Result result);
+
+        [[nodiscard]] const std::vector<Result>& results() const { return mResults; }
+        void writeJson(std::FILE* out, unsigned workerThreads) const;
+        // Compares medians against an earlier writeJson() file and prints each change to stderr.
+        // Returns how many benchmarks got slower by more than threshold (0.1 = 10%) and by more
+        // than the two runs' confidence intervals, or -1 if the baseline can't be read.
+        [[nodiscard]] int compareToBaseline(const std::string& path, double threshold) const;
+
+        // Keeps a computed value alive so the optimizer can't drop the work behind it.
+        static void consume(uint64_t value);
+
+        static Summary summarize(const std::vector<double>& samplesMs, size_t items);
+        // Interpolated between the nearest ranks; p in [0, 1].
+        static double percentile(std::vector<double> values, double p);
+
+    private:
+        Options mOptions;
+        std::vector<Result> mResults;
+};
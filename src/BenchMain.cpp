@@ -0,0 +1,1701 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "BenchHarness.h"
+#include "BlockTickScheduler.h"
+#include "ChunkStreamer.h"
+#include "Collision.h"
+#include "ColumnCache.h"
+#include "ColumnCodec.h"
+#include "Components.h"
+#include "Ecs.h"
+#include "FluidSimulator.h"
+#include "JobSystem.h"
+#include "LodMesher.h"
+#include "Mesher.h"
+#include "OcclusionRasterizer.h"
+#include "RandomTicks.h"
+#include "Raycast.h"
+#include "TerrainGenerator.h"
+#include "VisibilityGraph.h"
+#include "WorldSaver.h"
+
+// minecraft_bench: the simulation, meshing and storage subsystems measured without a window or
+// a GPU. Prints JSON to stdout (or --out) and progress to stderr.
+
+namespace {
+
+constexpr uint64_t SEED = 1337;
+constexpr int WORLD_RADIUS = 6;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void generateTestWorld(World& world, const TerrainGenerator& terrain, int radius) {
+    for (int x = -radius; x <= radius; x++) {
+        for (int z = -radius; z <= radius; z++) {
+            terrain.generateColumn({x, z}, world.createColumn({x, z}));
+        }
+    }
+}
+
+// What the benchmarks check about their own results along the way. Any failure makes the run
+// exit with 1 after the JSON is written.
+class Checks {
+    public:
+        void expect(bool ok, const char* what) {
+            if (!ok) {
+                std::fprintf(stderr, "check failed: %s\n", what);
+                mFailed++;
+            }
+        }
+
+        [[nodiscard]] int failed() const { return mFailed; }
+
+    private:
+        int mFailed = 0;
+};
+
+// For benchmarks that time themselves one tick or frame per sample, items of unit each.
+BenchHarness::Result sampledResult(const std::string& name, const char* unit, size_t items) {
+    BenchHarness::Result result;
+    result.name = name;
+    result.kind = "macro";
+    result.unit = unit;
+    result.items = items;
+    return result;
+}
+
+// A column and its four neighbours decoded once, so each of its sections can be meshed with
+// all six neighbours the way the GPU mesher sees them.
+class DecodedNeighborhood {
+    public:
+        void decode(const World& world, ColumnPos pos) {
+            for (int i = 0; i < 5; i++) {
+                const Column* column = world.column({pos.x + OFFSETS[i][0], pos.z + OFFSETS[i][1]});
+                mPresent[i] = column != nullptr;
+                for (int sy = 0; sy < Column::SECTIONS && column != nullptr; sy++) {
+                    column->section(sy).decode(blocks(i, sy));
+                }
+            }
+        }
+
+        // Appends the section's mesh and returns its connectivity.
+        uint16_t mesh(int sy, std::vector<MeshVertex>& out) {
+            SectionNeighbors neighbors{};
+            neighbors[FACE_NEG_X] = mPresent[1] ? blocks(1, sy) : nullptr;
+            neighbors[FACE_POS_X] = mPresent[2] ? blocks(2, sy) : nullptr;
+            neighbors[FACE_NEG_Y] = sy > 0 ? blocks(0, sy - 1) : nullptr;
+            neighbors[FACE_POS_Y] = sy + 1 < Column::SECTIONS ? blocks(0, sy + 1) : nullptr;
+            neighbors[FACE_NEG_Z] = mPresent[3] ? blocks(3, sy) : nullptr;
+            neighbors[FACE_POS_Z] = mPresent[4] ? blocks(4, sy) : nullptr;
+            meshSectionReference(blocks(0, sy), neighbors, out);
+            return computeConnectivity(blocks(0, sy));
+        }
+
+    private:
+        static constexpr int OFFSETS[5][2] = {{0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+        uint32_t* blocks(int column, int sy) {
+            return mBlocks.data() + (static_cast<size_t>(column) * Column::SECTIONS + sy) * Section::VOLUME;
+        }
+
+        std::vector<uint32_t> mBlocks = std::vector<uint32_t>(5 * Column::SECTIONS * Section::VOLUME);
+        std::array<bool, 5> mPresent{};
+};
+
+// Column-major perspective * look-at in Vulkan clip space (y down, depth 0..1), as the renderer
+// hands to OcclusionRasterizer.
+void viewProjection(const float eye[3], const float forward[3], float aspect, float out[16]) {
+    const float up[3] = {0.0f, 1.0f, 0.0f};
+    float side[3] = {forward[1] * up[2] - forward[2] * up[1], forward[2] * up[0] - forward[0] * up[2], forward[0] * up[1] - forward[1] * up[0]};
+    const float sideLength = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+    for (float& v : side) {
+        v /= sideLength;
+    }
+    const float camUp[3] = {side[1] * forward[2] - side[2] * forward[1], side[2] * forward[0] - side[0] * forward[2], side[0] * forward[1] - side[1] * forward[0]};
+    const float view[16] = {
+        side[0], camUp[0], -forward[0], 0.0f,
+        side[1], camUp[1], -forward[1], 0.0f,
+        side[2], camUp[2], -forward[2], 0.0f,
+        -(side[0] * eye[0] + side[1] * eye[1] + side[2] * eye[2]),
+        -(camUp[0] * eye[0] + camUp[1] * eye[1] + camUp[2] * eye[2]),
+        forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2], 1.0f,
+    };
+    constexpr float NEAR = 0.1f;
+    constexpr float FAR = 1000.0f;
+    const float f = 1.0f / std::tan(0.5f * 70.0f * 3.14159265f / 180.0f);
+    const float projection[16] = {
+        f / aspect, 0.0f, 0.0f, 0.0f,
+        0.0f, -f, 0.0f, 0.0f,
+        0.0f, 0.0f, FAR / (NEAR - FAR), -1.0f,
+        0.0f, 0.0f, NEAR * FAR / (NEAR - FAR), 0.0f,
+    };
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += projection[k * 4 + row] * view[column * 4 + k];
+            }
+            out[column * 4 + row] = sum;
+        }
+    }
+}
+
+// The CPU side of rendering a frame with nothing submitted: streaming, meshing what streamed in
+// with the reference mesher, cave culling from the camera and software occlusion of what's left.
+class HeadlessFrames {
+    public:
+        static constexpr size_t MAX_OCCLUDERS = 512;
+
+        HeadlessFrames(const TerrainGenerator& terrain, JobSystem& jobs, int radius)
+            : mJobs(jobs), mStreamer(mWorld, terrain, jobs), mRadius(radius) {
+            mStreamer.setRadius(radius);
+        }
+
+        struct StageTimes {
+            double streamMs = 0.0;
+            double cullMs = 0.0;
+            double occlusionMs = 0.0;
+        };
+
+        // Returns the sections drawn. forward is normalized.
+        size_t frame(const float eye[3], const float forward[3]) {
+            auto start = std::chrono::steady_clock::now();
+            mStreamer.update(eye[0], eye[2], forward[0], forward[2],
+                [this](ColumnPos pos) { meshColumn(pos); },
+                [this](ColumnPos pos) { releaseColumn(pos); return true; });
+            mStages.streamMs = millisecondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            float viewProj[16];
+            viewProjection(eye, forward, 16.0f / 9.0f, viewProj);
+            const SectionPos cameraSection{blockToSection(static_cast<int32_t>(std::floor(eye[0]))),
+                                           std::clamp(blockToSection(static_cast<int32_t>(std::floor(eye[1]))), 0, Column::SECTIONS - 1),
+                                           blockToSection(static_cast<int32_t>(std::floor(eye[2])))};
+            mReachable.clear();
+            mVisibility.traverse(mWorld, cameraSection, mRadius, mReachable);
+            mStages.cullMs = millisecondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            mOccluders.clear();
+            for (const auto& [pos, quads] : mColumnOccluders) {
+                mOccluders.insert(mOccluders.end(), quads.begin(), quads.end());
+            }
+            mRasterizer.begin(viewProj, mOccluders, MAX_OCCLUDERS);
+            mJobs.parallelFor(OcclusionRasterizer::BANDS, 1, [this](size_t begin, size_t end) {
+                for (size_t band = begin; band < end; band++) {
+                    mRasterizer.rasterizeBand(static_cast<int>(band));
+                }
+            });
+            size_t drawn = 0;
+            for (const SectionPos& pos : mReachable) {
+                const float minCorner[3] = {static_cast<float>(pos.x * Section::SIZE), static_cast<float>(pos.y * Section::SIZE),
+                                            static_cast<float>(pos.z * Section::SIZE)};
+                const float maxCorner[3] = {minCorner[0] + Section::SIZE, minCorner[1] + Section::SIZE, minCorner[2] + Section::SIZE};
+                drawn += mVertexCounts.count(pos) != 0 && mRasterizer.isVisible(minCorner, maxCorner) ? 1 : 0;
+            }
+            mStages.occlusionMs = millisecondsSince(start);
+            return drawn;
+        }
+
+        // Level flight at a fixed height, looking slightly down.
+        size_t frame(float x, float z, float forwardX) {
+            const float eye[3] = {x, 90.0f, z};
+            const float length = std::sqrt(forwardX * forwardX + 0.09f);
+            const float forward[3] = {forwardX / length, -0.3f / length, 0.0f};
+            return frame(eye, forward);
+        }
+
+        [[nodiscard]] size_t vertices() const { return mVertices; }
+        [[nodiscard]] const StageTimes& stages() const { return mStages; }
+        [[nodiscard]] bool isMeshed(ColumnPos pos) const { return mStreamer.isMeshed(pos); }
+        [[nodiscard]] bool idle() const { return mStreamer.idle(); }
+        [[nodiscard]] int radius() const { return mRadius; }
+
+    private:
+        bool isSolid(SectionPos pos) const {
+            const Section* section = mWorld.section(pos);
+            return section != nullptr && section->isUniform() && isOpaque(section->palette()[0]);
+        }
+
+        void meshColumn(ColumnPos pos) {
+            mDecoded.decode(mWorld, pos);
+            std::vector<OcclusionRasterizer::Quad>& occluders = mColumnOccluders[pos];
+            for (int sy = 0; sy < Column::SECTIONS; sy++) {
+                const SectionPos section{pos.x, sy, pos.z};
+                if (isSolid(section)) {
+                    const float origin[3] = {static_cast<float>(pos.x * Section::SIZE), static_cast<float>(sy * Section::SIZE),
+                                             static_cast<float>(pos.z * Section::SIZE)};
+                    for (int face = 0; face < FACE_COUNT; face++) {
+                        const int* offset = FACE_OFFSETS[face];
+                        if (!isSolid({section.x + offset[0], section.y + offset[1], section.z + offset[2]})) {
+                            occluders.push_back(OcclusionRasterizer::cubeFace(origin, Section::SIZE, face / 2, (face & 1) != 0));
+                        }
+                    }
+                }
+                if (mWorld.column(pos)->section(sy).isEmpty()) {
+                    continue;
+                }
+                mMesh.clear();
+                const uint16_t connectivity = mDecoded.mesh(sy, mMesh);
+                if (!mWorld.column(pos)->section(sy).isUniform()) {
+                    mVisibility.setConnectivity(section, connectivity);
+                }
+                if (!mMesh.empty()) {
+                    mVertexCounts[section] = mMesh.size();
+                    mVertices += mMesh.size();
+                }
+            }
+        }
+
+        void releaseColumn(ColumnPos pos) {
+            for (int sy = 0; sy < Column::SECTIONS; sy++) {
+                const SectionPos section{pos.x, sy, pos.z};
+                mVisibility.erase(section);
+                auto it = mVertexCounts.find(section);
+                if (it != mVertexCounts.end()) {
+                    mVertices -= it->second;
+                    mVertexCounts.erase(it);
+                }
+            }
+            mColumnOccluders.erase(pos);
+        }
+
+        JobSystem& mJobs;
+        World mWorld;
+        ChunkStreamer mStreamer;
+        int mRadius;
+        DecodedNeighborhood mDecoded;
+        std::vector<MeshVertex> mMesh;
+        VisibilityGraph mVisibility;
+        OcclusionRasterizer mRasterizer;
+        std::unordered_map<SectionPos, size_t, SectionPosHash> mVertexCounts;
+        std::unordered_map<ColumnPos, std::vector<OcclusionRasterizer::Quad>, ColumnPosHash> mColumnOccluders;
+        std::vector<OcclusionRasterizer::Quad> mOccluders;
+        std::vector<SectionPos> mReachable;
+        size_t mVertices = 0;
+        StageTimes mStages;
+};
+
+void registerNoise(BenchHarness& harness, const TerrainGenerator& terrain) {
+    constexpr int GRID = 256;
+    harness.run("noise/noise2", "micro", "sample", [&terrain]() -> BenchHarness::Body {
+        return [&terrain]() {
+            float sum = 0.0f;
+            for (int z = 0; z < GRID; z++) {
+                for (int x = 0; x < GRID; x++) {
+                    sum += terrain.noise2(static_cast<float>(x) * 0.37f, static_cast<float>(z) * 0.37f);
+                }
+            }
+            BenchHarness::consume(static_cast<uint64_t>(sum * 1000.0f));
+            return static_cast<size_t>(GRID * GRID);
+        };
+    });
+    harness.run("noise/noise3", "micro", "sample", [&terrain]() -> BenchHarness::Body {
+        return [&terrain]() {
+            float sum = 0.0f;
+            for (int y = 0; y < 16; y++) {
+                for (int z = 0; z < 64; z++) {
+                    for (int x = 0; x < 64; x++) {
+                        sum += terrain.noise3(static_cast<float>(x) * 0.37f, static_cast<float>(y) * 0.37f, static_cast<float>(z) * 0.37f);
+                    }
+                }
+            }
+            BenchHarness::consume(static_cast<uint64_t>(sum * 1000.0f));
+            return static_cast<size_t>(16 * 64 * 64);
+        };
+    });
+    harness.run("noise/fbm2_5_octaves", "micro", "sample", [&terrain]() -> BenchHarness::Body {
+        return [&terrain]() {
+            float sum = 0.0f;
+            for (int z = 0; z < GRID; z++) {
+                for (int x = 0; x < GRID; x++) {
+                    sum += terrain.fbm2(static_cast<float>(x) / 96.0f, static_cast<float>(z) / 96.0f, 5);
+                }
+            }
+            BenchHarness::consume(static_cast<uint64_t>(sum * 1000.0f));
+            return static_cast<size_t>(GRID * GRID);
+        };
+    });
+    harness.run("terrain/generate_column", "macro", "column", [&terrain]() -> BenchHarness::Body {
+        return [&terrain]() {
+            constexpr int SIDE = 6;
+            for (int z = 0; z < SIDE; z++) {
+                for (int x = 0; x < SIDE; x++) {
+                    Column column;
+                    terrain.generateColumn({x, z}, column);
+                    BenchHarness::consume(column.get(0, 64, 0));
+                }
+            }
+            return static_cast<size_t>(SIDE * SIDE);
+        };
+    });
+}
+
+void registerPalette(BenchHarness& harness, const World& world) {
+    // Sections around the surface, where palettes are the largest.
+    std::vector<const Section*> sections;
+    for (const auto& [pos, column] : world.columns()) {
+        for (int sy = 0; sy < Column::SECTIONS; sy++) {
+            if (column.section(sy).palette().size() > 2) {
+                sections.push_back(&column.section(sy));
+            }
+        }
+    }
+    sections.resize(std::min<size_t>(sections.size(), 64));
+
+    harness.run("palette/get_random", "micro", "get", [sections]() -> BenchHarness::Body {
+        auto indices = std::make_shared<std::vector<uint16_t>>(1 << 16);
+        std::mt19937 rng(7);
+        for (uint16_t& index : *indices) {
+            index = static_cast<uint16_t>(rng() % Section::VOLUME);
+        }
+        return [sections, indices]() {
+            uint64_t sum = 0;
+            for (const Section* section : sections) {
+                for (uint16_t index : *indices) {
+                    sum += section->getIndex(index);
+                }
+            }
+            BenchHarness::consume(sum);
+            return sections.size() * indices->size();
+        };
+    });
+    harness.run("palette/set_random", "micro", "set", [sections]() -> BenchHarness::Body {
+        return [sections]() {
+            std::mt19937 rng(7);
+            size_t sets = 0;
+            for (const Section* source : sections) {
+                Section section = *source;
+                for (int i = 0; i < Section::VOLUME; i++) {
+                    const uint32_t random = rng();
+                    section.set(random & 15, (random >> 4) & 15, (random >> 8) & 15, static_cast<BlockId>((random >> 12) % 4));
+                }
+                sets += Section::VOLUME;
+                BenchHarness::consume(section.nonAirCount());
+            }
+            return sets;
+        };
+    });
+    harness.run("palette/decode", "micro", "section", [sections]() -> BenchHarness::Body {
+        auto blocks = std::make_shared<std::vector<uint32_t>>(Section::VOLUME);
+        return [sections, blocks]() {
+            for (const Section* section : sections) {
+                section->decode(blocks->data());
+                BenchHarness::consume((*blocks)[Section::VOLUME / 2]);
+            }
+            return sections.size();
+        };
+    });
+}
+
+void registerMeshing(BenchHarness& harness, const World& world) {
+    constexpr int MESH_RADIUS = 2;
+    harness.run("mesh/section_reference", "micro", "section", [&world]() -> BenchHarness::Body {
+        auto decoded = std::make_shared<std::vector<DecodedNeighborhood>>();
+        for (int z = -MESH_RADIUS; z <= MESH_RADIUS; z++) {
+            for (int x = -MESH_RADIUS; x <= MESH_RADIUS; x++) {
+                decoded->emplace_back().decode(world, {x, z});
+            }
+        }
+        auto vertices = std::make_shared<std::vector<MeshVertex>>();
+        return [decoded, vertices]() {
+            for (DecodedNeighborhood& column : *decoded) {
+                for (int sy = 0; sy < Column::SECTIONS; sy++) {
+                    vertices->clear();
+                    column.mesh(sy, *vertices);
+                    BenchHarness::consume(vertices->size());
+                }
+            }
+            return decoded->size() * Column::SECTIONS;
+        };
+    });
+    for (int lod = 1; lod < LOD_LEVELS; lod++) {
+        harness.run("mesh/lod" + std::to_string(lod) + "_column", "micro", "column", [&world, lod]() -> BenchHarness::Body {
+            return [&world, lod]() {
+                LodColumnMesh mesh;
+                for (int z = -MESH_RADIUS; z <= MESH_RADIUS; z++) {
+                    for (int x = -MESH_RADIUS; x <= MESH_RADIUS; x++) {
+                        meshLodColumn(world, {x, z}, lod, mesh);
+                        BenchHarness::consume(mesh.vertices.size());
+                    }
+                }
+                return static_cast<size_t>((2 * MESH_RADIUS + 1) * (2 * MESH_RADIUS + 1));
+            };
+        });
+    }
+    // There is no light engine; the connectivity flood fill is the per-section propagation
+    // pass the renderer runs instead.
+    harness.run("visibility/connectivity", "micro", "section", [&world]() -> BenchHarness::Body {
+        auto blocks = std::make_shared<std::vector<std::vector<uint32_t>>>();
+        for (const auto& [pos, column] : world.columns()) {
+            for (int sy = 0; sy < Column::SECTIONS; sy++) {
+                if (!column.section(sy).isUniform() && blocks->size() < 256) {
+                    column.section(sy).decode(blocks->emplace_back(Section::VOLUME).data());
+                }
+            }
+        }
+        return [blocks]() {
+            for (const std::vector<uint32_t>& section : *blocks) {
+                BenchHarness::consume(computeConnectivity(section.data()));
+            }
+            return blocks->size();
+        };
+    });
+}
+
+void registerRegionIo(BenchHarness& harness, const World& world) {
+    harness.run("region/encode_column", "micro", "column", [&world]() -> BenchHarness::Body {
+        return [&world]() {
+            std::vector<uint8_t> encoded;
+            for (const auto& [pos, column] : world.columns()) {
+                encoded.clear();
+                encodeColumn(column, encoded);
+                BenchHarness::consume(encoded.size());
+            }
+            return world.columnCount();
+        };
+    });
+
+    const std::string directory = (std::filesystem::temp_directory_path() / "minecraft-bench-regions").string();
+    std::filesystem::remove_all(directory);
+    harness.run("region/save", "macro", "column", [&world, directory]() -> BenchHarness::Body {
+        auto saver = std::make_shared<WorldSaver>(directory);
+        return [&world, saver]() {
+            saver->save(world);
+            saver->wait();
+            return world.columnCount();
+        };
+    });
+    harness.run("region/load", "macro", "column", [&world, directory]() -> BenchHarness::Body {
+        auto saver = std::make_shared<WorldSaver>(directory);
+        // Nothing to load unless region/save ran first.
+        if (!std::filesystem::exists(directory)) {
+            saver->save(world);
+            saver->wait();
+        }
+        return [&world, saver]() {
+            size_t loaded = 0;
+            for (const auto& [pos, column] : world.columns()) {
+                Column restored;
+                loaded += saver->loadColumn(pos, restored) ? 1 : 0;
+            }
+            return loaded;
+        };
+    });
+    std::filesystem::remove_all(directory);
+}
+
+void registerFrames(BenchHarness& harness, const TerrainGenerator& terrain, JobSystem& jobs) {
+    constexpr int FRAMES = 120;
+    constexpr float SPEED = 2.0f;
+    harness.run("frame/headless", "macro", "frame", [&terrain, &jobs]() -> BenchHarness::Body {
+        auto frames = std::make_shared<HeadlessFrames>(terrain, jobs, 8);
+        // Everything around the start streams in before the first timed flight.
+        for (int i = 0; i < 200; i++) {
+            frames->frame(8.0f, 8.0f, 1.0f);
+        }
+        // Out and back, so every repetition starts from the same place.
+        return [frames]() {
+            size_t drawn = 0;
+            for (int i = 0; i < FRAMES; i++) {
+                const bool out = i < FRAMES / 2;
+                const float x = 8.0f + SPEED * static_cast<float>(out ? i : FRAMES - i);
+                drawn += frames->frame(x, 8.0f, out ? 1.0f : -1.0f);
+            }
+            BenchHarness::consume(drawn + frames->vertices());
+            return static_cast<size_t>(FRAMES);
+        };
+    });
+}
+
+// A recorded flight over the seed's terrain, looped: low over hills, out across the sea and
+// back through the valleys. The camera follows a Catmull-Rom spline through the points, one
+// segment every FLIGHT_SEGMENT_SECONDS.
+constexpr float FLIGHT_PATH[][3] = {
+    {8.0f, 96.0f, 8.0f}, {180.0f, 104.0f, 60.0f}, {340.0f, 92.0f, 230.0f}, {300.0f, 118.0f, 470.0f},
+    {90.0f, 100.0f, 560.0f}, {-170.0f, 96.0f, 420.0f}, {-290.0f, 110.0f, 170.0f}, {-140.0f, 94.0f, -40.0f},
+};
+constexpr int FLIGHT_POINTS = static_cast<int>(sizeof(FLIGHT_PATH) / sizeof(FLIGHT_PATH[0]));
+constexpr float FLIGHT_SEGMENT_SECONDS = 8.0f;
+// Simulated time advances by a fixed step per frame however long frames take, so every run
+// flies the same frames.
+constexpr float FLIGHT_STEP_SECONDS = 1.0f / 60.0f;
+
+void flightPose(float seconds, float eye[3], float forward[3]) {
+    const float segment = seconds / FLIGHT_SEGMENT_SECONDS;
+    const int index = static_cast<int>(std::floor(segment));
+    const float t = segment - static_cast<float>(index);
+    const float* p[4];
+    for (int i = 0; i < 4; i++) {
+        p[i] = FLIGHT_PATH[((index + i - 1) % FLIGHT_POINTS + FLIGHT_POINTS) % FLIGHT_POINTS];
+    }
+    float length = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        const float a = p[0][axis];
+        const float b = p[1][axis];
+        const float c = p[2][axis];
+        const float d = p[3][axis];
+        eye[axis] = 0.5f * (2.0f * b + (c - a) * t + (2.0f * a - 5.0f * b + 4.0f * c - d) * t * t + (3.0f * b - a - 3.0f * c + d) * t * t * t);
+        forward[axis] = 0.5f * ((c - a) + 2.0f * (2.0f * a - 5.0f * b + 4.0f * c - d) * t + 3.0f * (3.0f * b - a - 3.0f * c + d) * t * t);
+        length += forward[axis] * forward[axis];
+    }
+    length = std::sqrt(length);
+    for (int axis = 0; axis < 3; axis++) {
+        forward[axis] /= length;
+    }
+}
+
+// Frames back to back along the flight path, streaming as it goes. Besides frame times it
+// reports each stage's share and how long columns coming into view take to be meshed. Nothing
+// reaches a GPU here, so there is no GPU time to report.
+void runFlythrough(BenchHarness& harness, const TerrainGenerator& terrain, JobSystem& jobs, double seconds) {
+    constexpr int RADIUS = 8;
+    const std::string name = "flythrough/spline";
+    if (!harness.shouldRun(name, "macro")) {
+        return;
+    }
+    HeadlessFrames frames(terrain, jobs, RADIUS);
+    float eye[3];
+    float forward[3];
+    flightPose(0.0f, eye, forward);
+    // The start loads fully first, as it would behind a loading screen.
+    while (!frames.idle()) {
+        frames.frame(eye, forward);
+    }
+
+    BenchHarness::Result result;
+    result.name = name;
+    result.kind = "macro";
+    result.unit = "frame";
+    std::vector<double> streamMs;
+    std::vector<double> cullMs;
+    std::vector<double> occlusionMs;
+    std::vector<double> loadMs;
+    std::vector<double> loadFrames;
+    struct Wanted {
+        double ms;
+        int frame;
+    };
+    std::unordered_map<ColumnPos, Wanted, ColumnPosHash> wanted;
+    size_t abandoned = 0;
+    const int frameCount = static_cast<int>(seconds / FLIGHT_STEP_SECONDS);
+    const auto flightStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; frame++) {
+        flightPose(static_cast<float>(frame) * FLIGHT_STEP_SECONDS, eye, forward);
+        const auto frameStart = std::chrono::steady_clock::now();
+        BenchHarness::consume(frames.frame(eye, forward));
+        result.samplesMs.push_back(millisecondsSince(frameStart));
+        streamMs.push_back(frames.stages().streamMs);
+        cullMs.push_back(frames.stages().cullMs);
+        occlusionMs.push_back(frames.stages().occlusionMs);
+
+        // A column is wanted from the first frame that ends with it in range and unmeshed.
+        const double now = millisecondsSince(flightStart);
+        const ColumnPos center{blockToSection(static_cast<int32_t>(std::floor(eye[0]))), blockToSection(static_cast<int32_t>(std::floor(eye[2])))};
+        for (int dz = -RADIUS; dz <= RADIUS; dz++) {
+            for (int dx = -RADIUS; dx <= RADIUS; dx++) {
+                if (dx * dx + dz * dz > RADIUS * RADIUS) {
+                    continue;
+                }
+                const ColumnPos pos{center.x + dx, center.z + dz};
+                auto it = wanted.find(pos);
+                if (frames.isMeshed(pos)) {
+                    if (it != wanted.end()) {
+                        loadMs.push_back(now - it->second.ms);
+                        loadFrames.push_back(static_cast<double>(frame - it->second.frame));
+                        wanted.erase(it);
+                    }
+                } else if (it == wanted.end()) {
+                    wanted.emplace(pos, Wanted{now, frame});
+                }
+            }
+        }
+        // Flown past before it was ready.
+        for (auto it = wanted.begin(); it != wanted.end();) {
+            const int dx = it->first.x - center.x;
+            const int dz = it->first.z - center.z;
+            if (dx * dx + dz * dz > RADIUS * RADIUS) {
+                abandoned++;
+                it = wanted.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    const double flightMs = millisecondsSince(flightStart);
+
+    result.items = result.samplesMs.size();
+    auto mean = [](const std::vector<double>& values) {
+        double sum = 0.0;
+        for (double value : values) {
+            sum += value;
+        }
+        return values.empty() ? 0.0 : sum / static_cast<double>(values.size());
+    };
+    result.metrics = {
+        {"flight_seconds", seconds},
+        {"fps", 1000.0 * static_cast<double>(result.items) / flightMs},
+        {"frame_p99_ms", BenchHarness::percentile(result.samplesMs, 0.99)},
+        {"frame_p999_ms", BenchHarness::percentile(result.samplesMs, 0.999)},
+        {"stream_mean_ms", mean(streamMs)},
+        {"stream_p99_ms", BenchHarness::percentile(streamMs, 0.99)},
+        {"cull_mean_ms", mean(cullMs)},
+        {"occlusion_mean_ms", mean(occlusionMs)},
+        {"columns_loaded", static_cast<double>(loadMs.size())},
+        {"columns_abandoned", static_cast<double>(abandoned)},
+        {"chunk_load_p50_ms", BenchHarness::percentile(loadMs, 0.5)},
+        {"chunk_load_p99_ms", BenchHarness::percentile(loadMs, 0.99)},
+        {"chunk_load_max_ms", loadMs.empty() ? 0.0 : *std::max_element(loadMs.begin(), loadMs.end())},
+        {"chunk_load_p50_frames", BenchHarness::percentile(loadFrames, 0.5)},
+        {"chunk_load_p99_frames", BenchHarness::percentile(loadFrames, 0.99)},
+    };
+    harness.record(std::move(result));
+}
+
+struct Health {
+    float value;
+};
+
+void integrate(size_t count, Position* positions, const Velocity* velocities, float dt) {
+    for (size_t i = 0; i < count; i++) {
+        positions[i].x += velocities[i].x * dt;
+        positions[i].y += velocities[i].y * dt;
+        positions[i].z += velocities[i].z * dt;
+    }
+}
+
+constexpr size_t ECS_ENTITIES = 1000000;
+
+// Mostly moving entities, some with an extra component and some static ones the query skips.
+void populateRegistry(EntityRegistry& registry, std::vector<Entity>& entities) {
+    entities.reserve(ECS_ENTITIES);
+    for (size_t i = 0; i < ECS_ENTITIES; i++) {
+        const auto f = static_cast<float>(i);
+        const Position position{f, 0.0f, -f};
+        const Velocity velocity{1.0f, static_cast<float>(i % 7), -1.0f};
+        if (i % 8 == 0) {
+            entities.push_back(registry.create(position));
+        } else if (i % 4 == 0) {
+            entities.push_back(registry.create(position, velocity, Health{20.0f}));
+        } else {
+            entities.push_back(registry.create(position, velocity));
+        }
+    }
+}
+
+struct EcsScene {
+    EntityRegistry registry;
+    std::vector<Entity> entities;
+    size_t moving = 0;
+};
+
+std::shared_ptr<EcsScene> makeEcsScene() {
+    auto scene = std::make_shared<EcsScene>();
+    populateRegistry(scene->registry, scene->entities);
+    EcsScene& populated = *scene;
+    populated.registry.each<Position, Velocity>([&populated](size_t count, Position*, Velocity*) { populated.moving += count; });
+    return scene;
+}
+
+void registerEcs(BenchHarness& harness, JobSystem& jobs, Checks& checks) {
+    constexpr float DT = 1.0f / 60.0f;
+    harness.run("ecs/create", "macro", "entity", []() -> BenchHarness::Body {
+        return []() {
+            EntityRegistry registry;
+            std::vector<Entity> entities;
+            populateRegistry(registry, entities);
+            BenchHarness::consume(registry.size());
+            return entities.size();
+        };
+    });
+    harness.run("ecs/integrate", "micro", "entity", []() -> BenchHarness::Body {
+        auto scene = makeEcsScene();
+        return [scene]() {
+            scene->registry.each<Position, Velocity>([](size_t count, Position* positions, Velocity* velocities) {
+                integrate(count, positions, velocities, DT);
+            });
+            return scene->moving;
+        };
+    });
+    harness.run("ecs/integrate_parallel", "micro", "entity", [&jobs]() -> BenchHarness::Body {
+        auto scene = makeEcsScene();
+        return [scene, &jobs]() {
+            scene->registry.parallelEach<Position, Velocity>(jobs, [](size_t count, Position* positions, Velocity* velocities) {
+                integrate(count, positions, velocities, DT);
+            });
+            return scene->moving;
+        };
+    });
+    // Churn: destroyed handles must go stale while their indices are reused.
+    harness.run("ecs/replace", "micro", "entity", [&checks]() -> BenchHarness::Body {
+        auto scene = makeEcsScene();
+        return [scene, &checks]() {
+            size_t replaced = 0;
+            size_t stale = 0;
+            for (size_t i = 0; i < ECS_ENTITIES; i += 10) {
+                const Entity old = scene->entities[i];
+                scene->registry.destroy(old);
+                scene->entities[i] = scene->registry.create(Position{0.0f, 0.0f, 0.0f}, Velocity{0.0f, 1.0f, 0.0f});
+                stale += !scene->registry.alive(old) && scene->registry.get<Position>(old) == nullptr ? 1 : 0;
+                replaced++;
+            }
+            checks.expect(stale == replaced, "ecs/replace: a destroyed entity's handle still resolves");
+            return replaced;
+        };
+    });
+}
+
+// Block-by-block traversal through World::getBlock with no empty-space skipping.
+RayHit referenceCast(const World& world, const Ray& ray) {
+    int32_t cell[3];
+    int32_t step[3];
+    float tMax[3];
+    float tDelta[3];
+    for (int axis = 0; axis < 3; axis++) {
+        const float d = ray.direction[axis];
+        cell[axis] = static_cast<int32_t>(std::floor(ray.origin[axis]));
+        step[axis] = d > 0.0f ? 1 : (d < 0.0f ? -1 : 0);
+        tDelta[axis] = d != 0.0f ? std::fabs(1.0f / d) : INFINITY;
+        tMax[axis] = d != 0.0f ? (static_cast<float>(cell[axis] + (d > 0.0f ? 1 : 0)) - ray.origin[axis]) / d : INFINITY;
+    }
+    float t = 0.0f;
+    while (t <= ray.maxDistance) {
+        const BlockId id = world.getBlock(cell[0], cell[1], cell[2]);
+        if (id != AIR) {
+            RayHit hit;
+            hit.hit = true;
+            hit.block[0] = cell[0];
+            hit.block[1] = cell[1];
+            hit.block[2] = cell[2];
+            hit.distance = t;
+            hit.id = id;
+            return hit;
+        }
+        const int axis = tMax[0] <= tMax[1] && tMax[0] <= tMax[2] ? 0 : (tMax[1] <= tMax[2] ? 1 : 2);
+        t = tMax[axis];
+        tMax[axis] += tDelta[axis];
+        cell[axis] += step[axis];
+    }
+    return {};
+}
+
+bool sameHit(const RayHit& a, const RayHit& b) {
+    return a.hit == b.hit && (!a.hit || (a.block[0] == b.block[0] && a.block[1] == b.block[1] && a.block[2] == b.block[2]));
+}
+
+// A wider world than the shared one, with half short picking rays from just above the ground
+// and half long sight lines and explosion rays from anywhere in the air, in random directions.
+struct RaycastScene {
+    static constexpr int RADIUS = 8;
+    static constexpr size_t RAYS = 1 << 20;
+
+    RaycastScene(const TerrainGenerator& terrain, JobSystem& jobs) {
+        generateTestWorld(world, terrain, RADIUS);
+        raycaster.rebuild(jobs);
+        std::mt19937 rng(42);
+        const float extent = static_cast<float>(RADIUS * Section::SIZE);
+        std::uniform_real_distribution<float> horizontal(-extent, extent);
+        std::uniform_real_distribution<float> height(0.0f, static_cast<float>(Column::HEIGHT));
+        std::normal_distribution<float> direction(0.0f, 1.0f);
+        rays.resize(RAYS);
+        for (size_t i = 0; i < RAYS; i++) {
+            Ray& ray = rays[i];
+            ray.origin[0] = horizontal(rng);
+            ray.origin[2] = horizontal(rng);
+            const bool picking = i % 2 == 0;
+            if (picking) {
+                const auto x = static_cast<int32_t>(std::floor(ray.origin[0]));
+                const auto z = static_cast<int32_t>(std::floor(ray.origin[2]));
+                ray.origin[1] = static_cast<float>(terrain.surfaceHeight(x, z)) + 2.6f;
+            } else {
+                ray.origin[1] = height(rng);
+            }
+            float length = 0.0f;
+            for (float& d : ray.direction) {
+                d = direction(rng);
+                length += d * d;
+            }
+            for (float& d : ray.direction) {
+                d /= std::sqrt(length);
+            }
+            ray.maxDistance = picking ? 8.0f : 128.0f;
+        }
+        hits.resize(RAYS);
+        for (size_t i = 0; i < RAYS; i++) {
+            hits[i] = raycaster.cast(rays[i]);
+        }
+    }
+
+    World world;
+    VoxelRaycaster raycaster{world};
+    std::vector<Ray> rays;
+    // From cast(), which the other paths are checked against.
+    std::vector<RayHit> hits;
+};
+
+void registerRaycast(BenchHarness& harness, const TerrainGenerator& terrain, JobSystem& jobs, Checks& checks) {
+    // Built by whichever of these runs first.
+    std::shared_ptr<RaycastScene> built;
+    auto scene = [&built, &terrain, &jobs]() {
+        if (built == nullptr) {
+            built = std::make_shared<RaycastScene>(terrain, jobs);
+        }
+        return built;
+    };
+    harness.run("raycast/cast", "micro", "ray", [&scene]() -> BenchHarness::Body {
+        auto raycast = scene();
+        return [raycast]() {
+            size_t hits = 0;
+            for (const Ray& ray : raycast->rays) {
+                hits += raycast->raycaster.cast(ray).hit ? 1 : 0;
+            }
+            BenchHarness::consume(hits);
+            return raycast->rays.size();
+        };
+    });
+    harness.run("raycast/cast_batch", "micro", "ray", [&scene, &jobs, &checks]() -> BenchHarness::Body {
+        auto raycast = scene();
+        auto hits = std::make_shared<std::vector<RayHit>>(raycast->rays.size());
+        raycast->raycaster.castBatch(raycast->rays.data(), raycast->rays.size(), hits->data(), jobs);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < hits->size(); i++) {
+            mismatches += sameHit((*hits)[i], raycast->hits[i]) ? 0 : 1;
+        }
+        checks.expect(mismatches == 0, "raycast/cast_batch: hits differ from cast()");
+        return [raycast, hits, &jobs]() {
+            raycast->raycaster.castBatch(raycast->rays.data(), raycast->rays.size(), hits->data(), jobs);
+            BenchHarness::consume(hits->front().hit ? 1 : 0);
+            return raycast->rays.size();
+        };
+    });
+    // On a sample of the rays, checking that the skips never miss a block.
+    constexpr size_t REFERENCE_STRIDE = 61;
+    harness.run("raycast/reference", "micro", "ray", [&scene, &checks]() -> BenchHarness::Body {
+        auto raycast = scene();
+        size_t mismatches = 0;
+        for (size_t i = 0; i < raycast->rays.size(); i += REFERENCE_STRIDE) {
+            mismatches += sameHit(referenceCast(raycast->world, raycast->rays[i]), raycast->hits[i]) ? 0 : 1;
+        }
+        checks.expect(mismatches == 0, "raycast/reference: cast() skipped past a block");
+        return [raycast]() {
+            size_t cast = 0;
+            size_t hits = 0;
+            for (size_t i = 0; i < raycast->rays.size(); i += REFERENCE_STRIDE) {
+                hits += referenceCast(raycast->world, raycast->rays[i]).hit ? 1 : 0;
+                cast++;
+            }
+            BenchHarness::consume(hits);
+            return cast;
+        };
+    });
+}
+
+// Mobs dropped a few blocks above the ground, wandering in random directions.
+struct CollisionScene {
+    static constexpr int RADIUS = 4;
+    static constexpr size_t ENTITIES = 20000;
+    static constexpr float DT = 1.0f / 20.0f;
+    static constexpr float GRAVITY = -32.0f;
+
+    explicit CollisionScene(const TerrainGenerator& terrain) {
+        generateTestWorld(world, terrain, RADIUS);
+        std::mt19937 rng(7);
+        const float extent = static_cast<float>(RADIUS * Section::SIZE);
+        std::uniform_real_distribution<float> horizontal(-extent, extent);
+        std::uniform_real_distribution<float> speed(-4.0f, 4.0f);
+        std::uniform_real_distribution<float> drop(0.0f, 8.0f);
+        while (registry.size() < ENTITIES) {
+            const float x = horizontal(rng);
+            const float z = horizontal(rng);
+            const float y = static_cast<float>(terrain.surfaceHeight(static_cast<int32_t>(std::floor(x)), static_cast<int32_t>(std::floor(z)))) + 1.0f + drop(rng);
+            const Collider collider{0.3f, 1.8f, false};
+            // Sweeps never push entities out of blocks, so none may start inside one.
+            bool clear = true;
+            for (int32_t by = static_cast<int32_t>(std::floor(y)); by <= static_cast<int32_t>(std::floor(y + collider.height)); by++) {
+                for (int32_t cz = static_cast<int32_t>(std::floor(z - collider.halfWidth)); cz <= static_cast<int32_t>(std::floor(z + collider.halfWidth)); cz++) {
+                    for (int32_t cx = static_cast<int32_t>(std::floor(x - collider.halfWidth)); cx <= static_cast<int32_t>(std::floor(x + collider.halfWidth)); cx++) {
+                        clear = clear && blockShape(world.getBlock(cx, by, cz)).boxCount == 0;
+                    }
+                }
+            }
+            if (clear) {
+                registry.create(Position{x, y, z}, Velocity{speed(rng), 0.0f, speed(rng)}, collider);
+            }
+        }
+        registry.each<Position, Velocity, Collider>([this](size_t count, Position* positions, Velocity* velocities, Collider* colliders) {
+            for (size_t i = 0; i < count; i++) {
+                const Aabb box{
+                    {positions[i].x - colliders[i].halfWidth, positions[i].y, positions[i].z - colliders[i].halfWidth},
+                    {positions[i].x + colliders[i].halfWidth, positions[i].y + colliders[i].height, positions[i].z + colliders[i].halfWidth},
+                };
+                const float motion[3] = {velocities[i].x * DT, GRAVITY * DT * DT, velocities[i].z * DT};
+                std::array<int32_t, 3> min{};
+                std::array<int32_t, 3> max{};
+                sweepBounds(box, motion, min.data(), max.data());
+                bounds.emplace_back(min, max);
+            }
+        });
+    }
+
+    World world;
+    EntityRegistry registry;
+    // Each entity's first sweep, for the neighbourhood fetch.
+    std::vector<std::pair<std::array<int32_t, 3>, std::array<int32_t, 3>>> bounds;
+};
+
+void runCollision(BenchHarness& harness, const TerrainGenerator& terrain, JobSystem& jobs, Checks& checks) {
+    std::shared_ptr<CollisionScene> built;
+    auto scene = [&built, &terrain]() {
+        if (built == nullptr) {
+            built = std::make_shared<CollisionScene>(terrain);
+        }
+        return built;
+    };
+    // The per-tick neighbourhood fetch, through the column map per block and cached per column.
+    harness.run("collision/gather_per_block", "micro", "entity", [&scene]() -> BenchHarness::Body {
+        auto collision = scene();
+        auto neighborhood = std::make_shared<BlockNeighborhood>();
+        return [collision, neighborhood]() {
+            for (const auto& [min, max] : collision->bounds) {
+                neighborhood->gatherPerBlock(collision->world, min.data(), max.data());
+            }
+            return collision->bounds.size();
+        };
+    });
+    harness.run("collision/gather", "micro", "entity", [&scene]() -> BenchHarness::Body {
+        auto collision = scene();
+        auto neighborhood = std::make_shared<BlockNeighborhood>();
+        return [collision, neighborhood]() {
+            for (const auto& [min, max] : collision->bounds) {
+                neighborhood->gather(collision->world, min.data(), max.data());
+            }
+            return collision->bounds.size();
+        };
+    });
+
+    // Whole ticks, on the caller alone and then across the workers, carrying on from each other.
+    constexpr int TICKS = 100;
+    JobSystem serial(0);
+    const std::pair<const char*, JobSystem*> pools[] = {{"collision/move", &serial}, {"collision/move_parallel", &jobs}};
+    for (const auto& [name, pool] : pools) {
+        if (!harness.shouldRun(name, "macro")) {
+            continue;
+        }
+        auto collision = scene();
+        BenchHarness::Result result = sampledResult(name, "entity", CollisionScene::ENTITIES);
+        for (int tick = 0; tick < TICKS; tick++) {
+            const auto start = std::chrono::steady_clock::now();
+            collision->registry.parallelEach<Velocity>(*pool, [](size_t count, Velocity* velocities) {
+                for (size_t i = 0; i < count; i++) {
+                    velocities[i].y += CollisionScene::GRAVITY * CollisionScene::DT;
+                }
+            });
+            moveEntities(collision->world, collision->registry, *pool, CollisionScene::DT);
+            result.samplesMs.push_back(millisecondsSince(start));
+        }
+
+        // By now every mob should be standing on something solid.
+        size_t grounded = 0;
+        size_t insideBlocks = 0;
+        collision->registry.each<Position, Collider>([&](size_t count, Position* positions, Collider* colliders) {
+            for (size_t i = 0; i < count; i++) {
+                grounded += colliders[i].onGround ? 1 : 0;
+                const auto x = static_cast<int32_t>(std::floor(positions[i].x));
+                const auto y = static_cast<int32_t>(std::floor(positions[i].y + 1e-3f));
+                const auto z = static_cast<int32_t>(std::floor(positions[i].z));
+                insideBlocks += blockShape(collision->world.getBlock(x, y, z)).boxCount > 0 ? 1 : 0;
+            }
+        });
+        checks.expect(insideBlocks == 0, "collision/move: an entity ended up inside a block");
+        result.metrics = {
+            {"workers", static_cast<double>(pool->workerCount())},
+            {"on_ground", static_cast<double>(grounded)},
+            {"inside_blocks", static_cast<double>(insideBlocks)},
+        };
+        harness.record(std::move(result));
+    }
+}
+
+void runFluids(BenchHarness& harness, const TerrainGenerator& terrain, Checks& checks) {
+    constexpr int RADIUS = 3;
+    constexpr size_t BUDGET = 4096;
+    constexpr size_t MAX_TICKS = 2000;
+    const bool settleSelected = harness.shouldRun("fluids/settle", "macro");
+    const bool restSelected = harness.shouldRun("fluids/rest", "macro");
+    const bool floodSelected = harness.shouldRun("fluids/flood", "macro");
+    if (!settleSelected && !restSelected && !floodSelected) {
+        return;
+    }
+
+    World world;
+    generateTestWorld(world, terrain, RADIUS);
+    FluidSimulator fluids(world);
+
+    // Ticks until nothing is active.
+    auto settle = [&fluids](const char* name) {
+        BenchHarness::Result result = sampledResult(name, "tick", 1);
+        size_t evaluated = 0;
+        size_t changed = 0;
+        size_t mostDeferred = 0;
+        while (fluids.activeCount() > 0 && result.samplesMs.size() < MAX_TICKS) {
+            const auto start = std::chrono::steady_clock::now();
+            const FluidSimulator::TickStats stats = fluids.tick(BUDGET);
+            result.samplesMs.push_back(millisecondsSince(start));
+            evaluated += stats.evaluated;
+            changed += stats.changed;
+            mostDeferred = std::max(mostDeferred, stats.deferred);
+        }
+        result.metrics = {
+            {"ticks", static_cast<double>(result.samplesMs.size())},
+            {"evaluations", static_cast<double>(evaluated)},
+            {"changes", static_cast<double>(changed)},
+            {"most_deferred", static_cast<double>(mostDeferred)},
+        };
+        return result;
+    };
+
+    // Wake every fluid block once, as if the whole world had just been edited.
+    size_t fluidBlocks = 0;
+    for (const auto& [pos, column] : world.columns()) {
+        for (int y = 0; y < Column::HEIGHT; y++) {
+            for (int z = 0; z < Section::SIZE; z++) {
+                for (int x = 0; x < Section::SIZE; x++) {
+                    const BlockId block = column.get(x, y, z);
+                    if (block == WATER || block == LAVA) {
+                        fluids.notifyChanged({pos.x * Section::SIZE + x, y, pos.z * Section::SIZE + z});
+                        fluidBlocks++;
+                    }
+                }
+            }
+        }
+    }
+    BenchHarness::Result settled = settle("fluids/settle");
+    settled.metrics.emplace_back("fluid_blocks", static_cast<double>(fluidBlocks));
+    if (settleSelected) {
+        harness.record(std::move(settled));
+    }
+
+    // Resting fluid must cost nothing.
+    BenchHarness::Result resting = sampledResult("fluids/rest", "tick", 1);
+    size_t restEvaluated = 0;
+    for (int tick = 0; tick < 600; tick++) {
+        const auto start = std::chrono::steady_clock::now();
+        restEvaluated += fluids.tick(BUDGET).evaluated;
+        resting.samplesMs.push_back(millisecondsSince(start));
+    }
+    checks.expect(restEvaluated == 0, "fluids/rest: settled fluid is still being evaluated");
+    resting.metrics = {{"evaluations", static_cast<double>(restEvaluated)}};
+    if (restSelected) {
+        harness.record(std::move(resting));
+    }
+
+    // A pool of water sources on the highest ground, and lava a little way off.
+    int32_t peakX = 0;
+    int32_t peakZ = 0;
+    const int32_t extent = RADIUS * Section::SIZE;
+    for (int32_t z = -extent; z < extent; z++) {
+        for (int32_t x = -extent; x < extent; x++) {
+            if (terrain.surfaceHeight(x, z) > terrain.surfaceHeight(peakX, peakZ)) {
+                peakX = x;
+                peakZ = z;
+            }
+        }
+    }
+    const int32_t peakY = terrain.surfaceHeight(peakX, peakZ) + 1;
+    for (int32_t dz = -3; dz <= 3; dz++) {
+        for (int32_t dx = -3; dx <= 3; dx++) {
+            world.setBlock(peakX + dx, peakY + 4, peakZ + dz, dx > 1 ? LAVA : WATER);
+            fluids.notifyChanged({peakX + dx, peakY + 4, peakZ + dz});
+        }
+    }
+    BenchHarness::Result flooded = settle("fluids/flood");
+    checks.expect(flooded.samplesMs.size() < MAX_TICKS, "fluids/flood: the flood never settled");
+    std::vector<SectionPos> dirty;
+    fluids.takeDirtySections(dirty);
+    flooded.metrics.emplace_back("dirty_sections", static_cast<double>(dirty.size()));
+    if (floodSelected) {
+        harness.record(std::move(flooded));
+    }
+}
+
+// Updates spread over a 64x64 column area; each one reschedules itself when it runs, so the
+// queue stays at PENDING entries. The timing wheel against a binary heap with a set for
+// duplicate suppression, on the same random delays.
+void runBlockTicks(BenchHarness& harness, Checks& checks) {
+    constexpr uint32_t PENDING = 500000;
+    constexpr int TICKS = 4000;
+    constexpr uint32_t MAX_DELAY = 2400;
+    auto position = [](uint32_t i) {
+        return BlockPos{static_cast<int32_t>(i % 1024) - 512, static_cast<int32_t>(i / (1024 * 1024)), static_cast<int32_t>((i / 1024) % 1024) - 512};
+    };
+    std::uniform_int_distribution<uint32_t> delay(1, MAX_DELAY);
+    std::vector<ScheduledTick> due;
+
+    const bool wheelSelected = harness.shouldRun("block_ticks/timing_wheel", "macro");
+    size_t wheelRuns = 0;
+    if (wheelSelected) {
+        std::mt19937 rng(99);
+        BlockTickScheduler wheel;
+        const auto scheduleStart = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < PENDING; i++) {
+            wheel.schedule(position(i), 0, delay(rng));
+        }
+        const double scheduleMs = millisecondsSince(scheduleStart);
+        // About PENDING over the mean delay run each tick.
+        BenchHarness::Result result = sampledResult("block_ticks/timing_wheel", "update", PENDING / (MAX_DELAY / 2));
+        for (int tick = 0; tick < TICKS; tick++) {
+            const auto start = std::chrono::steady_clock::now();
+            due.clear();
+            wheel.advance(due);
+            wheelRuns += due.size();
+            for (const ScheduledTick& update : due) {
+                wheel.schedule(update.pos, update.type, delay(rng));
+                // Duplicates are dropped.
+                wheel.schedule(update.pos, update.type, 1);
+            }
+            result.samplesMs.push_back(millisecondsSince(start));
+        }
+
+        // A column's updates survive a save and reload.
+        const ColumnPos column{blockToSection(position(0).x), blockToSection(position(0).z)};
+        std::vector<uint8_t> saved;
+        wheel.saveColumn(column, saved);
+        const size_t before = wheel.pendingIn(column);
+        wheel.unloadColumn(column);
+        const size_t unloaded = wheel.pendingIn(column);
+        const bool loaded = wheel.loadColumn(column, saved.data(), saved.size());
+        checks.expect(loaded && unloaded == 0 && wheel.pendingIn(column) == before,
+            "block_ticks/timing_wheel: a column's updates did not survive a save and reload");
+        result.metrics = {
+            {"schedule_ms", scheduleMs},
+            {"updates", static_cast<double>(wheelRuns)},
+            {"column_pending", static_cast<double>(before)},
+            {"column_saved_bytes", static_cast<double>(saved.size())},
+        };
+        harness.record(std::move(result));
+    }
+
+    const bool heapSelected = harness.shouldRun("block_ticks/priority_queue", "macro");
+    size_t heapRuns = 0;
+    if (heapSelected) {
+        struct HeapEntry {
+            uint64_t due;
+            uint64_t sequence;
+            BlockPos pos;
+            bool operator>(const HeapEntry& other) const {
+                return due != other.due ? due > other.due : sequence > other.sequence;
+            }
+        };
+        std::mt19937 rng(99);
+        std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+        std::unordered_set<BlockPos, BlockPosHash> pending;
+        uint64_t now = 0;
+        uint64_t sequence = 0;
+        auto schedule = [&](BlockPos pos, uint32_t ticks) {
+            if (pending.insert(pos).second) {
+                heap.push({now + ticks, sequence++, pos});
+            }
+        };
+        const auto scheduleStart = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < PENDING; i++) {
+            schedule(position(i), delay(rng));
+        }
+        const double scheduleMs = millisecondsSince(scheduleStart);
+        BenchHarness::Result result = sampledResult("block_ticks/priority_queue", "update", PENDING / (MAX_DELAY / 2));
+        for (int tick = 0; tick < TICKS; tick++) {
+            const auto start = std::chrono::steady_clock::now();
+            now++;
+            due.clear();
+            while (!heap.empty() && heap.top().due <= now) {
+                due.push_back({heap.top().pos, 0, heap.top().due});
+                pending.erase(heap.top().pos);
+                heap.pop();
+            }
+            heapRuns += due.size();
+            for (const ScheduledTick& update : due) {
+                schedule(update.pos, delay(rng));
+                schedule(update.pos, 1);
+            }
+            result.samplesMs.push_back(millisecondsSince(start));
+        }
+        result.metrics = {{"schedule_ms", scheduleMs}, {"updates", static_cast<double>(heapRuns)}};
+        harness.record(std::move(result));
+    }
+    if (wheelSelected && heapSelected) {
+        checks.expect(wheelRuns == heapRuns, "block_ticks: the timing wheel and the priority queue ran different updates");
+    }
+}
+
+void runRandomTicks(BenchHarness& harness, const TerrainGenerator& terrain, JobSystem& jobs, Checks& checks) {
+    constexpr int RADIUS = 16;
+    constexpr int TICKS = 200;
+
+    // The generator places grass but no bare dirt or trees, so strip the grass off every
+    // fourth column and hang unsupported leaves over others to give the ticks work.
+    auto prepare = [&terrain](World& world) {
+        generateTestWorld(world, terrain, RADIUS);
+        for (const auto& [pos, column] : world.columns()) {
+            for (int z = 0; z < Section::SIZE; z++) {
+                for (int x = 0; x < Section::SIZE; x++) {
+                    const int32_t bx = pos.x * Section::SIZE + x;
+                    const int32_t bz = pos.z * Section::SIZE + z;
+                    for (int y = Column::HEIGHT - 1; y >= 0; y--) {
+                        if (world.getBlock(bx, y, bz) != GRASS) {
+                            continue;
+                        }
+                        if ((pos.x + pos.z) % 4 == 0) {
+                            world.setBlock(bx, y, bz, DIRT);
+                        } else if ((pos.x - pos.z) % 5 == 0 && y + 6 < Column::HEIGHT) {
+                            world.setBlock(bx, y + 6, bz, LEAVES);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    };
+
+    // Every section, one block at a time: the draw, the lookup and the dispatch per position.
+    if (harness.shouldRun("random_ticks/per_block", "macro")) {
+        World world;
+        prepare(world);
+        std::mt19937 rng(7);
+        size_t changed = 0;
+        BenchHarness::Result result = sampledResult("random_ticks/per_block", "section", world.columnCount() * Column::SECTIONS);
+        for (int tick = 0; tick < TICKS; tick++) {
+            const auto start = std::chrono::steady_clock::now();
+            for (const auto& [pos, column] : world.columns()) {
+                for (int sy = 0; sy < Column::SECTIONS; sy++) {
+                    for (int i = 0; i < RandomTickEngine::TICKS_PER_SECTION; i++) {
+                        const uint32_t random = rng();
+                        const int x = static_cast<int>(random & 15);
+                        const int z = static_cast<int>((random >> 4) & 15);
+                        const int y = static_cast<int>((random >> 8) & 15);
+                        const BlockPos blockPos{pos.x * Section::SIZE + x, sy * Section::SIZE + y, pos.z * Section::SIZE + z};
+                        const BlockId block = column.section(sy).get(x, y, z);
+                        changed += RandomTickEngine::randomTick(world, blockPos, block, random >> 12).has_value() ? 1 : 0;
+                    }
+                }
+            }
+            result.samplesMs.push_back(millisecondsSince(start));
+        }
+        checks.expect(changed > 0, "random_ticks/per_block: no block changed");
+        result.metrics = {{"changes", static_cast<double>(changed)}};
+        harness.record(std::move(result));
+    }
+
+    if (harness.shouldRun("random_ticks/engine", "macro")) {
+        World world;
+        prepare(world);
+        RandomTickEngine engine(7);
+        RandomTickEngine::TickStats total;
+        BenchHarness::Result result = sampledResult("random_ticks/engine", "section", world.columnCount() * Column::SECTIONS);
+        for (int tick = 0; tick < TICKS; tick++) {
+            const auto start = std::chrono::steady_clock::now();
+            const RandomTickEngine::TickStats stats = engine.tick(world, jobs);
+            result.samplesMs.push_back(millisecondsSince(start));
+            total.sections += stats.sections;
+            total.skipped += stats.skipped;
+            total.ticked += stats.ticked;
+            total.changed += stats.changed;
+        }
+        std::vector<SectionPos> dirty;
+        engine.takeDirtySections(dirty);
+        checks.expect(total.changed > 0, "random_ticks/engine: no block changed");
+        result.metrics = {
+            {"skipped_by_palette", static_cast<double>(total.skipped) / static_cast<double>(total.sections)},
+            {"ticked", static_cast<double>(total.ticked)},
+            {"changes", static_cast<double>(total.changed)},
+            {"dirty_sections", static_cast<double>(dirty.size())},
+        };
+        harness.record(std::move(result));
+    }
+}
+
+// Fills the view standing still, then flies in a wide circle so the heading keeps turning, one
+// sample per streamer update. Once the camera stops everything in range ends up meshed and
+// nothing else stays loaded.
+void runStreaming(BenchHarness& harness, const TerrainGenerator& terrain, JobSystem& jobs, Checks& checks) {
+    constexpr int RADIUS = 12;
+    constexpr int FRAMES = 600;
+    // Blocks per frame: about 8 columns a second at 60 fps, faster than generation keeps up with.
+    constexpr float SPEED = 2.0f;
+    const std::string name = "streaming/circle";
+    if (!harness.shouldRun(name, "macro")) {
+        return;
+    }
+
+    World world;
+    ChunkStreamer streamer(world, terrain, jobs);
+    streamer.setRadius(RADIUS);
+    const ChunkStreamer::Budget budget;
+    streamer.setBudget(budget);
+    std::unordered_set<ColumnPos, ColumnPosHash> meshed;
+    auto mesh = [&meshed](ColumnPos pos) { meshed.insert(pos); };
+    auto unload = [&meshed](ColumnPos pos) {
+        meshed.erase(pos);
+        return true;
+    };
+
+    const auto fillStart = std::chrono::steady_clock::now();
+    int fillFrames = 0;
+    for (; fillFrames < 100000 && !streamer.idle(); fillFrames++) {
+        streamer.update(8.0f, 8.0f, 0.0f, -1.0f, mesh, unload);
+    }
+    const double fillMs = millisecondsSince(fillStart);
+    const size_t fillColumns = world.columnCount();
+
+    BenchHarness::Result result = sampledResult(name, "frame", 1);
+    ChunkStreamer::Stats totals;
+    float x = 8.0f;
+    float z = 8.0f;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        const float heading = static_cast<float>(frame) * 0.005f;
+        const float forwardX = std::sin(heading);
+        const float forwardZ = -std::cos(heading);
+        x += forwardX * SPEED;
+        z += forwardZ * SPEED;
+        const auto start = std::chrono::steady_clock::now();
+        totals += streamer.update(x, z, forwardX, forwardZ, mesh, unload);
+        result.samplesMs.push_back(millisecondsSince(start));
+    }
+
+    int settleFrames = 0;
+    for (; settleFrames < 100000 && !streamer.idle(); settleFrames++) {
+        streamer.update(x, z, 0.0f, -1.0f, mesh, unload);
+    }
+    const ColumnPos center{blockToSection(static_cast<int32_t>(std::floor(x))), blockToSection(static_cast<int32_t>(std::floor(z)))};
+    size_t missing = 0;
+    for (int dz = -RADIUS; dz <= RADIUS; dz++) {
+        for (int dx = -RADIUS; dx <= RADIUS; dx++) {
+            if (dx * dx + dz * dz <= RADIUS * RADIUS && meshed.count({center.x + dx, center.z + dz}) == 0) {
+                missing++;
+            }
+        }
+    }
+    checks.expect(missing == 0, "streaming/circle: columns in range were never meshed");
+
+    // Rates at 60 fps.
+    const double seconds = FRAMES / 60.0;
+    result.metrics = {
+        {"budget_ms", budget.generateMs + budget.meshMs + budget.unloadMs},
+        {"frame_p99_ms", BenchHarness::percentile(result.samplesMs, 0.99)},
+        {"fill_columns", static_cast<double>(fillColumns)},
+        {"fill_frames", static_cast<double>(fillFrames)},
+        {"fill_ms", fillMs},
+        {"generated_per_second", static_cast<double>(totals.generated) / seconds},
+        {"meshed_per_second", static_cast<double>(totals.meshed) / seconds},
+        {"unloaded_per_second", static_cast<double>(totals.unloaded) / seconds},
+        {"cancelled", static_cast<double>(totals.cancelled)},
+        {"settle_frames", static_cast<double>(settleFrames)},
+        {"missing_in_range", static_cast<double>(missing)},
+    };
+    harness.record(std::move(result));
+}
+
+void registerColumnCodec(BenchHarness& harness, const World& world, Checks& checks) {
+    harness.run("column_cache/decode_column", "micro", "column", [&world, &checks]() -> BenchHarness::Body {
+        auto encoded = std::make_shared<std::vector<std::vector<uint8_t>>>();
+        size_t mismatched = 0;
+        for (const auto& [pos, column] : world.columns()) {
+            std::vector<uint8_t>& bytes = encoded->emplace_back();
+            encodeColumn(column, bytes);
+            Column decoded;
+            if (!decodeColumn(bytes.data(), bytes.size(), decoded)) {
+                mismatched++;
+                continue;
+            }
+            for (int sy = 0; sy < Column::SECTIONS; sy++) {
+                for (int i = 0; i < Section::VOLUME; i++) {
+                    if (column.section(sy).getIndex(i) != decoded.section(sy).getIndex(i)) {
+                        mismatched++;
+                        break;
+                    }
+                }
+            }
+        }
+        checks.expect(mismatched == 0, "column_cache/decode_column: a column changed in an encode and decode");
+        return [encoded]() {
+            for (const std::vector<uint8_t>& bytes : *encoded) {
+                Column decoded;
+                decodeColumn(bytes.data(), bytes.size(), decoded);
+                BenchHarness::consume(decoded.get(0, 64, 0));
+            }
+            return encoded->size();
+        };
+    });
+}
+
+// Back and forth along a path, once generating every column, once with the cache and once with
+// a budget too small for the path, which evicts and still serves what it holds.
+void runColumnCache(BenchHarness& harness, const TerrainGenerator& terrain, JobSystem& jobs, Checks& checks) {
+    constexpr int RADIUS = 8;
+    constexpr float SPEED = 4.0f;
+    constexpr float PATH = 480.0f;
+    constexpr int TRIPS = 3;
+    constexpr size_t BUDGET = 32ull << 20;
+    constexpr size_t SMALL_BUDGET = 256 << 10;
+
+    auto fly = [&](const std::string& name, ColumnCache* cache) {
+        World streamed;
+        ChunkStreamer streamer(streamed, terrain, jobs);
+        streamer.setRadius(RADIUS);
+        streamer.setCache(cache);
+        auto mesh = [](ColumnPos) {};
+        auto unload = [](ColumnPos) { return true; };
+        ChunkStreamer::Stats totals;
+        BenchHarness::Result result = sampledResult(name, "frame", 1);
+        float x = 8.0f;
+        float direction = 1.0f;
+        for (int leg = 0; leg < TRIPS * 2; leg++) {
+            for (float travelled = 0.0f; travelled < PATH; travelled += SPEED) {
+                x += direction * SPEED;
+                const auto start = std::chrono::steady_clock::now();
+                totals += streamer.update(x, 8.0f, direction, 0.0f, mesh, unload);
+                result.samplesMs.push_back(millisecondsSince(start));
+            }
+            direction = -direction;
+        }
+        result.metrics = {
+            {"loaded", static_cast<double>(totals.generated)},
+            {"from_cache", static_cast<double>(totals.cached)},
+            {"load_ms_per_column", totals.generateMs / static_cast<double>(std::max<size_t>(totals.generated, 1))},
+            {"left_queued", static_cast<double>(totals.generateQueue)},
+        };
+        if (cache != nullptr) {
+            const ColumnCache::Stats& stats = cache->stats();
+            result.metrics.insert(result.metrics.end(), {
+                {"cache_bytes", static_cast<double>(stats.bytes)},
+                {"cache_entries", static_cast<double>(stats.entries)},
+                {"hit_rate", stats.blockHitRate()},
+                {"evictions", static_cast<double>(stats.evictions)},
+            });
+        }
+        harness.record(std::move(result));
+        return totals;
+    };
+
+    if (harness.shouldRun("column_cache/fly_uncached", "macro")) {
+        fly("column_cache/fly_uncached", nullptr);
+    }
+    if (harness.shouldRun("column_cache/fly_cached", "macro")) {
+        ColumnCache cache(BUDGET);
+        checks.expect(fly("column_cache/fly_cached", &cache).cached > 0, "column_cache/fly_cached: nothing came from the cache");
+    }
+    if (harness.shouldRun("column_cache/fly_small_budget", "macro")) {
+        ColumnCache small(SMALL_BUDGET);
+        fly("column_cache/fly_small_budget", &small);
+        checks.expect(small.stats().bytes <= SMALL_BUDGET, "column_cache/fly_small_budget: the cache outgrew its budget");
+    }
+}
+
+// Random ticks plus scattered edits, each of which may land in a section being saved: ticks
+// with no save, the save done on the tick thread for comparison, and ticks while the save
+// thread writes with the snapshot counted against its tick. What was saved must be what the
+// world held at the snapshot, whatever changed after it.
+void runAutosave(BenchHarness& harness, const TerrainGenerator& terrain, JobSystem& jobs, Checks& checks) {
+    constexpr int RADIUS = 16;
+    constexpr size_t TICKS = 200;
+    constexpr int WRITES_PER_TICK = 256;
+    const bool idleSelected = harness.shouldRun("autosave/no_save", "macro");
+    const bool blockingSelected = harness.shouldRun("autosave/blocking_save", "macro");
+    const bool backgroundSelected = harness.shouldRun("autosave/during_save", "macro");
+    if (!idleSelected && !blockingSelected && !backgroundSelected) {
+        return;
+    }
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "minecraft-bench-autosave";
+    std::filesystem::remove_all(directory);
+    World world;
+    generateTestWorld(world, terrain, RADIUS);
+    RandomTickEngine engine(7);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int32_t> horizontal(-RADIUS * Section::SIZE, (RADIUS + 1) * Section::SIZE - 1);
+    std::uniform_int_distribution<int32_t> vertical(0, Column::HEIGHT - 1);
+    std::vector<SectionPos> dirty;
+    auto tick = [&]() {
+        engine.tick(world, jobs);
+        for (int i = 0; i < WRITES_PER_TICK; i++) {
+            world.setBlock(horizontal(rng), vertical(rng), horizontal(rng), i % 2 == 0 ? STONE : AIR);
+        }
+        engine.takeDirtySections(dirty);
+        dirty.clear();
+    };
+
+    BenchHarness::Result idle = sampledResult("autosave/no_save", "tick", 1);
+    while (idle.samplesMs.size() < TICKS) {
+        const auto start = std::chrono::steady_clock::now();
+        tick();
+        idle.samplesMs.push_back(millisecondsSince(start));
+    }
+    const double idleMaxMs = *std::max_element(idle.samplesMs.begin(), idle.samplesMs.end());
+    if (idleSelected) {
+        harness.record(std::move(idle));
+    }
+
+    WorldSaver saver(directory.string());
+    const auto blockingStart = std::chrono::steady_clock::now();
+    saver.save(world);
+    saver.wait();
+    const double blockingMs = millisecondsSince(blockingStart);
+    const WorldSaver::SaveStats first = saver.lastSave();
+    BenchHarness::Result blocking = sampledResult("autosave/blocking_save", "column", first.columns);
+    blocking.samplesMs.push_back(blockingMs);
+    blocking.metrics = {{"regions", static_cast<double>(first.regions)}, {"bytes", static_cast<double>(first.bytes)}};
+    if (blockingSelected) {
+        harness.record(std::move(blocking));
+    }
+
+    BenchHarness::Result background = sampledResult("autosave/during_save", "tick", 1);
+    while (background.samplesMs.size() < TICKS) {
+        const auto start = std::chrono::steady_clock::now();
+        if (background.samplesMs.empty()) {
+            saver.save(world);
+        }
+        tick();
+        background.samplesMs.push_back(millisecondsSince(start));
+        if (background.samplesMs.size() > 1 && !saver.busy()) {
+            break;
+        }
+    }
+    saver.wait();
+    const WorldSaver::SaveStats written = saver.lastSave();
+    background.metrics = {
+        {"snapshot_ms", written.snapshotMs},
+        {"write_ms", written.writeMs},
+        {"worst_tick_over_no_save_ms", *std::max_element(background.samplesMs.begin(), background.samplesMs.end()) - idleMaxMs},
+    };
+    if (backgroundSelected) {
+        harness.record(std::move(background));
+    }
+
+    const World::ColumnMap expected = world.columns();
+    saver.save(world);
+    for (int i = 0; i < 20; i++) {
+        tick();
+    }
+    saver.wait();
+    size_t mismatched = 0;
+    for (const auto& [pos, column] : expected) {
+        Column loaded;
+        if (!saver.loadColumn(pos, loaded)) {
+            mismatched++;
+            continue;
+        }
+        for (int sy = 0; sy < Column::SECTIONS; sy++) {
+            bool same = true;
+            for (int i = 0; i < Section::VOLUME && same; i++) {
+                same = column.section(sy).getIndex(i) == loaded.section(sy).getIndex(i);
+            }
+            mismatched += same ? 0 : 1;
+        }
+    }
+    checks.expect(mismatched == 0, "autosave: a saved section differs from the world at its snapshot");
+    std::filesystem::remove_all(directory);
+}
+
+int usage(const char* program) {
+    std::fprintf(stderr, "usage: %s [--warmup N] [--repetitions N] [--filter SUBSTRING] [--list] [--out FILE]\n"
+        "       [--flythrough-seconds S] [--baseline FILE [--threshold FRACTION]]\n", program);
+    return 2;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchHarness::Options options;
+    const char* outPath = nullptr;
+    const char* baselinePath = nullptr;
+    double threshold = 0.10;
+    double flythroughSeconds = 30.0;
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+            outPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--flythrough-seconds") == 0 && hasValue) {
+            flythroughSeconds = std::max(1.0, std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue) {
+            baselinePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue) {
+            threshold = std::max(0.0, std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            options.listOnly = true;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    TerrainGenerator terrain(SEED);
+    World world;
+    generateTestWorld(world, terrain, WORLD_RADIUS);
+    JobSystem jobs;
+    BenchHarness harness(options);
+    Checks checks;
+
+    registerNoise(harness, terrain);
+    registerPalette(harness, world);
+    registerMeshing(harness, world);
+    registerRegionIo(harness, world);
+    registerColumnCodec(harness, world, checks);
+    registerEcs(harness, jobs, checks);
+    registerRaycast(harness, terrain, jobs, checks);
+    runCollision(harness, terrain, jobs, checks);
+    runFluids(harness, terrain, checks);
+    runBlockTicks(harness, checks);
+    runRandomTicks(harness, terrain, jobs, checks);
+    runStreaming(harness, terrain, jobs, checks);
+    runColumnCache(harness, terrain, jobs, checks);
+    runAutosave(harness, terrain, jobs, checks);
+    registerFrames(harness, terrain, jobs);
+    runFlythrough(harness, terrain, jobs, flythroughSeconds);
+    if (options.listOnly) {
+        return 0;
+    }
+
+    std::FILE* out = outPath != nullptr ? std::fopen(outPath, "w") : stdout;
+    if (out == nullptr) {
+        std::fprintf(stderr, "failed to open %s\n", outPath);
+        return 1;
+    }
+    harness.writeJson(out, jobs.workerCount());
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    if (checks.failed() > 0) {
+        std::fprintf(stderr, "%d check%s failed\n", checks.failed(), checks.failed() == 1 ? "" : "s");
+    }
+    // Exits with 1 when anything regressed past the threshold, so scripts can gate on it.
+    if (baselinePath != nullptr) {
+        const int regressions = harness.compareToBaseline(baselinePath, threshold);
+        if (regressions < 0) {
+            std::fprintf(stderr, "failed to read baseline %s\n", baselinePath);
+            return 1;
+        }
+        std::fprintf(stderr, "%d regression%s beyond %.0f%%\n", regressions, regressions == 1 ? "" : "s", 100.0 * threshold);
+        return regressions > 0 || checks.failed() > 0 ? 1 : 0;
+    }
+    return checks.failed() > 0 ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+using BlockId = uint16_t;
+
+enum Block : BlockId {
+    AIR = 0,
+    STONE,
+    DIRT,
+    GRASS,
+    SAND,
+    WATER,
+    LAVA,
+    LOG,
+    LEAVES,
+    GLASS,
+    BLOCK_COUNT
+};
+
+struct BlockInfo {
+    const char* name;
+    bool opaque;
+    float color[3];
+};
+
+inline constexpr BlockInfo BLOCK_INFO[BLOCK_COUNT] = {
+    {"air",    false, {0.0f, 0.0f, 0.0f}},
+    {"stone",  true,  {0.50f, 0.50f, 0.50f}},
+    {"dirt",   true,  {0.45f, 0.30f, 0.18f}},
+    {"grass",  true,  {0.30f, 0.60f, 0.20f}},
+    {"sand",   true,  {0.86f, 0.80f, 0.55f}},
+    {"water",  false, {0.15f, 0.30f, 0.80f}},
+    {"lava",   false, {0.90f, 0.35f, 0.05f}},
+    {"log",    true,  {0.40f, 0.28f, 0.15f}},
+    {"leaves", false, {0.18f, 0.45f, 0.15f}},
+    {"glass",  false, {0.80f, 0.90f, 0.95f}},
+};
+
+inline const BlockInfo& blockInfo(BlockId id) {
+    return BLOCK_INFO[id < BLOCK_COUNT ? id : static_cast<BlockId>(AIR)];
+}
+
+inline bool isOpaque(BlockId id) {
+    return blockInfo(id).opaque;
+}
@@ -0,0 +1,222 @@
+#include "BlockTickScheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+// Saved update: x and z within the column, y, type and delay, little-endian.
+constexpr size_t SAVED_TICK_BYTES = 1 + 1 + 2 + 2 + 4;
+
+void writeLe(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t readLe(const uint8_t* data, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+ColumnPos columnOf(BlockPos pos) {
+    return {blockToSection(pos.x), blockToSection(pos.z)};
+}
+
+}
+
+BlockTickScheduler::BlockTickScheduler() : mSlots(static_cast<size_t>(LEVELS) * WHEEL_SLOTS) {}
+
+uint32_t BlockTickScheduler::slotFor(uint64_t due) const {
+    // The level is set by the highest bit where due differs from now, so an update only
+    // reaches level 0 once it is less than WHEEL_SLOTS ticks away and lower slots never wrap.
+    const uint64_t differs = due ^ mNow;
+    int level = 0;
+    while (level < LEVELS - 1 && (differs >> (WHEEL_BITS * (level + 1))) != 0) {
+        level++;
+    }
+    const auto slot = static_cast<uint32_t>((due >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+    return static_cast<uint32_t>(level) * WHEEL_SLOTS + slot;
+}
+
+void BlockTickScheduler::linkSlot(uint32_t index) {
+    Node& node = mNodes[index];
+    node.slot = slotFor(node.tick.due);
+    List& list = mSlots[node.slot];
+    node.prev = list.tail;
+    node.next = NONE;
+    if (list.tail != NONE) {
+        mNodes[list.tail].next = index;
+    } else {
+        list.head = index;
+    }
+    list.tail = index;
+}
+
+void BlockTickScheduler::unlinkSlot(uint32_t index) {
+    Node& node = mNodes[index];
+    List& list = mSlots[node.slot];
+    (node.prev != NONE ? mNodes[node.prev].next : list.head) = node.next;
+    (node.next != NONE ? mNodes[node.next].prev : list.tail) = node.prev;
+    node.prev = NONE;
+    node.next = NONE;
+}
+
+bool BlockTickScheduler::schedule(BlockPos pos, uint16_t type, uint32_t delay) {
+    auto [it, inserted] = mIndex.try_emplace(Key{pos, type}, NONE);
+    if (!inserted) {
+        return false;
+    }
+    uint32_t index;
+    if (!mFreeNodes.empty()) {
+        index = mFreeNodes.back();
+        mFreeNodes.pop_back();
+    } else {
+        index = static_cast<uint32_t>(mNodes.size());
+        mNodes.emplace_back();
+    }
+    it->second = index;
+    Node& node = mNodes[index];
+    node.tick = {pos, type, mNow + std::clamp<uint32_t>(delay, 1, MAX_DELAY)};
+    linkSlot(index);
+
+    auto [region, created] = mRegionOfColumn.try_emplace(columnOf(pos), NONE);
+    if (created) {
+        if (!mFreeRegions.empty()) {
+            region->second = mFreeRegions.back();
+            mFreeRegions.pop_back();
+        } else {
+            region->second = static_cast<uint32_t>(mRegions.size());
+            mRegions.emplace_back();
+        }
+        mRegions[region->second] = {region->first, {}};
+    }
+    node.region = region->second;
+    List& column = mRegions[node.region].updates;
+    node.columnPrev = column.tail;
+    node.columnNext = NONE;
+    if (column.tail != NONE) {
+        mNodes[column.tail].columnNext = index;
+    } else {
+        column.head = index;
+    }
+    column.tail = index;
+    return true;
+}
+
+void BlockTickScheduler::remove(uint32_t index) {
+    unlinkSlot(index);
+    Node& node = mNodes[index];
+    Region& region = mRegions[node.region];
+    (node.columnPrev != NONE ? mNodes[node.columnPrev].columnNext : region.updates.head) = node.columnNext;
+    (node.columnNext != NONE ? mNodes[node.columnNext].columnPrev : region.updates.tail) = node.columnPrev;
+    if (region.updates.head == NONE) {
+        mRegionOfColumn.erase(region.column);
+        mFreeRegions.push_back(node.region);
+    }
+    node.region = NONE;
+    mIndex.erase(Key{node.tick.pos, node.tick.type});
+    node.slot = NONE;
+    mFreeNodes.push_back(index);
+}
+
+bool BlockTickScheduler::cancel(BlockPos pos, uint16_t type) {
+    auto it = mIndex.find(Key{pos, type});
+    if (it == mIndex.end()) {
+        return false;
+    }
+    remove(it->second);
+    return true;
+}
+
+bool BlockTickScheduler::isScheduled(BlockPos pos, uint16_t type) const {
+    return mIndex.count(Key{pos, type}) != 0;
+}
+
+void BlockTickScheduler::advance(std::vector<ScheduledTick>& due) {
+    mNow++;
+    // Each level whose lower digits just rolled over hands its current slot down.
+    for (int level = 1; level < LEVELS; level++) {
+        if ((mNow & ((1ull << (WHEEL_BITS * level)) - 1)) != 0) {
+            break;
+        }
+        List& list = mSlots[static_cast<size_t>(level) * WHEEL_SLOTS + ((mNow >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1))];
+        uint32_t index = list.head;
+        list = {};
+        while (index != NONE) {
+            const uint32_t next = mNodes[index].next;
+            linkSlot(index);
+            index = next;
+        }
+    }
+
+    const List& slot = mSlots[mNow & (WHEEL_SLOTS - 1)];
+    while (slot.head != NONE) {
+        const uint32_t index = slot.head;
+        due.push_back(mNodes[index].tick);
+        remove(index);
+    }
+}
+
+uint32_t BlockTickScheduler::firstIn(ColumnPos column) const {
+    auto it = mRegionOfColumn.find(column);
+    return it != mRegionOfColumn.end() ? mRegions[it->second].updates.head : NONE;
+}
+
+size_t BlockTickScheduler::pendingIn(ColumnPos column) const {
+    size_t count = 0;
+    for (uint32_t index = firstIn(column); index != NONE; index = mNodes[index].columnNext) {
+        count++;
+    }
+    return count;
+}
+
+void BlockTickScheduler::saveColumn(ColumnPos column, std::vector<uint8_t>& out) const {
+    const size_t countOffset = out.size();
+    writeLe(out, 0, 4);
+    uint32_t count = 0;
+    for (uint32_t index = firstIn(column); index != NONE; index = mNodes[index].columnNext) {
+        const ScheduledTick& tick = mNodes[index].tick;
+        writeLe(out, static_cast<uint64_t>(blockInSection(tick.pos.x)), 1);
+        writeLe(out, static_cast<uint64_t>(blockInSection(tick.pos.z)), 1);
+        writeLe(out, static_cast<uint64_t>(tick.pos.y) & 0xFFFF, 2);
+        writeLe(out, tick.type, 2);
+        writeLe(out, tick.due - mNow, 4);
+        count++;
+    }
+    for (int i = 0; i < 4; i++) {
+        out[countOffset + i] = static_cast<uint8_t>(count >> (8 * i));
+    }
+}
+
+bool BlockTickScheduler::loadColumn(ColumnPos column, const uint8_t* data, size_t size) {
+    if (size < 4) {
+        return false;
+    }
+    const uint64_t count = readLe(data, 4);
+    if (size != 4 + count * SAVED_TICK_BYTES) {
+        return false;
+    }
+    const uint8_t* record = data + 4;
+    for (uint64_t i = 0; i < count; i++, record += SAVED_TICK_BYTES) {
+        const BlockPos pos{
+            column.x * Section::SIZE + static_cast<int32_t>(record[0] & (Section::SIZE - 1)),
+            static_cast<int16_t>(readLe(record + 2, 2)),
+            column.z * Section::SIZE + static_cast<int32_t>(record[1] & (Section::SIZE - 1)),
+        };
+        schedule(pos, static_cast<uint16_t>(readLe(record + 4, 2)), static_cast<uint32_t>(readLe(record + 6, 4)));
+    }
+    return true;
+}
+
+void BlockTickScheduler::unloadColumn(ColumnPos column) {
+    uint32_t index = firstIn(column);
+    while (index != NONE) {
+        // remove() releases the region along with its last update.
+        const uint32_t next = mNodes[index].columnNext;
+        remove(index);
+        index = next;
+    }
+}
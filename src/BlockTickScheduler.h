@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "World.h"
+
+struct ScheduledTick {
+    BlockPos pos;
+    // What to run, defined by the caller (fluid flow, crop growth, ...).
+    uint16_t type;
+    uint64_t due;
+};
+
+// Delayed block updates in a hierarchical timing wheel: four levels of 256 slots, each level
+// covering 256 times the span of the one below. Scheduling links an update into one slot and
+// a tick expires one slot, so both are O(1); every 256^n ticks the current slot of level n is
+// redistributed to the levels below.
+//
+// Updates are also linked into a list per column so a column's pending updates can be saved,
+// loaded and dropped with it. A block has at most one pending update of each type.
+class BlockTickScheduler {
+    public:
+        static constexpr int WHEEL_BITS = 8;
+        static constexpr int WHEEL_SLOTS = 1 << WHEEL_BITS;
+        static constexpr int LEVELS = 4;
+        // Longer delays are clamped; the top level must never be asked to wrap.
+        static constexpr uint32_t MAX_DELAY = static_cast<uint32_t>(WHEEL_SLOTS - 1) << (WHEEL_BITS * (LEVELS - 1));
+
+        BlockTickScheduler();
+
+        // Runs the update delay ticks from now, clamped to [1, MAX_DELAY]. Returns false, keeping
+        // the existing due tick, when the block already has an update of this type pending.
+        bool schedule(BlockPos pos, uint16_t type, uint32_t delay);
+        bool cancel(BlockPos pos, uint16_t type);
+        [[nodiscard]] bool isScheduled(BlockPos pos, uint16_t type) const;
+
+        // Moves to the next tick and appends the updates due on it, in the order they were scheduled.
+        void advance(std::vector<ScheduledTick>& due);
+
+        [[nodiscard]] uint64_t now() const { return mNow; }
+        [[nodiscard]] size_t size() const { return mIndex.size(); }
+        [[nodiscard]] size_t pendingIn(ColumnPos column) const;
+
+        // Appends the column's pending updates with delays relative to now, so they resume
+        // where they left off whenever the column is loaded again.
+        void saveColumn(ColumnPos column, std::vector<uint8_t>& out) const;
+        // Schedules updates written by saveColumn(). Returns false if the data is malformed.
+        bool loadColumn(ColumnPos column, const uint8_t* data, size_t size);
+        void unloadColumn(ColumnPos column);
+
+    private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        struct Node {
+            ScheduledTick tick;
+            // Position in its wheel slot and in its column's list.
+            uint32_t prev = NONE;
+            uint32_t next = NONE;
+            uint32_t columnPrev = NONE;
+            uint32_t columnNext = NONE;
+            uint32_t slot = NONE;
+            uint32_t region = NONE;
+        };
+
+        struct List {
+            uint32_t head = NONE;
+            uint32_t tail = NONE;
+        };
+
+        // A column with pending updates.
+        struct Region {
+            ColumnPos column;
+            List updates;
+        };
+
+        struct Key {
+            BlockPos pos;
+            uint16_t type;
+
+            bool operator==(const Key& other) const {
+                return pos == other.pos && type == other.type;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const {
+                return BlockPosHash()(key.pos) ^ (static_cast<size_t>(key.type) * 0x9E3779B97F4A7C15ull);
+            }
+        };
+
+        [[nodiscard]] uint32_t slotFor(uint64_t due) const;
+        [[nodiscard]] uint32_t firstIn(ColumnPos column) const;
+        void linkSlot(uint32_t node);
+        void unlinkSlot(uint32_t node);
+        void remove(uint32_t node);
+
+        std::vector<Node> mNodes;
+        std::vector<uint32_t> mFreeNodes;
+        // LEVELS * WHEEL_SLOTS lists, level-major.
+        std::vector<List> mSlots;
+        std::vector<Region> mRegions;
+        std::vector<uint32_t> mFreeRegions;
+        std::unordered_map<ColumnPos, uint32_t, ColumnPosHash> mRegionOfColumn;
+        std::unordered_map<Key, uint32_t, KeyHash> mIndex;
+        uint64_t mNow = 0;
+};
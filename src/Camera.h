@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cmath>
+#include <glm.hpp>
+
+// First-person camera. The projection follows Vulkan's conventions: y points down in clip
+// space and depth runs from 0 at the near plane to 1 at the far one.
+class Camera {
+    public:
+        glm::vec3 position{0.0f};
+        // Radians. Yaw 0 looks down -Z and turns towards +X; positive pitch looks up.
+        float yaw = 0.0f;
+        float pitch = 0.0f;
+        float fovY = glm::radians(70.0f);
+        float nearPlane = 0.1f;
+        float farPlane = 1000.0f;
+
+        [[nodiscard]] glm::vec3 forward() const {
+            return {std::sin(yaw) * std::cos(pitch), std::sin(pitch), -std::cos(yaw) * std::cos(pitch)};
+        }
+
+        // Horizontal, for walking.
+        [[nodiscard]] glm::vec3 right() const {
+            return {std::cos(yaw), 0.0f, std::sin(yaw)};
+        }
+
+        // The view matrix without its translation, i.e. with the camera at the origin.
+        [[nodiscard]] glm::mat4 rotation() const {
+            const glm::vec3 f = forward();
+            const glm::vec3 side = right();
+            const glm::vec3 up = glm::cross(side, f);
+            glm::mat4 view(1.0f);
+            view[0][0] = side.x;
+            view[1][0] = side.y;
+            view[2][0] = side.z;
+            view[0][1] = up.x;
+            view[1][1] = up.y;
+            view[2][1] = up.z;
+            view[0][2] = -f.x;
+            view[1][2] = -f.y;
+            view[2][2] = -f.z;
+            return view;
+        }
+
+        [[nodiscard]] glm::mat4 projection(float aspect) const {
+            const float f = 1.0f / std::tan(0.5f * fovY);
+            glm::mat4 result(0.0f);
+            result[0][0] = f / aspect;
+            result[1][1] = -f;
+            result[2][2] = farPlane / (nearPlane - farPlane);
+            result[2][3] = -1.0f;
+            result[3][2] = nearPlane * farPlane / (nearPlane - farPlane);
+            return result;
+        }
+
+        // World space to clip space, for testing world-space bounds.
+        [[nodiscard]] glm::mat4 viewProjection(float aspect) const {
+            glm::mat4 view = rotation();
+            view[3] = view * glm::vec4(-position, 1.0f);
+            return projection(aspect) * view;
+        }
+
+        // Camera-relative positions (world minus position) to clip space. Vertices are rendered
+        // with this so they keep their precision however far the camera is from the origin.
+        [[nodiscard]] glm::mat4 relativeViewProjection(float aspect) const {
+            return projection(aspect) * rotation();
+        }
+};
@@ -0,0 +1,272 @@
+#include "ChunkStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include "ColumnCache.h"
+#include "ColumnCodec.h"
+#include "JobSystem.h"
+#include "TerrainGenerator.h"
+
+namespace {
+
+constexpr int NEIGHBORS[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+// Turning further than this (about 25 degrees) since the last reorder reorders the queues.
+constexpr float HEADING_REBUILD_DOT = 0.9f;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+ChunkStreamer::Stats& ChunkStreamer::Stats::operator+=(const Stats& other) {
+    generateQueue = other.generateQueue;
+    meshQueue = other.meshQueue;
+    unloadQueue = other.unloadQueue;
+    generated += other.generated;
+    cached += other.cached;
+    meshed += other.meshed;
+    unloaded += other.unloaded;
+    cancelled += other.cancelled;
+    generateMs += other.generateMs;
+    meshMs += other.meshMs;
+    unloadMs += other.unloadMs;
+    return *this;
+}
+
+void ChunkStreamer::setRadius(int radius) {
+    mRadius = std::max(1, radius);
+    mHasCenter = false;
+}
+
+bool ChunkStreamer::isMeshed(ColumnPos pos) const {
+    auto it = mColumns.find(pos);
+    return it != mColumns.end() && it->second.meshed;
+}
+
+bool ChunkStreamer::withinRadius(ColumnPos pos, int radius) const {
+    const int dx = pos.x - mCenter.x;
+    const int dz = pos.z - mCenter.z;
+    return dx * dx + dz * dz <= radius * radius;
+}
+
+float ChunkStreamer::priority(ColumnPos pos) const {
+    const float dx = (static_cast<float>(pos.x) + 0.5f) * Section::SIZE - mCameraX;
+    const float dz = (static_cast<float>(pos.z) + 0.5f) * Section::SIZE - mCameraZ;
+    const float distance = std::sqrt(dx * dx + dz * dz);
+    if (distance < 1.0f) {
+        return 0.0f;
+    }
+    // Columns behind the camera count as twice as far as those straight ahead.
+    const float facing = (dx * mForwardX + dz * mForwardZ) / distance;
+    return distance * (1.5f - 0.5f * facing);
+}
+
+void ChunkStreamer::sortQueue(std::vector<ColumnPos>& queue) const {
+    std::vector<std::pair<float, ColumnPos>> ranked;
+    ranked.reserve(queue.size());
+    for (const ColumnPos& pos : queue) {
+        ranked.emplace_back(priority(pos), pos);
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = 0; i < ranked.size(); i++) {
+        queue[i] = ranked[i].second;
+    }
+}
+
+bool ChunkStreamer::meshable(ColumnPos pos) const {
+    for (const auto& [dx, dz] : NEIGHBORS) {
+        if (mColumns.count({pos.x + dx, pos.z + dz}) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ChunkStreamer::queueIfMeshable(ColumnPos pos) {
+    auto it = mColumns.find(pos);
+    if (it == mColumns.end() || it->second.meshed || it->second.meshQueued || !withinRadius(pos, mRadius) || !meshable(pos)) {
+        return;
+    }
+    it->second.meshQueued = true;
+    mMeshQueue.push_back(pos);
+    mMeshQueueSorted = false;
+}
+
+void ChunkStreamer::rebuildQueues(Stats& stats) {
+    const int loadRadius = mRadius + 1;
+    for (const ColumnPos& pos : mGenerateQueue) {
+        stats.cancelled += withinRadius(pos, loadRadius) ? 0 : 1;
+    }
+    for (const ColumnPos& pos : mMeshQueue) {
+        stats.cancelled += withinRadius(pos, mRadius) ? 0 : 1;
+    }
+
+    mGenerateQueue.clear();
+    for (int dz = -loadRadius; dz <= loadRadius; dz++) {
+        for (int dx = -loadRadius; dx <= loadRadius; dx++) {
+            const ColumnPos pos{mCenter.x + dx, mCenter.z + dz};
+            if (withinRadius(pos, loadRadius) && mColumns.count(pos) == 0) {
+                mGenerateQueue.push_back(pos);
+            }
+        }
+    }
+    sortQueue(mGenerateQueue);
+
+    mMeshQueue.clear();
+    mUnloadQueue.clear();
+    for (auto& [pos, state] : mColumns) {
+        state.meshQueued = false;
+        if (!withinRadius(pos, mRadius + 2)) {
+            mUnloadQueue.push_back(pos);
+        }
+    }
+    for (const auto& [pos, state] : mColumns) {
+        queueIfMeshable(pos);
+    }
+    sortQueue(mMeshQueue);
+    mMeshQueueSorted = true;
+    // Farthest first.
+    sortQueue(mUnloadQueue);
+    std::reverse(mUnloadQueue.begin(), mUnloadQueue.end());
+}
+
+ChunkStreamer::Stats ChunkStreamer::update(float cameraX, float cameraZ, float forwardX, float forwardZ, const MeshFn& mesh,
+                                           const UnloadFn& unload) {
+    Stats stats;
+    mCameraX = cameraX;
+    mCameraZ = cameraZ;
+    const ColumnPos center{blockToSection(static_cast<int32_t>(std::floor(cameraX))), blockToSection(static_cast<int32_t>(std::floor(cameraZ)))};
+    const float length = std::sqrt(forwardX * forwardX + forwardZ * forwardZ);
+    const float fx = length > 0.0f ? forwardX / length : mForwardX;
+    const float fz = length > 0.0f ? forwardZ / length : mForwardZ;
+    if (!mHasCenter || center != mCenter || fx * mForwardX + fz * mForwardZ < HEADING_REBUILD_DOT) {
+        mHasCenter = true;
+        mCenter = center;
+        mForwardX = fx;
+        mForwardZ = fz;
+        rebuildQueues(stats);
+    }
+
+    // Unloading first frees memory and draw slots for what follows.
+    unloadColumns(unload, stats);
+    generate(stats);
+    meshColumns(mesh, stats);
+
+    stats.generateQueue = mGenerateQueue.size();
+    stats.meshQueue = mMeshQueue.size();
+    stats.unloadQueue = mUnloadQueue.size();
+    return stats;
+}
+
+void ChunkStreamer::generate(Stats& stats) {
+    const auto start = std::chrono::steady_clock::now();
+    const size_t batchSize = mJobs.workerCount() + 1;
+    struct Load {
+        ColumnPos pos;
+        Column* column;
+        std::shared_ptr<const std::vector<uint8_t>> cached;
+    };
+    std::vector<Load> batch;
+    bool first = true;
+    while (!mGenerateQueue.empty()) {
+        // Restoring a cached column is far cheaper than generating one, so the two kinds of
+        // batch are costed separately.
+        bool generates = mCache == nullptr;
+        for (size_t i = 0; i < std::min(batchSize, mGenerateQueue.size()) && !generates; i++) {
+            generates = !mCache->hasBlocks(mGenerateQueue[mGenerateQueue.size() - 1 - i]);
+        }
+        double& batchCost = generates ? mGenerateBatchMs : mRestoreBatchMs;
+        // At least one batch a frame, so a budget shorter than a batch still makes progress.
+        if (!first && millisecondsSince(start) + batchCost > mBudget.generateMs) {
+            break;
+        }
+        first = false;
+        // Columns are created up front; generating into them in parallel doesn't touch the map.
+        batch.clear();
+        while (batch.size() < batchSize && !mGenerateQueue.empty()) {
+            const ColumnPos pos = mGenerateQueue.back();
+            mGenerateQueue.pop_back();
+            if (mColumns.count(pos) == 0) {
+                batch.push_back({pos, &mWorld.createColumn(pos), mCache != nullptr ? mCache->blocks(pos) : nullptr});
+            }
+        }
+        const auto batchStart = std::chrono::steady_clock::now();
+        mJobs.parallelFor(batch.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const Load& load = batch[i];
+                if (load.cached == nullptr || !decodeColumn(load.cached->data(), load.cached->size(), *load.column)) {
+                    mTerrain.generateColumn(load.pos, *load.column);
+                }
+            }
+        });
+        const double batchMs = millisecondsSince(batchStart);
+        batchCost = batchCost == 0.0 ? batchMs : 0.75 * batchCost + 0.25 * batchMs;
+
+        for (const Load& load : batch) {
+            mColumns.emplace(load.pos, ColumnState{});
+            stats.generated++;
+            stats.cached += load.cached != nullptr ? 1 : 0;
+        }
+        for (const Load& load : batch) {
+            queueIfMeshable(load.pos);
+            for (const auto& [dx, dz] : NEIGHBORS) {
+                queueIfMeshable({load.pos.x + dx, load.pos.z + dz});
+            }
+        }
+    }
+    stats.generateMs = millisecondsSince(start);
+}
+
+void ChunkStreamer::meshColumns(const MeshFn& mesh, Stats& stats) {
+    const auto start = std::chrono::steady_clock::now();
+    if (!mMeshQueueSorted) {
+        sortQueue(mMeshQueue);
+        mMeshQueueSorted = true;
+    }
+    while (!mMeshQueue.empty() && (stats.meshed == 0 || millisecondsSince(start) < mBudget.meshMs)) {
+        const ColumnPos pos = mMeshQueue.back();
+        mMeshQueue.pop_back();
+        auto it = mColumns.find(pos);
+        if (it == mColumns.end() || it->second.meshed) {
+            continue;
+        }
+        it->second.meshQueued = false;
+        it->second.meshed = true;
+        mesh(pos);
+        stats.meshed++;
+    }
+    stats.meshMs = millisecondsSince(start);
+}
+
+void ChunkStreamer::unloadColumns(const UnloadFn& unload, Stats& stats) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<ColumnPos> retry;
+    bool first = true;
+    while (!mUnloadQueue.empty() && (first || millisecondsSince(start) < mBudget.unloadMs)) {
+        first = false;
+        const ColumnPos pos = mUnloadQueue.back();
+        mUnloadQueue.pop_back();
+        auto it = mColumns.find(pos);
+        if (it == mColumns.end()) {
+            continue;
+        }
+        // Only meshed columns have anything in the renderer.
+        if (it->second.meshed && !unload(pos)) {
+            retry.push_back(pos);
+            continue;
+        }
+        mColumns.erase(it);
+        if (mCache != nullptr) {
+            mCache->putBlocks(pos, *mWorld.column(pos));
+        }
+        mWorld.removeColumn(pos);
+        stats.unloaded++;
+    }
+    // Behind everything else, so one busy column doesn't hold up the rest.
+    mUnloadQueue.insert(mUnloadQueue.begin(), retry.begin(), retry.end());
+    stats.unloadMs = millisecondsSince(start);
+}
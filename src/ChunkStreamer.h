@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "World.h"
+
+class ColumnCache;
+class JobSystem;
+class TerrainGenerator;
+
+// Loads and unloads columns around the camera. Missing columns are generated nearest first,
+// favouring the direction the camera faces; a generated column is handed to the renderer once
+// its four neighbours exist, so its border faces are final; far columns are released. Each
+// stage stops when its share of the frame runs out and carries on next frame. With a cache,
+// unloaded columns are kept there and loading one again skips generation.
+class ChunkStreamer {
+    public:
+        struct Budget {
+            double generateMs = 4.0;
+            double meshMs = 2.0;
+            double unloadMs = 1.0;
+        };
+
+        struct Stats {
+            // Queue depths after the update.
+            size_t generateQueue = 0;
+            size_t meshQueue = 0;
+            size_t unloadQueue = 0;
+            // Completed during the update.
+            size_t generated = 0;
+            // Of those, restored from the cache.
+            size_t cached = 0;
+            size_t meshed = 0;
+            size_t unloaded = 0;
+            // Queued columns dropped because the camera moved away before they were reached.
+            size_t cancelled = 0;
+            double generateMs = 0.0;
+            double meshMs = 0.0;
+            double unloadMs = 0.0;
+
+            Stats& operator+=(const Stats& other);
+        };
+
+        // Hands a column to the renderer; the time it takes counts against the mesh budget.
+        using MeshFn = std::function<void(ColumnPos)>;
+        // Releases the renderer's resources for a column about to be removed. Returning false
+        // keeps the column and retries next frame, e.g. while GPU work still reads it.
+        using UnloadFn = std::function<bool(ColumnPos)>;
+
+        ChunkStreamer(World& world, const TerrainGenerator& terrain, JobSystem& jobs) : mWorld(world), mTerrain(terrain), mJobs(jobs) {}
+
+        // Columns within radius of the camera are meshed. One more ring is loaded so they have
+        // neighbours, and columns stay loaded until they are two rings further out.
+        void setRadius(int radius);
+        void setBudget(const Budget& budget) { mBudget = budget; }
+        void setCache(ColumnCache* cache) { mCache = cache; }
+
+        // Camera position and facing in blocks; the facing needn't be normalized.
+        Stats update(float cameraX, float cameraZ, float forwardX, float forwardZ, const MeshFn& mesh, const UnloadFn& unload);
+
+        [[nodiscard]] bool isMeshed(ColumnPos pos) const;
+        // Everything in range is meshed and nothing out of range is waiting to unload.
+        [[nodiscard]] bool idle() const { return mHasCenter && mGenerateQueue.empty() && mMeshQueue.empty() && mUnloadQueue.empty(); }
+
+    private:
+        struct ColumnState {
+            bool meshQueued = false;
+            bool meshed = false;
+        };
+
+        // Queues are ordered worst first so the next column is popped from the back.
+        void rebuildQueues(Stats& stats);
+        void sortQueue(std::vector<ColumnPos>& queue) const;
+        [[nodiscard]] float priority(ColumnPos pos) const;
+        [[nodiscard]] bool withinRadius(ColumnPos pos, int radius) const;
+        [[nodiscard]] bool meshable(ColumnPos pos) const;
+        void queueIfMeshable(ColumnPos pos);
+
+        void generate(Stats& stats);
+        void meshColumns(const MeshFn& mesh, Stats& stats);
+        void unloadColumns(const UnloadFn& unload, Stats& stats);
+
+        World& mWorld;
+        const TerrainGenerator& mTerrain;
+        JobSystem& mJobs;
+        Budget mBudget;
+        ColumnCache* mCache = nullptr;
+        int mRadius = 6;
+
+        bool mHasCenter = false;
+        ColumnPos mCenter{0, 0};
+        float mCameraX = 0.0f;
+        float mCameraZ = 0.0f;
+        float mForwardX = 0.0f;
+        float mForwardZ = 0.0f;
+
+        std::unordered_map<ColumnPos, ColumnState, ColumnPosHash> mColumns;
+        std::vector<ColumnPos> mGenerateQueue;
+        std::vector<ColumnPos> mMeshQueue;
+        bool mMeshQueueSorted = true;
+        std::vector<ColumnPos> mUnloadQueue;
+        // Recent cost of one batch, so the stage stops before a batch would overrun.
+        double mGenerateBatchMs = 0.0;
+        double mRestoreBatchMs = 0.0;
+};
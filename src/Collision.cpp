@@ -0,0 +1,179 @@
+#include "Collision.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Components.h"
+#include "Ecs.h"
+#include "JobSystem.h"
+
+namespace {
+
+constexpr BlockShape EMPTY_SHAPE = {0, {}};
+constexpr BlockShape FULL_SHAPE = {1, {{{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}}}};
+
+// Fluids are walked through; every other block is a full cube.
+constexpr BlockShape BLOCK_SHAPES[BLOCK_COUNT] = {
+    EMPTY_SHAPE, // air
+    FULL_SHAPE,  // stone
+    FULL_SHAPE,  // dirt
+    FULL_SHAPE,  // grass
+    FULL_SHAPE,  // sand
+    EMPTY_SHAPE, // water
+    EMPTY_SHAPE, // lava
+    FULL_SHAPE,  // log
+    FULL_SHAPE,  // leaves
+    FULL_SHAPE,  // glass
+};
+
+// Limits how far along axis box may move by offset before touching block.
+float clipAxis(const Aabb& box, const Aabb& block, int axis, float offset) {
+    for (int other = 0; other < 3; other++) {
+        if (other != axis && (box.max[other] <= block.min[other] || box.min[other] >= block.max[other])) {
+            return offset;
+        }
+    }
+    if (offset > 0.0f && box.max[axis] <= block.min[axis]) {
+        offset = std::min(offset, block.min[axis] - box.max[axis]);
+    } else if (offset < 0.0f && box.min[axis] >= block.max[axis]) {
+        offset = std::max(offset, block.max[axis] - box.min[axis]);
+    }
+    return offset;
+}
+
+}
+
+const BlockShape& blockShape(BlockId id) {
+    return id < BLOCK_COUNT ? BLOCK_SHAPES[id] : EMPTY_SHAPE;
+}
+
+void BlockNeighborhood::resize(const int32_t min[3], const int32_t max[3]) {
+    for (int axis = 0; axis < 3; axis++) {
+        mMin[axis] = min[axis];
+        mSize[axis] = max[axis] - min[axis] + 1;
+    }
+    mBlocks.assign(static_cast<size_t>(mSize[0]) * mSize[1] * mSize[2], AIR);
+}
+
+void BlockNeighborhood::gather(const World& world, const int32_t min[3], const int32_t max[3]) {
+    resize(min, max);
+    const int32_t y0 = std::max(min[1], 0);
+    const int32_t y1 = std::min(max[1], Column::HEIGHT - 1);
+    // Neighbourhoods rarely straddle columns, so most gathers look up a single one.
+    ColumnPos columnPos{INT32_MIN, INT32_MIN};
+    const Column* column = nullptr;
+    for (int32_t z = min[2]; z <= max[2]; z++) {
+        for (int32_t x = min[0]; x <= max[0]; x++) {
+            const ColumnPos pos{blockToSection(x), blockToSection(z)};
+            if (pos != columnPos) {
+                columnPos = pos;
+                column = world.column(pos);
+            }
+            if (column == nullptr) {
+                continue;
+            }
+            const int32_t lx = blockInSection(x);
+            const int32_t lz = blockInSection(z);
+            for (int32_t y = y0; y <= y1; y++) {
+                const Section& section = column->section(y >> 4);
+                if (section.isEmpty()) {
+                    // Skip to the next section; the cache is already air.
+                    y |= Section::SIZE - 1;
+                    continue;
+                }
+                const size_t index = (static_cast<size_t>(y - min[1]) * mSize[2] + (z - min[2])) * mSize[0] + (x - min[0]);
+                mBlocks[index] = section.get(lx, y & (Section::SIZE - 1), lz);
+            }
+        }
+    }
+}
+
+void BlockNeighborhood::gatherPerBlock(const World& world, const int32_t min[3], const int32_t max[3]) {
+    resize(min, max);
+    size_t index = 0;
+    for (int32_t y = min[1]; y <= max[1]; y++) {
+        for (int32_t z = min[2]; z <= max[2]; z++) {
+            for (int32_t x = min[0]; x <= max[0]; x++) {
+                mBlocks[index++] = world.getBlock(x, y, z);
+            }
+        }
+    }
+}
+
+void BlockNeighborhood::appendBoxes(std::vector<Aabb>& out) const {
+    size_t index = 0;
+    for (int32_t y = 0; y < mSize[1]; y++) {
+        for (int32_t z = 0; z < mSize[2]; z++) {
+            for (int32_t x = 0; x < mSize[0]; x++) {
+                const BlockShape& shape = blockShape(mBlocks[index++]);
+                const float origin[3] = {
+                    static_cast<float>(mMin[0] + x), static_cast<float>(mMin[1] + y), static_cast<float>(mMin[2] + z)
+                };
+                for (int i = 0; i < shape.boxCount; i++) {
+                    Aabb box{};
+                    for (int axis = 0; axis < 3; axis++) {
+                        box.min[axis] = origin[axis] + shape.boxes[i].min[axis];
+                        box.max[axis] = origin[axis] + shape.boxes[i].max[axis];
+                    }
+                    out.push_back(box);
+                }
+            }
+        }
+    }
+}
+
+void sweepBounds(const Aabb& box, const float motion[3], int32_t min[3], int32_t max[3]) {
+    for (int axis = 0; axis < 3; axis++) {
+        min[axis] = static_cast<int32_t>(std::floor(std::min(box.min[axis], box.min[axis] + motion[axis])));
+        max[axis] = static_cast<int32_t>(std::floor(std::max(box.max[axis], box.max[axis] + motion[axis])));
+    }
+    min[1]--;
+}
+
+void sweepAabb(const World& world, Aabb& box, float motion[3], CollisionScratch& scratch) {
+    int32_t min[3];
+    int32_t max[3];
+    sweepBounds(box, motion, min, max);
+    scratch.neighborhood.gather(world, min, max);
+    scratch.boxes.clear();
+    scratch.neighborhood.appendBoxes(scratch.boxes);
+
+    constexpr int AXIS_ORDER[3] = {1, 0, 2};
+    for (int axis : AXIS_ORDER) {
+        float offset = motion[axis];
+        for (const Aabb& block : scratch.boxes) {
+            if (offset == 0.0f) {
+                break;
+            }
+            offset = clipAxis(box, block, axis, offset);
+        }
+        box.min[axis] += offset;
+        box.max[axis] += offset;
+        motion[axis] = offset;
+    }
+}
+
+void moveEntities(const World& world, EntityRegistry& registry, JobSystem& jobs, float dt) {
+    registry.parallelEach<Position, Velocity, Collider>(jobs, [&](size_t count, Position* positions, Velocity* velocities, Collider* colliders) {
+        CollisionScratch scratch;
+        for (size_t i = 0; i < count; i++) {
+            Position& position = positions[i];
+            Velocity& velocity = velocities[i];
+            Collider& collider = colliders[i];
+            Aabb box{
+                {position.x - collider.halfWidth, position.y, position.z - collider.halfWidth},
+                {position.x + collider.halfWidth, position.y + collider.height, position.z + collider.halfWidth},
+            };
+            float wanted[3] = {velocity.x * dt, velocity.y * dt, velocity.z * dt};
+            float moved[3] = {wanted[0], wanted[1], wanted[2]};
+            sweepAabb(world, box, moved, scratch);
+
+            position.x = (box.min[0] + box.max[0]) * 0.5f;
+            position.y = box.min[1];
+            position.z = (box.min[2] + box.max[2]) * 0.5f;
+            collider.onGround = wanted[1] < 0.0f && moved[1] != wanted[1];
+            velocity.x = moved[0] != wanted[0] ? 0.0f : velocity.x;
+            velocity.y = moved[1] != wanted[1] ? 0.0f : velocity.y;
+            velocity.z = moved[2] != wanted[2] ? 0.0f : velocity.z;
+        }
+    });
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Block.h"
+#include "World.h"
+
+class EntityRegistry;
+class JobSystem;
+
+struct Aabb {
+    float min[3];
+    float max[3];
+};
+
+// Collision boxes of a block in block-local [0, 1] coordinates.
+struct BlockShape {
+    int boxCount;
+    Aabb boxes[2];
+};
+
+const BlockShape& blockShape(BlockId id);
+
+// Copy of the blocks in a small box of the world, so collision tests don't go through the
+// column map for every block. Blocks outside loaded columns or the world height read as AIR.
+class BlockNeighborhood {
+    public:
+        // Copies blocks min..max inclusive, looking each column and section up once.
+        void gather(const World& world, const int32_t min[3], const int32_t max[3]);
+        // The same through World::getBlock() per block, for comparison.
+        void gatherPerBlock(const World& world, const int32_t min[3], const int32_t max[3]);
+
+        // World-space boxes of every block in the neighborhood.
+        void appendBoxes(std::vector<Aabb>& out) const;
+
+    private:
+        void resize(const int32_t min[3], const int32_t max[3]);
+
+        int32_t mMin[3] = {};
+        int32_t mSize[3] = {};
+        // Laid out x fastest, then z, then y.
+        std::vector<BlockId> mBlocks;
+};
+
+// Scratch state reused across the entities one thread moves.
+struct CollisionScratch {
+    BlockNeighborhood neighborhood;
+    std::vector<Aabb> boxes;
+};
+
+// Blocks the box touches moving by motion, plus one below for shapes taller than a block.
+void sweepBounds(const Aabb& box, const float motion[3], int32_t min[3], int32_t max[3]);
+
+// Moves box by motion, resolving one axis at a time (Y, then X, then Z) so an entity slides
+// along the surfaces it touches. motion is replaced by the movement actually made.
+void sweepAabb(const World& world, Aabb& box, float motion[3], CollisionScratch& scratch);
+
+// Advances every entity with a Position, Velocity and Collider by dt, in parallel. Velocity
+// along an axis that hits a block drops to zero, and onGround is set when falling is stopped.
+void moveEntities(const World& world, EntityRegistry& registry, JobSystem& jobs, float dt);
@@ -0,0 +1,118 @@
+#include "ColumnCache.h"
+
+#include <utility>
+#include "ColumnCodec.h"
+
+namespace {
+
+double hitRate(size_t hits, size_t misses) {
+    return hits + misses > 0 ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0;
+}
+
+}
+
+double ColumnCache::Stats::blockHitRate() const {
+    return hitRate(blockHits, blockMisses);
+}
+
+double ColumnCache::Stats::meshHitRate() const {
+    return hitRate(meshHits, meshMisses);
+}
+
+void ColumnCache::setBudget(size_t bytes) {
+    mBudget = bytes;
+    shrinkTo(mBudget);
+}
+
+ColumnCache::Entry* ColumnCache::find(const Key& key) {
+    auto it = mIndex.find(key);
+    if (it == mIndex.end()) {
+        return nullptr;
+    }
+    Entry& entry = mEntries[it->second];
+    entry.referenced = true;
+    return &entry;
+}
+
+void ColumnCache::insert(Entry entry) {
+    if (entry.bytes > mBudget) {
+        return;
+    }
+    auto it = mIndex.find(entry.key);
+    if (it != mIndex.end()) {
+        erase(it->second);
+    }
+    shrinkTo(mBudget - entry.bytes);
+
+    uint32_t index;
+    if (!mFree.empty()) {
+        index = mFree.back();
+        mFree.pop_back();
+    } else {
+        index = static_cast<uint32_t>(mEntries.size());
+        mEntries.emplace_back();
+    }
+    // New entries start unmarked, so one that is never read again goes on the hand's next pass.
+    entry.used = true;
+    entry.referenced = false;
+    mStats.bytes += entry.bytes;
+    mStats.entries++;
+    mIndex[entry.key] = index;
+    mEntries[index] = std::move(entry);
+}
+
+void ColumnCache::erase(uint32_t index) {
+    Entry& entry = mEntries[index];
+    mIndex.erase(entry.key);
+    mStats.bytes -= entry.bytes;
+    mStats.entries--;
+    entry = {};
+    mFree.push_back(index);
+}
+
+void ColumnCache::shrinkTo(size_t bytes) {
+    while (mStats.bytes > bytes) {
+        if (mHand >= mEntries.size()) {
+            mHand = 0;
+        }
+        Entry& entry = mEntries[mHand];
+        if (entry.used && !entry.referenced) {
+            erase(mHand);
+            mStats.evictions++;
+        } else {
+            entry.referenced = false;
+        }
+        mHand++;
+    }
+}
+
+void ColumnCache::putBlocks(ColumnPos pos, const Column& column) {
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    encodeColumn(column, *data);
+    data->shrink_to_fit();
+    Entry entry;
+    entry.key = {pos, 0};
+    entry.bytes = sizeof(Entry) + data->size();
+    entry.blocks = std::move(data);
+    insert(std::move(entry));
+}
+
+std::shared_ptr<const std::vector<uint8_t>> ColumnCache::blocks(ColumnPos pos) {
+    const Entry* entry = find({pos, 0});
+    (entry != nullptr ? mStats.blockHits : mStats.blockMisses)++;
+    return entry != nullptr ? entry->blocks : nullptr;
+}
+
+void ColumnCache::putMesh(ColumnPos pos, int lod, std::shared_ptr<const LodColumnMesh> mesh) {
+    Entry entry;
+    entry.key = {pos, lod};
+    entry.bytes = sizeof(Entry) + sizeof(LodColumnMesh) + mesh->vertices.capacity() * sizeof(MeshVertex);
+    entry.mesh = std::move(mesh);
+    insert(std::move(entry));
+}
+
+std::shared_ptr<const LodColumnMesh> ColumnCache::mesh(ColumnPos pos, int lod) {
+    const Entry* entry = find({pos, lod});
+    (entry != nullptr ? mStats.meshHits : mStats.meshMisses)++;
+    return entry != nullptr ? entry->mesh : nullptr;
+}
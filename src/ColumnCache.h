@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "LodMesher.h"
+#include "World.h"
+
+// Recently unloaded columns, compressed with encodeColumn(), and the LOD meshes built for
+// them, within a byte budget. Eviction is CLOCK: a hit marks an entry, and the hand passing an
+// unmarked entry evicts it, which approximates least recently used with O(1) bookkeeping.
+// Entries are immutable and shared, so a hit stays valid after the entry is evicted.
+class ColumnCache {
+    public:
+        struct Stats {
+            size_t blockHits = 0;
+            size_t blockMisses = 0;
+            size_t meshHits = 0;
+            size_t meshMisses = 0;
+            size_t evictions = 0;
+            size_t entries = 0;
+            size_t bytes = 0;
+
+            [[nodiscard]] double blockHitRate() const;
+            [[nodiscard]] double meshHitRate() const;
+        };
+
+        explicit ColumnCache(size_t budgetBytes) : mBudget(budgetBytes) {}
+
+        // Evicts down to the new budget straight away.
+        void setBudget(size_t bytes);
+
+        void putBlocks(ColumnPos pos, const Column& column);
+        // Null on a miss; decode a hit with decodeColumn().
+        std::shared_ptr<const std::vector<uint8_t>> blocks(ColumnPos pos);
+        // Neither counts as a use nor changes the statistics.
+        [[nodiscard]] bool hasBlocks(ColumnPos pos) const { return mIndex.count(Key{pos, 0}) != 0; }
+        void putMesh(ColumnPos pos, int lod, std::shared_ptr<const LodColumnMesh> mesh);
+        std::shared_ptr<const LodColumnMesh> mesh(ColumnPos pos, int lod);
+
+        [[nodiscard]] const Stats& stats() const { return mStats; }
+
+    private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        // Kind 0 is the column's blocks, kinds 1 and up its LOD meshes by level.
+        struct Key {
+            ColumnPos pos;
+            int kind;
+
+            bool operator==(const Key& other) const {
+                return pos == other.pos && kind == other.kind;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const {
+                return ColumnPosHash()(key.pos) ^ (static_cast<size_t>(key.kind) * 0x9E3779B97F4A7C15ull);
+            }
+        };
+
+        struct Entry {
+            Key key;
+            std::shared_ptr<const std::vector<uint8_t>> blocks;
+            std::shared_ptr<const LodColumnMesh> mesh;
+            size_t bytes = 0;
+            bool referenced = false;
+            bool used = false;
+        };
+
+        Entry* find(const Key& key);
+        void insert(Entry entry);
+        void erase(uint32_t index);
+        void shrinkTo(size_t bytes);
+
+        size_t mBudget;
+        std::vector<Entry> mEntries;
+        std::vector<uint32_t> mFree;
+        std::unordered_map<Key, uint32_t, KeyHash> mIndex;
+        uint32_t mHand = 0;
+        Stats mStats;
+};
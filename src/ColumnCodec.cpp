@@ -0,0 +1,97 @@
+#include "ColumnCodec.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+void writeVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (data == end) {
+            return false;
+        }
+        const uint8_t byte = *data++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+void encodeColumn(const Column& column, std::vector<uint8_t>& out) {
+    std::array<uint32_t, Section::VOLUME> blocks;
+    for (int sy = 0; sy < Column::SECTIONS; sy++) {
+        const Section& section = column.section(sy);
+        const std::vector<BlockId>& palette = section.palette();
+        writeVarint(out, static_cast<uint32_t>(palette.size()));
+        for (BlockId block : palette) {
+            writeVarint(out, block);
+        }
+        if (section.isUniform()) {
+            continue;
+        }
+        section.decode(blocks.data());
+        for (int i = 0; i < Section::VOLUME;) {
+            int end = i + 1;
+            while (end < Section::VOLUME && blocks[end] == blocks[i]) {
+                end++;
+            }
+            const auto entry = std::find(palette.begin(), palette.end(), blocks[i]) - palette.begin();
+            writeVarint(out, static_cast<uint32_t>(end - i));
+            writeVarint(out, static_cast<uint32_t>(entry));
+            i = end;
+        }
+    }
+}
+
+bool decodeColumn(const uint8_t* data, size_t size, Column& column) {
+    const uint8_t* end = data + size;
+    std::array<uint32_t, Section::VOLUME> blocks;
+    std::vector<BlockId> palette;
+    for (int sy = 0; sy < Column::SECTIONS; sy++) {
+        uint32_t paletteSize;
+        if (!readVarint(data, end, paletteSize) || paletteSize == 0 || paletteSize > Section::VOLUME) {
+            return false;
+        }
+        palette.resize(paletteSize);
+        for (BlockId& block : palette) {
+            uint32_t value;
+            if (!readVarint(data, end, value) || value > UINT16_MAX) {
+                return false;
+            }
+            block = static_cast<BlockId>(value);
+        }
+        if (paletteSize == 1 && palette[0] == AIR) {
+            column.clearSection(sy);
+            continue;
+        }
+        if (paletteSize == 1) {
+            column.mutableSection(sy).fill(palette[0]);
+            continue;
+        }
+        for (int i = 0; i < Section::VOLUME;) {
+            uint32_t length;
+            uint32_t entry;
+            if (!readVarint(data, end, length) || !readVarint(data, end, entry) || length == 0 ||
+                length > static_cast<uint32_t>(Section::VOLUME - i) || entry >= paletteSize) {
+                return false;
+            }
+            std::fill_n(blocks.begin() + i, length, palette[entry]);
+            i += static_cast<int>(length);
+        }
+        column.mutableSection(sy).encode(blocks.data());
+    }
+    return data == end;
+}
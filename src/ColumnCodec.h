@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "World.h"
+
+// Compact byte form of a column: per section its palette, then runs of equal blocks in
+// Section::index() order, all as LEB128 varints. Terrain sections are mostly long runs of
+// stone and air, so a column usually shrinks to a few KiB.
+void encodeColumn(const Column& column, std::vector<uint8_t>& out);
+// Replaces column's sections with data written by encodeColumn(). Returns false if the data
+// is malformed, leaving column partly overwritten.
+bool decodeColumn(const uint8_t* data, size_t size, Column& column);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// Components shared by the simulation systems, stored in an EntityRegistry (Ecs.h).
+// Distances are in blocks and times in seconds.
+
+// Bottom center of the entity's collider.
+struct Position {
+    float x, y, z;
+};
+
+struct Velocity {
+    float x, y, z;
+};
+
+// Axis-aligned box around the position, halfWidth out on X and Z and height up on Y.
+struct Collider {
+    float halfWidth;
+    float height;
+    bool onGround;
+};
+
+// Drawn through the instanced model path; mesh is a ModelMesh (Models.h).
+struct Model {
+    uint32_t mesh;
+    // Radians about Y, and how fast it changes (item drops turn in place).
+    float yaw;
+    float spin;
+    float scale;
+    float tint[3];
+};
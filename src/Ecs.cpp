@@ -0,0 +1,173 @@
+#include "Ecs.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+struct ComponentInfo {
+    size_t size;
+    size_t alignment;
+};
+
+std::mutex gComponentMutex;
+std::vector<ComponentInfo> gComponents;
+
+ComponentInfo componentInfo(int id) {
+    std::lock_guard<std::mutex> lock(gComponentMutex);
+    return gComponents[static_cast<size_t>(id)];
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+int EntityRegistry::registerComponent(size_t size, size_t alignment) {
+    std::lock_guard<std::mutex> lock(gComponentMutex);
+    if (gComponents.size() == MAX_COMPONENT_TYPES) {
+        throw std::runtime_error("too many component types");
+    }
+    gComponents.push_back({size, alignment});
+    return static_cast<int>(gComponents.size() - 1);
+}
+
+Entity EntityRegistry::allocateEntity() {
+    uint32_t index;
+    if (!mFreeIndices.empty()) {
+        index = mFreeIndices.back();
+        mFreeIndices.pop_back();
+    } else {
+        index = static_cast<uint32_t>(mRecords.size());
+        mRecords.emplace_back();
+    }
+    mAlive++;
+    return {index, mRecords[index].generation};
+}
+
+uint32_t EntityRegistry::findArchetype(ComponentMask mask) {
+    auto it = mArchetypeByMask.find(mask);
+    if (it != mArchetypeByMask.end()) {
+        return it->second;
+    }
+
+    auto archetype = std::make_unique<Archetype>();
+    archetype->mask = mask;
+    archetype->offsets.fill(NO_OFFSET);
+    size_t rowBytes = sizeof(Entity);
+    std::vector<ComponentInfo> infos(MAX_COMPONENT_TYPES);
+    for (int id = 0; id < MAX_COMPONENT_TYPES; id++) {
+        if ((mask & (ComponentMask{1} << id)) != 0) {
+            infos[id] = componentInfo(id);
+            rowBytes += infos[id].size;
+        }
+    }
+
+    // Leaves room for the padding between arrays, then shrinks until the layout fits.
+    uint32_t capacity = static_cast<uint32_t>(std::max<size_t>(1, CHUNK_BYTES / rowBytes));
+    for (;; capacity--) {
+        size_t offset = 0;
+        for (int id = 0; id < MAX_COMPONENT_TYPES; id++) {
+            if ((mask & (ComponentMask{1} << id)) != 0) {
+                offset = alignUp(offset, infos[id].alignment);
+                archetype->offsets[id] = static_cast<uint32_t>(offset);
+                archetype->sizes[id] = static_cast<uint32_t>(infos[id].size);
+                offset += infos[id].size * capacity;
+            }
+        }
+        offset = alignUp(offset, alignof(Entity));
+        archetype->entityOffset = static_cast<uint32_t>(offset);
+        offset += sizeof(Entity) * capacity;
+        if (offset <= CHUNK_BYTES || capacity == 1) {
+            archetype->capacity = capacity;
+            break;
+        }
+    }
+
+    const auto index = static_cast<uint32_t>(mArchetypes.size());
+    mArchetypes.push_back(std::move(archetype));
+    mArchetypeByMask[mask] = index;
+    return index;
+}
+
+void EntityRegistry::placeEntity(Entity entity, uint32_t archetypeIndex) {
+    Archetype& archetype = *mArchetypes[archetypeIndex];
+    if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity) {
+        // A single oversized row still gets a chunk big enough for it.
+        const size_t bytes = std::max<size_t>(CHUNK_BYTES, archetype.entityOffset + sizeof(Entity));
+        Chunk chunk;
+        chunk.data.reset(new std::max_align_t[(bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)]);
+        archetype.chunks.push_back(std::move(chunk));
+    }
+    const auto chunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+    const uint32_t row = archetype.chunks.back().count++;
+    *entityPtr(archetypeIndex, chunk, row) = entity;
+    mRecords[entity.index] = {archetypeIndex, chunk, row, entity.generation};
+}
+
+void EntityRegistry::removeRow(const Record& record) {
+    Archetype& archetype = *mArchetypes[record.archetype];
+    const auto lastChunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+    const uint32_t lastRow = archetype.chunks[lastChunk].count - 1;
+    if (record.chunk != lastChunk || record.row != lastRow) {
+        std::byte* dst = reinterpret_cast<std::byte*>(archetype.chunks[record.chunk].data.get());
+        const std::byte* src = reinterpret_cast<const std::byte*>(archetype.chunks[lastChunk].data.get());
+        for (int id = 0; id < MAX_COMPONENT_TYPES; id++) {
+            if (archetype.offsets[id] != NO_OFFSET) {
+                const size_t size = archetype.sizes[id];
+                std::memcpy(dst + archetype.offsets[id] + size * record.row, src + archetype.offsets[id] + size * lastRow, size);
+            }
+        }
+        const Entity moved = *entityPtr(record.archetype, lastChunk, lastRow);
+        *entityPtr(record.archetype, record.chunk, record.row) = moved;
+        mRecords[moved.index].chunk = record.chunk;
+        mRecords[moved.index].row = record.row;
+    }
+    if (--archetype.chunks[lastChunk].count == 0) {
+        archetype.chunks.pop_back();
+    }
+}
+
+void EntityRegistry::destroy(Entity entity) {
+    if (!alive(entity)) {
+        return;
+    }
+    Record& record = mRecords[entity.index];
+    removeRow(record);
+    record.archetype = NO_ARCHETYPE;
+    if (++record.generation == 0) {
+        record.generation = 1;
+    }
+    mFreeIndices.push_back(entity.index);
+    mAlive--;
+}
+
+void EntityRegistry::moveEntity(Entity entity, uint32_t archetypeIndex) {
+    const Record old = mRecords[entity.index];
+    placeEntity(entity, archetypeIndex);
+    const Record& record = mRecords[entity.index];
+    const ComponentMask shared = mArchetypes[old.archetype]->mask & mArchetypes[archetypeIndex]->mask;
+    for (int id = 0; id < MAX_COMPONENT_TYPES; id++) {
+        if ((shared & (ComponentMask{1} << id)) != 0) {
+            std::memcpy(componentPtr(record, id), componentPtr(old, id), mArchetypes[archetypeIndex]->sizes[id]);
+        }
+    }
+    removeRow(old);
+}
+
+void* EntityRegistry::componentPtr(const Record& record, int id) {
+    const Archetype& archetype = *mArchetypes[record.archetype];
+    if (archetype.offsets[id] == NO_OFFSET) {
+        return nullptr;
+    }
+    std::byte* data = reinterpret_cast<std::byte*>(archetype.chunks[record.chunk].data.get());
+    return data + archetype.offsets[id] + static_cast<size_t>(archetype.sizes[id]) * record.row;
+}
+
+Entity* EntityRegistry::entityPtr(uint32_t archetypeIndex, uint32_t chunk, uint32_t row) {
+    const Archetype& archetype = *mArchetypes[archetypeIndex];
+    std::byte* data = reinterpret_cast<std::byte*>(archetype.chunks[chunk].data.get());
+    return reinterpret_cast<Entity*>(data + archetype.entityOffset) + row;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "JobSystem.h"
+
+// Stable handle to an entity. A destroyed entity's index is reused with a new generation, so
+// stale handles are detected instead of aliasing whatever took the index.
+struct Entity {
+    uint32_t index = 0;
+    // 0 is never handed out, so a default-constructed Entity is never alive.
+    uint32_t generation = 0;
+
+    bool operator==(const Entity& other) const {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const Entity& other) const {
+        return !(*this == other);
+    }
+};
+
+constexpr int MAX_COMPONENT_TYPES = 64;
+using ComponentMask = uint64_t;
+
+// Archetype-based entity storage. Entities with the same set of components share an archetype,
+// which stores them in fixed-size chunks with one tightly packed array per component, so a
+// query over a few components only touches the memory it reads. Components must be trivially
+// copyable: entities move between rows and archetypes with memcpy.
+//
+// Archetypes stay dense: destroying or moving an entity fills its row with the archetype's last
+// entity. Entities must not be created, destroyed or change components during a query.
+class EntityRegistry {
+    public:
+        static constexpr size_t CHUNK_BYTES = 16 * 1024;
+
+        template <typename T>
+        static int componentId() {
+            static_assert(std::is_trivially_copyable_v<T>, "components are moved with memcpy");
+            static_assert(alignof(T) <= alignof(std::max_align_t), "chunks are max_align_t aligned");
+            static const int id = registerComponent(sizeof(T), alignof(T));
+            return id;
+        }
+
+        template <typename... Ts>
+        static ComponentMask maskOf() {
+            return (ComponentMask{0} | ... | (ComponentMask{1} << componentId<Ts>()));
+        }
+
+        template <typename... Ts>
+        Entity create(const Ts&... components) {
+            const Entity entity = allocateEntity();
+            Record& record = mRecords[entity.index];
+            const uint32_t archetype = findArchetype(maskOf<Ts...>());
+            placeEntity(entity, archetype);
+            (std::memcpy(componentPtr(record, componentId<Ts>()), &components, sizeof(Ts)), ...);
+            return entity;
+        }
+
+        void destroy(Entity entity);
+
+        [[nodiscard]] bool alive(Entity entity) const {
+            return entity.index < mRecords.size() && mRecords[entity.index].generation == entity.generation &&
+                   mRecords[entity.index].archetype != NO_ARCHETYPE;
+        }
+
+        // Null when the entity is dead or lacks the component.
+        template <typename T>
+        T* get(Entity entity) {
+            if (!alive(entity)) {
+                return nullptr;
+            }
+            return static_cast<T*>(componentPtr(mRecords[entity.index], componentId<T>()));
+        }
+
+        template <typename T>
+        void add(Entity entity, const T& component) {
+            if (!alive(entity)) {
+                return;
+            }
+            const int id = componentId<T>();
+            const Record& record = mRecords[entity.index];
+            const ComponentMask mask = mArchetypes[record.archetype]->mask;
+            if ((mask & (ComponentMask{1} << id)) == 0) {
+                moveEntity(entity, findArchetype(mask | (ComponentMask{1} << id)));
+            }
+            std::memcpy(componentPtr(mRecords[entity.index], id), &component, sizeof(T));
+        }
+
+        template <typename T>
+        void remove(Entity entity) {
+            if (!alive(entity)) {
+                return;
+            }
+            const ComponentMask bit = ComponentMask{1} << componentId<T>();
+            const ComponentMask mask = mArchetypes[mRecords[entity.index].archetype]->mask;
+            if ((mask & bit) != 0) {
+                moveEntity(entity, findArchetype(mask & ~bit));
+            }
+        }
+
+        [[nodiscard]] size_t size() const { return mAlive; }
+
+        // Calls fn(count, Ts*... arrays) once per chunk whose archetype has every one of Ts.
+        template <typename... Ts, typename Fn>
+        void each(Fn&& fn) {
+            const ComponentMask mask = maskOf<Ts...>();
+            for (auto& archetype : mArchetypes) {
+                if ((archetype->mask & mask) != mask) {
+                    continue;
+                }
+                for (Chunk& chunk : archetype->chunks) {
+                    fn(static_cast<size_t>(chunk.count), componentArray<Ts>(*archetype, chunk)...);
+                }
+            }
+        }
+
+        // each(), with the matching chunks spread across the job system. fn runs concurrently.
+        template <typename... Ts, typename Fn>
+        void parallelEach(JobSystem& jobs, Fn&& fn) {
+            const ComponentMask mask = maskOf<Ts...>();
+            std::vector<std::pair<Archetype*, Chunk*>> chunks;
+            for (auto& archetype : mArchetypes) {
+                if ((archetype->mask & mask) != mask) {
+                    continue;
+                }
+                for (Chunk& chunk : archetype->chunks) {
+                    chunks.emplace_back(archetype.get(), &chunk);
+                }
+            }
+            jobs.parallelFor(chunks.size(), 4, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    auto [archetype, chunk] = chunks[i];
+                    fn(static_cast<size_t>(chunk->count), componentArray<Ts>(*archetype, *chunk)...);
+                }
+            });
+        }
+
+    private:
+        static constexpr uint32_t NO_ARCHETYPE = UINT32_MAX;
+        static constexpr uint32_t NO_OFFSET = UINT32_MAX;
+
+        struct Chunk {
+            std::unique_ptr<std::max_align_t[]> data;
+            uint32_t count = 0;
+        };
+
+        struct Archetype {
+            ComponentMask mask = 0;
+            // Byte offset of each component's array in a chunk, NO_OFFSET if absent.
+            std::array<uint32_t, MAX_COMPONENT_TYPES> offsets{};
+            std::array<uint32_t, MAX_COMPONENT_TYPES> sizes{};
+            uint32_t entityOffset = 0;
+            uint32_t capacity = 0;
+            // Every chunk but the last is full.
+            std::vector<Chunk> chunks;
+        };
+
+        struct Record {
+            uint32_t archetype = NO_ARCHETYPE;
+            uint32_t chunk = 0;
+            uint32_t row = 0;
+            uint32_t generation = 1;
+        };
+
+        static int registerComponent(size_t size, size_t alignment);
+
+        template <typename T>
+        static T* componentArray(Archetype& archetype, Chunk& chunk) {
+            return reinterpret_cast<T*>(reinterpret_cast<std::byte*>(chunk.data.get()) + archetype.offsets[componentId<T>()]);
+        }
+
+        Entity allocateEntity();
+        uint32_t findArchetype(ComponentMask mask);
+        void placeEntity(Entity entity, uint32_t archetype);
+        void removeRow(const Record& record);
+        void moveEntity(Entity entity, uint32_t archetype);
+        void* componentPtr(const Record& record, int id);
+        Entity* entityPtr(uint32_t archetype, uint32_t chunk, uint32_t row);
+
+        std::vector<std::unique_ptr<Archetype>> mArchetypes;
+        std::unordered_map<ComponentMask, uint32_t> mArchetypeByMask;
+        std::vector<Record> mRecords;
+        std::vector<uint32_t> mFreeIndices;
+        size_t mAlive = 0;
+};
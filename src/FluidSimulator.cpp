@@ -0,0 +1,147 @@
+#include "FluidSimulator.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int HORIZONTAL[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+constexpr int NEIGHBORS[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+
+BlockPos offset(BlockPos pos, int dx, int dy, int dz) {
+    return {pos.x + dx, pos.y + dy, pos.z + dz};
+}
+
+}
+
+void FluidSimulator::notifyChanged(BlockPos pos) {
+    activate(pos);
+    for (const auto& [dx, dy, dz] : NEIGHBORS) {
+        activate(offset(pos, dx, dy, dz));
+    }
+}
+
+void FluidSimulator::activate(BlockPos pos) {
+    for (ActiveSet& active : mActive) {
+        if (active.queued.insert(pos).second) {
+            active.queue.push_back(pos);
+        }
+    }
+}
+
+uint8_t FluidSimulator::level(BlockPos pos) const {
+    auto it = mLevels.find(pos);
+    return it != mLevels.end() ? it->second : 0;
+}
+
+size_t FluidSimulator::activeCount() const {
+    size_t count = 0;
+    for (const ActiveSet& active : mActive) {
+        count += active.queue.size();
+    }
+    return count;
+}
+
+uint8_t FluidSimulator::levelOf(BlockPos pos, BlockId block, BlockId kind) const {
+    return block == kind ? level(pos) : NO_FLUID;
+}
+
+std::optional<FluidSimulator::Change> FluidSimulator::evaluate(BlockPos pos, const Kind& kind) const {
+    // Unloaded blocks can't be written, so they never change.
+    if (pos.y < 0 || pos.y >= Column::HEIGHT || mWorld.column({blockToSection(pos.x), blockToSection(pos.z)}) == nullptr) {
+        return std::nullopt;
+    }
+    const BlockId current = mWorld.getBlock(pos.x, pos.y, pos.z);
+    if (current != AIR && current != kind.block) {
+        return std::nullopt;
+    }
+    const uint8_t currentLevel = levelOf(pos, current, kind.block);
+    if (currentLevel == 0) {
+        return std::nullopt;
+    }
+
+    const BlockId below = mWorld.getBlock(pos.x, pos.y - 1, pos.z);
+    uint8_t newLevel = NO_FLUID;
+    int sources = 0;
+    if (mWorld.getBlock(pos.x, pos.y + 1, pos.z) == kind.block) {
+        newLevel = 1;
+    }
+    for (const auto& [dx, dz] : HORIZONTAL) {
+        const BlockPos neighbor = offset(pos, dx, 0, dz);
+        const uint8_t neighborLevel = levelOf(neighbor, mWorld.getBlock(neighbor.x, neighbor.y, neighbor.z), kind.block);
+        if (neighborLevel == NO_FLUID) {
+            continue;
+        }
+        sources += neighborLevel == 0 ? 1 : 0;
+        // Fluid with air below it falls instead of spreading.
+        if (mWorld.getBlock(neighbor.x, neighbor.y - 1, neighbor.z) != AIR) {
+            newLevel = std::min<uint8_t>(newLevel, neighborLevel + 1);
+        }
+    }
+    const bool supported = below != AIR && (below != kind.block || levelOf(offset(pos, 0, -1, 0), below, kind.block) == 0);
+    if (kind.block == WATER && sources >= 2 && supported) {
+        newLevel = 0;
+    }
+    if (newLevel != NO_FLUID && newLevel > kind.maxLevel) {
+        newLevel = NO_FLUID;
+    }
+    if (newLevel == currentLevel) {
+        return std::nullopt;
+    }
+    return Change{pos, newLevel == NO_FLUID ? static_cast<BlockId>(AIR) : kind.block, newLevel};
+}
+
+void FluidSimulator::apply(const Change& change) {
+    const BlockPos pos = change.pos;
+    mWorld.setBlock(pos.x, pos.y, pos.z, change.block);
+    if (change.level == NO_FLUID || change.level == 0) {
+        mLevels.erase(pos);
+    } else {
+        mLevels[pos] = change.level;
+    }
+    mDirtySections.insert({blockToSection(pos.x), blockToSection(pos.y), blockToSection(pos.z)});
+    for (const auto& [dx, dy, dz] : NEIGHBORS) {
+        const BlockPos neighbor = offset(pos, dx, dy, dz);
+        mDirtySections.insert({blockToSection(neighbor.x), blockToSection(neighbor.y), blockToSection(neighbor.z)});
+    }
+    notifyChanged(pos);
+}
+
+FluidSimulator::TickStats FluidSimulator::tick(size_t budget) {
+    TickStats stats;
+    mTick++;
+    mChanges.clear();
+    for (int k = 0; k < KIND_COUNT; k++) {
+        const Kind& kind = KINDS[k];
+        ActiveSet& active = mActive[k];
+        if (mTick % kind.tickRate != 0) {
+            continue;
+        }
+        // Only the cells active when the tick started; the ones this tick activates wait.
+        const size_t count = std::min(active.queue.size(), budget - stats.evaluated);
+        for (size_t i = 0; i < count; i++) {
+            const BlockPos pos = active.queue.front();
+            active.queue.pop_front();
+            active.queued.erase(pos);
+            if (std::optional<Change> change = evaluate(pos, kind)) {
+                mChanges.push_back(*change);
+            }
+        }
+        stats.evaluated += count;
+    }
+    for (int k = 0; k < KIND_COUNT; k++) {
+        if (mTick % KINDS[k].tickRate == 0) {
+            stats.deferred += mActive[k].queue.size();
+        }
+    }
+
+    for (const Change& change : mChanges) {
+        apply(change);
+    }
+    stats.changed = mChanges.size();
+    return stats;
+}
+
+void FluidSimulator::takeDirtySections(std::vector<SectionPos>& out) {
+    out.insert(out.end(), mDirtySections.begin(), mDirtySections.end());
+    mDirtySections.clear();
+}
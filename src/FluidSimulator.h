@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Block.h"
+#include "World.h"
+
+// Minecraft-style water and lava. A fluid block is a source unless it has a flowing level, the
+// distance from the source feeding it: water reaches 7 blocks and lava 3, spreading sideways
+// only where it can't fall, and two water sources next to each other fill the gap between
+// them. Water updates every 5 ticks and lava every 30.
+//
+// Only cells in the active set are evaluated: cells reported through notifyChanged() and the
+// neighbours of cells that changed. A cell that doesn't change leaves the set, so fluid at rest
+// costs nothing. Each update reads the world as it was before the tick and all results are
+// applied together afterwards, so the outcome doesn't depend on evaluation order.
+class FluidSimulator {
+    public:
+        struct TickStats {
+            size_t evaluated = 0;
+            size_t changed = 0;
+            // Active cells left for a later tick by the budget.
+            size_t deferred = 0;
+        };
+
+        explicit FluidSimulator(World& world) : mWorld(world) {}
+
+        // Call after changing the block at pos by other means; wakes it and its neighbours.
+        void notifyChanged(BlockPos pos);
+
+        // Evaluates at most budget active cells, oldest first; under a flood the rest wait
+        // for later ticks.
+        TickStats tick(size_t budget);
+
+        // Flowing level, 0 for sources and for blocks that aren't fluid.
+        [[nodiscard]] uint8_t level(BlockPos pos) const;
+        [[nodiscard]] size_t activeCount() const;
+
+        // Sections whose blocks the simulator changed since the last call, plus the sections
+        // sharing the changed faces, for remeshing.
+        void takeDirtySections(std::vector<SectionPos>& out);
+
+    private:
+        static constexpr uint8_t NO_FLUID = 0xFF;
+
+        struct Kind {
+            BlockId block;
+            uint8_t maxLevel;
+            uint32_t tickRate;
+        };
+
+        struct Change {
+            BlockPos pos;
+            BlockId block;
+            uint8_t level;
+        };
+
+        // Fluid cells under one kind's rules, in the order they were activated.
+        struct ActiveSet {
+            std::deque<BlockPos> queue;
+            std::unordered_set<BlockPos, BlockPosHash> queued;
+        };
+
+        // Water's changes are applied last, so it wins a cell both fluids reach on the same tick.
+        static constexpr int KIND_COUNT = 2;
+        static constexpr Kind KINDS[KIND_COUNT] = {{LAVA, 3, 30}, {WATER, 7, 5}};
+
+        void activate(BlockPos pos);
+        [[nodiscard]] std::optional<Change> evaluate(BlockPos pos, const Kind& kind) const;
+        [[nodiscard]] uint8_t levelOf(BlockPos pos, BlockId block, BlockId kind) const;
+        void apply(const Change& change);
+
+        World& mWorld;
+        // Flowing fluid only; fluid blocks without an entry are sources.
+        std::unordered_map<BlockPos, uint8_t, BlockPosHash> mLevels;
+        ActiveSet mActive[KIND_COUNT];
+        std::vector<Change> mChanges;
+        std::unordered_set<SectionPos, SectionPosHash> mDirtySections;
+        uint64_t mTick = 0;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Collects per-frame timings so present profiles can be compared against each other.
+class FrameStats {
+    public:
+        struct Summary {
+            size_t frames = 0;
+            double seconds = 0.0;
+            double fps = 0.0;
+            double frameMsP50 = 0.0;
+            double frameMsP99 = 0.0;
+            double latencyMsMean = 0.0;
+            double latencyMsP50 = 0.0;
+            double latencyMsP99 = 0.0;
+            // Per-frame section counts from the culling passes.
+            double visibleMean = 0.0;
+            double occludedMean = 0.0;
+            double frustumCulledMean = 0.0;
+            double caveCulledMean = 0.0;
+            // Software occlusion time per frame, when MC_CULLING=cpu.
+            double cpuCullMsP50 = 0.0;
+            double cpuCullMsP99 = 0.0;
+        };
+
+        void reset() {
+            mFrameMs.clear();
+            mLatencyMs.clear();
+            mCpuCullMs.clear();
+            mCullFrames = 0;
+            mVisible = 0;
+            mOccluded = 0;
+            mFrustumCulled = 0;
+            mCaveCulled = 0;
+        }
+
+        void addFrame(double frameMs) {
+            mFrameMs.push_back(frameMs);
+        }
+
+        void addLatency(double latencyMs) {
+            mLatencyMs.push_back(latencyMs);
+        }
+
+        void addCulling(uint32_t visible, uint32_t occluded, uint32_t frustumCulled, uint32_t caveCulled) {
+            mCullFrames++;
+            mVisible += visible;
+            mOccluded += occluded;
+            mFrustumCulled += frustumCulled;
+            mCaveCulled += caveCulled;
+        }
+
+        void addCpuCulling(double ms) {
+            mCpuCullMs.push_back(ms);
+        }
+
+        [[nodiscard]] Summary summarize() const {
+            Summary summary;
+            summary.frames = mFrameMs.size();
+            for (double ms : mFrameMs) {
+                summary.seconds += ms / 1000.0;
+            }
+            if (summary.seconds > 0.0) {
+                summary.fps = static_cast<double>(summary.frames) / summary.seconds;
+            }
+            summary.frameMsP50 = percentile(mFrameMs, 0.50);
+            summary.frameMsP99 = percentile(mFrameMs, 0.99);
+
+            if (!mLatencyMs.empty()) {
+                double total = 0.0;
+                for (double ms : mLatencyMs) {
+                    total += ms;
+                }
+                summary.latencyMsMean = total / static_cast<double>(mLatencyMs.size());
+            }
+            summary.latencyMsP50 = percentile(mLatencyMs, 0.50);
+            summary.latencyMsP99 = percentile(mLatencyMs, 0.99);
+
+            if (mCullFrames > 0) {
+                const auto frames = static_cast<double>(mCullFrames);
+                summary.visibleMean = static_cast<double>(mVisible) / frames;
+                summary.occludedMean = static_cast<double>(mOccluded) / frames;
+                summary.frustumCulledMean = static_cast<double>(mFrustumCulled) / frames;
+                summary.caveCulledMean = static_cast<double>(mCaveCulled) / frames;
+            }
+            summary.cpuCullMsP50 = percentile(mCpuCullMs, 0.50);
+            summary.cpuCullMsP99 = percentile(mCpuCullMs, 0.99);
+            return summary;
+        }
+
+        static double percentile(std::vector<double> samples, double p) {
+            if (samples.empty()) {
+                return 0.0;
+            }
+            size_t index = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+            std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+            return samples[index];
+        }
+
+    private:
+        std::vector<double> mFrameMs;
+        std::vector<double> mLatencyMs;
+        std::vector<double> mCpuCullMs;
+        uint64_t mCullFrames = 0;
+        uint64_t mVisible = 0;
+        uint64_t mOccluded = 0;
+        uint64_t mFrustumCulled = 0;
+        uint64_t mCaveCulled = 0;
+};
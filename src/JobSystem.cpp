@@ -0,0 +1,116 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+
+// Shared between the caller and the helper jobs, which may still be looking for work after the
+// caller has returned.
+struct ParallelRange {
+    size_t count = 0;
+    size_t grain = 1;
+    size_t chunks = 0;
+    const std::function<void(size_t, size_t)>* fn = nullptr;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0};
+    std::mutex mutex;
+    std::condition_variable done;
+
+    void drain() {
+        for (size_t chunk = next.fetch_add(1); chunk < chunks; chunk = next.fetch_add(1)) {
+            const size_t begin = chunk * grain;
+            (*fn)(begin, std::min(begin + grain, count));
+            if (finished.fetch_add(1) + 1 == chunks) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+};
+
+}
+
+JobSystem::JobSystem(unsigned workerCount) {
+    mWorkers.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; i++) {
+        mWorkers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+unsigned JobSystem::defaultWorkerCount() {
+    if (const char* env = std::getenv("MC_WORKER_THREADS")) {
+        return static_cast<unsigned>(std::strtoul(env, nullptr, 10));
+    }
+    const unsigned hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 0;
+}
+
+void JobSystem::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(std::move(job));
+    }
+    mWake.notify_one();
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunks = (count + grain - 1) / grain;
+    if (chunks == 1 || mWorkers.empty()) {
+        for (size_t begin = 0; begin < count; begin += grain) {
+            fn(begin, std::min(begin + grain, count));
+        }
+        return;
+    }
+
+    auto range = std::make_shared<ParallelRange>();
+    range->count = count;
+    range->grain = grain;
+    range->chunks = chunks;
+    range->fn = &fn;
+    const size_t helpers = std::min<size_t>(chunks - 1, mWorkers.size());
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (size_t i = 0; i < helpers; i++) {
+            mQueue.emplace_back([range] { range->drain(); });
+        }
+    }
+    mWake.notify_all();
+
+    range->drain();
+    std::unique_lock<std::mutex> lock(range->mutex);
+    range->done.wait(lock, [&] { return range->finished.load() == chunks; });
+}
+
+void JobSystem::workerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+            if (mStopping && mQueue.empty()) {
+                return;
+            }
+            job = std::move(mQueue.front());
+            mQueue.pop_front();
+        }
+        job();
+    }
+}
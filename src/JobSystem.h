@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed pool of worker threads fed from one shared queue. parallelFor() splits a range into
+// chunks that the workers and the calling thread pull from until the range is done, so it may
+// be called from inside a job without deadlocking the pool.
+class JobSystem {
+    public:
+        // MC_WORKER_THREADS overrides the default of one worker per hardware thread, minus the caller.
+        explicit JobSystem(unsigned workerCount = defaultWorkerCount());
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // Runs fn(begin, end) over [0, count) in chunks of at most grain items and returns once
+        // every chunk has finished.
+        void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+        // Queues a job that nothing waits on.
+        void submit(std::function<void()> job);
+
+        [[nodiscard]] unsigned workerCount() const { return static_cast<unsigned>(mWorkers.size()); }
+
+        static unsigned defaultWorkerCount();
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> mWorkers;
+        std::deque<std::function<void()>> mQueue;
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        bool mStopping = false;
+};
@@ -0,0 +1,161 @@
+#include "LodMesher.h"
+
+#include <algorithm>
+
+namespace {
+
+// Cells of one downsampled section laid out like Section::index() at n = SIZE / factor per
+// axis; empty when the whole section is air.
+void downsample(const Section& section, int factor, std::vector<BlockId>& cells, std::vector<uint32_t>& blocks) {
+    cells.clear();
+    if (section.isEmpty()) {
+        return;
+    }
+    const int n = Section::SIZE / factor;
+    if (section.isUniform()) {
+        cells.assign(static_cast<size_t>(n) * n * n, section.palette()[0]);
+        return;
+    }
+
+    section.decode(blocks.data());
+    cells.assign(static_cast<size_t>(n) * n * n, AIR);
+    for (int cy = 0; cy < n; cy++) {
+        for (int cz = 0; cz < n; cz++) {
+            for (int cx = 0; cx < n; cx++) {
+                std::array<int, BLOCK_COUNT> counts{};
+                BlockId best = AIR;
+                int bestCount = 0;
+                for (int y = cy * factor; y < (cy + 1) * factor; y++) {
+                    for (int z = cz * factor; z < (cz + 1) * factor; z++) {
+                        for (int x = cx * factor; x < (cx + 1) * factor; x++) {
+                            const auto block = static_cast<BlockId>(blocks[Section::index(x, y, z)]);
+                            if (block == AIR || block >= BLOCK_COUNT) {
+                                continue;
+                            }
+                            if (++counts[block] > bestCount) {
+                                best = block;
+                                bestCount = counts[block];
+                            }
+                        }
+                    }
+                }
+                cells[(cy * n + cz) * n + cx] = best;
+            }
+        }
+    }
+}
+
+// Solidity of one cell of a section in a neighbouring column, sampled straight from its blocks
+// since only the cells along the shared border are needed.
+bool cellSolid(const Section& section, int factor, int cx, int cy, int cz) {
+    if (section.isEmpty()) {
+        return false;
+    }
+    if (section.isUniform()) {
+        return true;
+    }
+    for (int y = cy * factor; y < (cy + 1) * factor; y++) {
+        for (int z = cz * factor; z < (cz + 1) * factor; z++) {
+            for (int x = cx * factor; x < (cx + 1) * factor; x++) {
+                if (section.get(x, y, z) != AIR) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+}
+
+void meshLodColumn(const World& world, ColumnPos pos, int lod, LodColumnMesh& out) {
+    out.vertices.clear();
+    out.sectionOffsets.fill(0);
+    const Column* column = world.column(pos);
+    if (column == nullptr) {
+        return;
+    }
+
+    const int factor = lodFactor(lod);
+    const int n = Section::SIZE / factor;
+    std::array<std::vector<BlockId>, Column::SECTIONS> cells;
+    std::vector<uint32_t> blocks(Section::VOLUME);
+    for (int sy = 0; sy < Column::SECTIONS; sy++) {
+        downsample(column->section(sy), factor, cells[sy], blocks);
+    }
+
+    std::array<const Column*, FACE_COUNT> neighbors{};
+    for (int face : {FACE_NEG_X, FACE_POS_X, FACE_NEG_Z, FACE_POS_Z}) {
+        neighbors[face] = world.column({pos.x + FACE_OFFSETS[face][0], pos.z + FACE_OFFSETS[face][2]});
+    }
+
+    // Vertical lookups may step into the sections above and below.
+    auto solidAt = [&](int sy, int x, int y, int z) {
+        if (y < 0) {
+            sy--;
+            y += n;
+        } else if (y >= n) {
+            sy++;
+            y -= n;
+        }
+        if (sy < 0 || sy >= Column::SECTIONS || cells[sy].empty()) {
+            return false;
+        }
+        return cells[sy][(y * n + z) * n + x] != AIR;
+    };
+
+    for (int sy = 0; sy < Column::SECTIONS; sy++) {
+        out.sectionOffsets[sy] = static_cast<uint32_t>(out.vertices.size());
+        if (cells[sy].empty()) {
+            continue;
+        }
+        for (int y = 0; y < n; y++) {
+            for (int z = 0; z < n; z++) {
+                for (int x = 0; x < n; x++) {
+                    const BlockId block = cells[sy][(y * n + z) * n + x];
+                    if (block == AIR) {
+                        continue;
+                    }
+                    const bool surface = !solidAt(sy, x, y + 1, z);
+                    const float* color = blockInfo(block).color;
+                    for (int face = 0; face < FACE_COUNT; face++) {
+                        const int nx = x + FACE_OFFSETS[face][0];
+                        const int ny = y + FACE_OFFSETS[face][1];
+                        const int nz = z + FACE_OFFSETS[face][2];
+                        bool open;
+                        if (nx < 0 || nx >= n || nz < 0 || nz >= n) {
+                            const Column* neighbor = neighbors[face];
+                            open = surface || neighbor == nullptr || !cellSolid(neighbor->section(sy), factor, (nx + n) % n, y, (nz + n) % n);
+                        } else {
+                            open = !solidAt(sy, nx, ny, nz);
+                        }
+                        if (open) {
+                            emitQuad(x * factor, y * factor, z * factor, face, color, out.vertices, factor);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    out.sectionOffsets[Column::SECTIONS] = static_cast<uint32_t>(out.vertices.size());
+}
+
+int selectLod(int current, float distance, float baseDistance, float hysteresis) {
+    auto levelAt = [&](float d) {
+        int level = 0;
+        float reach = baseDistance;
+        while (level + 1 < LOD_LEVELS && d >= reach) {
+            level++;
+            reach *= 2.0f;
+        }
+        return level;
+    };
+    const int level = levelAt(distance);
+    if (current < 0 || level == current) {
+        return level;
+    }
+    if (level > current) {
+        return std::max(current, levelAt(distance - hysteresis));
+    }
+    return std::min(current, levelAt(distance + hysteresis));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Mesher.h"
+#include "World.h"
+
+// Level 0 is full resolution (the GPU mesher); levels 1-3 merge 2, 4 and 8 blocks per axis.
+constexpr int LOD_LEVELS = 4;
+
+inline int lodFactor(int lod) {
+    return 1 << lod;
+}
+
+struct LodColumnMesh {
+    std::vector<MeshVertex> vertices;
+    // Section sy owns vertices [sectionOffsets[sy], sectionOffsets[sy + 1]), in section-local
+    // coordinates like the GPU mesher's output.
+    std::array<uint32_t, Column::SECTIONS + 1> sectionOffsets{};
+};
+
+// Meshes every section of a column at 1 / lodFactor(lod) resolution. A cell is solid when any
+// block in it is not air and takes the colour of its most common block, so coarse terrain never
+// sits below finer terrain next to it and distant water and foliage keep their surfaces. Surface
+// cells on the column border always emit their side faces as skirts, which hides the seams
+// against finer neighbours.
+void meshLodColumn(const World& world, ColumnPos pos, int lod, LodColumnMesh& out);
+
+// Level for a column at `distance` columns from the camera: level L reaches baseDistance * 2^L.
+// A column only leaves its current level once it is `hysteresis` columns past the boundary.
+// A negative current level selects without hysteresis.
+int selectLod(int current, float distance, float baseDistance, float hysteresis);
@@ -0,0 +1,93 @@
+#include "Mesher.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Block.h"
+#include "Section.h"
+
+// Corners of each face of the unit cube, counter-clockwise seen from outside.
+static constexpr int FACE_CORNERS[FACE_COUNT][4][3] = {
+    {{0, 0, 0}, {0, 0, 1}, {0, 1, 1}, {0, 1, 0}},
+    {{1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1}},
+    {{0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1}},
+    {{0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {1, 1, 0}},
+    {{0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0}},
+    {{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}},
+};
+
+static constexpr int QUAD_TRIANGLES[VERTICES_PER_QUAD] = {0, 1, 2, 0, 2, 3};
+
+void emitQuad(int x, int y, int z, int face, const float color[3], std::vector<MeshVertex>& out, int size) {
+    const float shade = FACE_SHADE[face];
+    for (int corner : QUAD_TRIANGLES) {
+        MeshVertex v{};
+        v.pos[0] = static_cast<float>(x + FACE_CORNERS[face][corner][0] * size);
+        v.pos[1] = static_cast<float>(y + FACE_CORNERS[face][corner][1] * size);
+        v.pos[2] = static_cast<float>(z + FACE_CORNERS[face][corner][2] * size);
+        v.color[0] = color[0] * shade;
+        v.color[1] = color[1] * shade;
+        v.color[2] = color[2] * shade;
+        out.push_back(v);
+    }
+}
+
+static uint32_t neighborBlock(const uint32_t* blocks, const SectionNeighbors& neighbors, int x, int y, int z, int face) {
+    int nx = x + FACE_OFFSETS[face][0];
+    int ny = y + FACE_OFFSETS[face][1];
+    int nz = z + FACE_OFFSETS[face][2];
+    if (nx >= 0 && nx < Section::SIZE && ny >= 0 && ny < Section::SIZE && nz >= 0 && nz < Section::SIZE) {
+        return blocks[Section::index(nx, ny, nz)];
+    }
+    const uint32_t* neighbor = neighbors[face];
+    if (neighbor == nullptr) {
+        return AIR;
+    }
+    return neighbor[Section::index(nx & (Section::SIZE - 1), ny & (Section::SIZE - 1), nz & (Section::SIZE - 1))];
+}
+
+void meshSectionReference(const uint32_t* blocks, const SectionNeighbors& neighbors, std::vector<MeshVertex>& out) {
+    for (int y = 0; y < Section::SIZE; y++) {
+        for (int z = 0; z < Section::SIZE; z++) {
+            for (int x = 0; x < Section::SIZE; x++) {
+                const uint32_t block = blocks[Section::index(x, y, z)];
+                if (block == AIR) {
+                    continue;
+                }
+                for (int face = 0; face < FACE_COUNT; face++) {
+                    const uint32_t neighbor = neighborBlock(blocks, neighbors, x, y, z, face);
+                    if (neighbor != block && !isOpaque(static_cast<BlockId>(neighbor))) {
+                        emitQuad(x, y, z, face, blockInfo(static_cast<BlockId>(block)).color, out);
+                    }
+                }
+            }
+        }
+    }
+}
+
+using Quad = std::array<float, VERTICES_PER_QUAD * 6>;
+
+static std::vector<Quad> toQuads(const MeshVertex* vertices, size_t vertexCount) {
+    std::vector<Quad> quads(vertexCount / VERTICES_PER_QUAD);
+    for (size_t q = 0; q < quads.size(); q++) {
+        for (int v = 0; v < VERTICES_PER_QUAD; v++) {
+            const MeshVertex& vertex = vertices[q * VERTICES_PER_QUAD + v];
+            std::copy(vertex.pos, vertex.pos + 3, quads[q].begin() + v * 6);
+            std::copy(vertex.color, vertex.color + 3, quads[q].begin() + v * 6 + 3);
+        }
+    }
+    std::sort(quads.begin(), quads.end());
+    return quads;
+}
+
+bool meshesMatch(const MeshVertex* a, const MeshVertex* b, size_t vertexCount, float epsilon) {
+    std::vector<Quad> quadsA = toQuads(a, vertexCount);
+    std::vector<Quad> quadsB = toQuads(b, vertexCount);
+    for (size_t q = 0; q < quadsA.size(); q++) {
+        for (size_t i = 0; i < quadsA[q].size(); i++) {
+            if (std::fabs(quadsA[q][i] - quadsB[q][i]) > epsilon) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
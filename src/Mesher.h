@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Matches the layout of the vertex buffer binding (vec3 position, vec3 color) and the
+// records the GPU mesher (Shaders/mesher.comp) appends into the vertex arena.
+struct MeshVertex {
+    float pos[3];
+    float color[3];
+};
+
+// Face order shared with mesher.comp: -X, +X, -Y, +Y, -Z, +Z.
+enum Face : int {
+    FACE_NEG_X = 0,
+    FACE_POS_X,
+    FACE_NEG_Y,
+    FACE_POS_Y,
+    FACE_NEG_Z,
+    FACE_POS_Z,
+    FACE_COUNT
+};
+
+inline constexpr int FACE_OFFSETS[FACE_COUNT][3] = {
+    {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}
+};
+
+inline constexpr float FACE_SHADE[FACE_COUNT] = {0.8f, 0.8f, 0.5f, 1.0f, 0.7f, 0.7f};
+
+constexpr int VERTICES_PER_QUAD = 6;
+
+// Palette-decoded section data (Section::VOLUME ids) and its six neighbours in face order.
+// A null neighbour is treated as air.
+using SectionNeighbors = std::array<const uint32_t*, FACE_COUNT>;
+
+// CPU reference mesher: one quad per block face whose neighbour is not opaque and not the
+// same block. Emits the same vertices as mesher.comp so GPU output can be validated.
+void meshSectionReference(const uint32_t* blocks, const SectionNeighbors& neighbors, std::vector<MeshVertex>& out);
+
+// Appends the two triangles of one face of the cube with the given edge length at (x, y, z).
+void emitQuad(int x, int y, int z, int face, const float color[3], std::vector<MeshVertex>& out, int size = 1);
+
+// Compares two meshes as unordered sets of quads, since the GPU appends quads in whatever
+// order its invocations win the atomic.
+bool meshesMatch(const MeshVertex* a, const MeshVertex* b, size_t vertexCount, float epsilon = 1e-4f);
@@ -0,0 +1,62 @@
+#include "Models.h"
+
+namespace {
+
+constexpr float WHITE[3] = {1.0f, 1.0f, 1.0f};
+
+// From the unit cube's faces, so winding and shading match the terrain.
+void appendBox(float halfWidth, float bottom, float height, std::vector<MeshVertex>& out) {
+    const size_t first = out.size();
+    for (int face = 0; face < FACE_COUNT; face++) {
+        emitQuad(0, 0, 0, face, WHITE, out);
+    }
+    for (size_t i = first; i < out.size(); i++) {
+        MeshVertex& vertex = out[i];
+        vertex.pos[0] = (vertex.pos[0] - 0.5f) * 2.0f * halfWidth;
+        vertex.pos[1] = bottom + vertex.pos[1] * height;
+        vertex.pos[2] = (vertex.pos[2] - 0.5f) * 2.0f * halfWidth;
+    }
+}
+
+// Two upright quads crossing on the diagonals. Each is emitted in both windings, since the
+// model pipeline culls back faces.
+void appendCross(float halfWidth, float height, std::vector<MeshVertex>& out) {
+    constexpr int FRONT[VERTICES_PER_QUAD] = {0, 1, 2, 0, 2, 3};
+    constexpr int BACK[VERTICES_PER_QUAD] = {0, 2, 1, 0, 3, 2};
+    for (float diagonal : {1.0f, -1.0f}) {
+        const float corners[4][3] = {
+            {-halfWidth, 0.0f, -halfWidth * diagonal},
+            {halfWidth, 0.0f, halfWidth * diagonal},
+            {halfWidth, height, halfWidth * diagonal},
+            {-halfWidth, height, -halfWidth * diagonal},
+        };
+        for (const int* order : {FRONT, BACK}) {
+            const float shade = order == FRONT ? 1.0f : 0.8f;
+            for (int v = 0; v < VERTICES_PER_QUAD; v++) {
+                const float* corner = corners[order[v]];
+                out.push_back({{corner[0], corner[1], corner[2]}, {shade, shade, shade}});
+            }
+        }
+    }
+}
+
+}
+
+std::vector<MeshVertex> buildModelMesh(ModelMesh mesh) {
+    std::vector<MeshVertex> vertices;
+    switch (mesh) {
+        case MODEL_ITEM_DROP:
+            appendBox(0.125f, 0.1f, 0.25f, vertices);
+            break;
+        case MODEL_FOLIAGE:
+            appendCross(0.45f, 0.9f, vertices);
+            break;
+        case MODEL_MOB:
+            appendBox(0.3f, 0.0f, 1.4f, vertices);
+            appendBox(0.25f, 1.4f, 0.5f, vertices);
+            break;
+        case MODEL_MESH_COUNT:
+            break;
+    }
+    return vertices;
+}
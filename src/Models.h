@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Mesher.h"
+
+// Meshes drawn many times over through the instanced model path, one draw per mesh however
+// many copies there are. Vertices are in blocks around the model's origin at its bottom
+// centre, and white apart from face shading, so each instance's tint colours it.
+enum ModelMesh : uint32_t {
+    MODEL_ITEM_DROP = 0,
+    MODEL_FOLIAGE,
+    MODEL_MOB,
+    MODEL_MESH_COUNT
+};
+
+std::vector<MeshVertex> buildModelMesh(ModelMesh mesh);
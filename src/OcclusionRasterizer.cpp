@@ -0,0 +1,260 @@
+#include "OcclusionRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Simd.h"
+
+namespace {
+
+// Vertices this close to the eye plane are rejected rather than clipped: dropping an occluder
+// only loses culling, and a box reaching behind the camera is simply kept.
+constexpr float MIN_W = 1e-3f;
+// Keeps a box from being hidden by its own coplanar face through rounding.
+constexpr float DEPTH_BIAS = 1e-6f;
+
+}
+
+OcclusionRasterizer::Quad OcclusionRasterizer::cubeFace(const float origin[3], float size, int axis, bool positive) {
+    const int u = (axis + 1) % 3;
+    const int v = (axis + 2) % 3;
+    Quad quad{};
+    const float uv[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+    for (int i = 0; i < 4; i++) {
+        float* corner = quad.corners[positive ? i : 3 - i];
+        corner[axis] = origin[axis] + (positive ? size : 0.0f);
+        corner[u] = origin[u] + uv[i][0] * size;
+        corner[v] = origin[v] + uv[i][1] * size;
+    }
+    return quad;
+}
+
+OcclusionRasterizer::OcclusionRasterizer() : mViewProj{}, mDepth(static_cast<size_t>(WIDTH) * HEIGHT, 1.0f),
+    mTileMax(static_cast<size_t>(TILES_X) * TILES_Y, 1.0f) {}
+
+bool OcclusionRasterizer::project(const float p[3], Projected& out) const {
+    const float* m = mViewProj;
+    const float x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+    const float y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+    const float z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+    const float w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+    if (w < MIN_W) {
+        return false;
+    }
+    const float invW = 1.0f / w;
+    out.x = (x * invW * 0.5f + 0.5f) * WIDTH;
+    out.y = (y * invW * 0.5f + 0.5f) * HEIGHT;
+    out.z = z * invW;
+    return true;
+}
+
+bool OcclusionRasterizer::setupTriangle(const Projected& a, const Projected& b, const Projected& c, Triangle& out) const {
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::fabs(area) < 1e-6f) {
+        return false;
+    }
+    const Projected* v[3] = {&a, &b, &c};
+    if (area < 0.0f) {
+        std::swap(v[1], v[2]);
+        area = -area;
+    }
+
+    // Covers pixels whose centers lie inside the triangle.
+    const float minX = std::min({a.x, b.x, c.x});
+    const float maxX = std::max({a.x, b.x, c.x});
+    const float minY = std::min({a.y, b.y, c.y});
+    const float maxY = std::max({a.y, b.y, c.y});
+    out.minX = std::max(0, static_cast<int>(std::ceil(minX - 0.5f)));
+    out.maxX = std::min(WIDTH - 1, static_cast<int>(std::floor(maxX - 0.5f)));
+    out.minY = std::max(0, static_cast<int>(std::ceil(minY - 0.5f)));
+    out.maxY = std::min(HEIGHT - 1, static_cast<int>(std::floor(maxY - 0.5f)));
+    if (out.minX > out.maxX || out.minY > out.maxY) {
+        return false;
+    }
+
+    // E(x, y) = A x + B y + C is non-negative on the inner side of each edge.
+    for (int e = 0; e < 3; e++) {
+        const Projected& p0 = *v[e];
+        const Projected& p1 = *v[(e + 1) % 3];
+        out.edgeA[e] = p0.y - p1.y;
+        out.edgeB[e] = p1.x - p0.x;
+        out.edgeC[e] = p0.x * p1.y - p0.y * p1.x;
+    }
+
+    const Projected& p0 = *v[0];
+    const Projected& p1 = *v[1];
+    const Projected& p2 = *v[2];
+    out.depthA = ((p1.z - p0.z) * (p2.y - p0.y) - (p2.z - p0.z) * (p1.y - p0.y)) / area;
+    out.depthB = ((p2.z - p0.z) * (p1.x - p0.x) - (p1.z - p0.z) * (p2.x - p0.x)) / area;
+    out.depthC = p0.z - out.depthA * p0.x - out.depthB * p0.y;
+    return true;
+}
+
+void OcclusionRasterizer::begin(const float viewProj[16], const std::vector<Quad>& occluders, size_t maxOccluders) {
+    std::copy(viewProj, viewProj + 16, mViewProj);
+    std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+    std::fill(mTileMax.begin(), mTileMax.end(), 1.0f);
+    mTriangles.clear();
+
+    struct Candidate {
+        float area;
+        Projected corners[4];
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(occluders.size());
+    for (const Quad& quad : occluders) {
+        Candidate candidate{};
+        bool inFront = true;
+        for (int i = 0; i < 4 && inFront; i++) {
+            inFront = project(quad.corners[i], candidate.corners[i]) && candidate.corners[i].z >= 0.0f;
+        }
+        if (!inFront) {
+            continue;
+        }
+        const Projected* c = candidate.corners;
+        candidate.area = 0.5f * std::fabs((c[2].x - c[0].x) * (c[3].y - c[1].y) - (c[3].x - c[1].x) * (c[2].y - c[0].y));
+        if (candidate.area >= 1.0f) {
+            candidates.push_back(candidate);
+        }
+    }
+
+    if (candidates.size() > maxOccluders) {
+        std::nth_element(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(maxOccluders), candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.area > b.area; });
+        candidates.resize(maxOccluders);
+    }
+
+    mTriangles.reserve(candidates.size() * 2);
+    for (const Candidate& candidate : candidates) {
+        const Projected* c = candidate.corners;
+        Triangle triangle;
+        if (setupTriangle(c[0], c[1], c[2], triangle)) {
+            mTriangles.push_back(triangle);
+        }
+        if (setupTriangle(c[0], c[2], c[3], triangle)) {
+            mTriangles.push_back(triangle);
+        }
+    }
+}
+
+void OcclusionRasterizer::rasterizeBand(int band) {
+    const int bandMinY = band * BAND_HEIGHT;
+    const int bandMaxY = bandMinY + BAND_HEIGHT - 1;
+    const Float4 laneOffsets = Float4::set(0.5f, 1.5f, 2.5f, 3.5f);
+    const Float4 zero = Float4::splat(0.0f);
+
+    for (const Triangle& tri : mTriangles) {
+        const int y0 = std::max(tri.minY, bandMinY);
+        const int y1 = std::min(tri.maxY, bandMaxY);
+        if (y0 > y1) {
+            continue;
+        }
+        // WIDTH is a multiple of four, so aligned groups never run past the row.
+        const int x0 = tri.minX & ~3;
+        const Float4 xs = Float4::splat(static_cast<float>(x0)) + laneOffsets;
+        const Float4 stepA0 = Float4::splat(tri.edgeA[0] * 4.0f);
+        const Float4 stepA1 = Float4::splat(tri.edgeA[1] * 4.0f);
+        const Float4 stepA2 = Float4::splat(tri.edgeA[2] * 4.0f);
+        const Float4 stepZ = Float4::splat(tri.depthA * 4.0f);
+
+        for (int y = y0; y <= y1; y++) {
+            const float cy = static_cast<float>(y) + 0.5f;
+            Float4 e0 = Float4::splat(tri.edgeA[0]) * xs + Float4::splat(tri.edgeB[0] * cy + tri.edgeC[0]);
+            Float4 e1 = Float4::splat(tri.edgeA[1]) * xs + Float4::splat(tri.edgeB[1] * cy + tri.edgeC[1]);
+            Float4 e2 = Float4::splat(tri.edgeA[2]) * xs + Float4::splat(tri.edgeB[2] * cy + tri.edgeC[2]);
+            Float4 z = Float4::splat(tri.depthA) * xs + Float4::splat(tri.depthB * cy + tri.depthC);
+            float* row = mDepth.data() + static_cast<size_t>(y) * WIDTH;
+
+            for (int x = x0; x <= tri.maxX; x += 4) {
+                const Float4 inside = (e0 >= zero) & (e1 >= zero) & (e2 >= zero);
+                if (mask(inside) != 0) {
+                    const Float4 current = Float4::load(row + x);
+                    select(inside, min(current, z), current).store(row + x);
+                }
+                e0 = e0 + stepA0;
+                e1 = e1 + stepA1;
+                e2 = e2 + stepA2;
+                z = z + stepZ;
+            }
+        }
+    }
+
+    for (int ty = bandMinY / TILE_SIZE; ty <= bandMaxY / TILE_SIZE; ty++) {
+        for (int tx = 0; tx < TILES_X; tx++) {
+            Float4 farthest = zero;
+            for (int y = ty * TILE_SIZE; y < (ty + 1) * TILE_SIZE; y++) {
+                const float* row = mDepth.data() + static_cast<size_t>(y) * WIDTH + tx * TILE_SIZE;
+                farthest = max(farthest, max(Float4::load(row), Float4::load(row + 4)));
+            }
+            float lanes[4];
+            farthest.store(lanes);
+            mTileMax[static_cast<size_t>(ty) * TILES_X + tx] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        }
+    }
+}
+
+bool OcclusionRasterizer::isVisible(const float minCorner[3], const float maxCorner[3]) const {
+    float minX = static_cast<float>(WIDTH);
+    float maxX = 0.0f;
+    float minY = static_cast<float>(HEIGHT);
+    float maxY = 0.0f;
+    float nearest = 1.0f;
+    for (int i = 0; i < 8; i++) {
+        const float corner[3] = {
+            (i & 1) != 0 ? maxCorner[0] : minCorner[0],
+            (i & 2) != 0 ? maxCorner[1] : minCorner[1],
+            (i & 4) != 0 ? maxCorner[2] : minCorner[2],
+        };
+        Projected p{};
+        if (!project(corner, p)) {
+            return true;
+        }
+        minX = std::min(minX, p.x);
+        maxX = std::max(maxX, p.x);
+        minY = std::min(minY, p.y);
+        maxY = std::max(maxY, p.y);
+        nearest = std::min(nearest, p.z);
+    }
+    // Off-screen boxes are left to the frustum test.
+    if (maxX < 0.0f || minX >= WIDTH || maxY < 0.0f || minY >= HEIGHT) {
+        return true;
+    }
+
+    // Every pixel the rectangle touches, not just the ones whose centers it covers.
+    const int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+    const int x1 = std::min(WIDTH - 1, static_cast<int>(std::floor(maxX)));
+    const int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+    const int y1 = std::min(HEIGHT - 1, static_cast<int>(std::floor(maxY)));
+    const float threshold = nearest - DEPTH_BIAS;
+
+    // Conservative early out: the touched tiles cover the rectangle.
+    bool tilesCloser = true;
+    for (int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE && tilesCloser; ty++) {
+        for (int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++) {
+            if (mTileMax[static_cast<size_t>(ty) * TILES_X + tx] >= threshold) {
+                tilesCloser = false;
+                break;
+            }
+        }
+    }
+    if (tilesCloser) {
+        return false;
+    }
+
+    const Float4 threshold4 = Float4::splat(threshold);
+    for (int y = y0; y <= y1; y++) {
+        const float* row = mDepth.data() + static_cast<size_t>(y) * WIDTH;
+        for (int x = x0 & ~3; x <= x1; x += 4) {
+            int lanes = 0xF;
+            if (x < x0) {
+                lanes &= 0xF << (x0 - x);
+            }
+            if (x + 3 > x1) {
+                lanes &= 0xF >> (x + 3 - x1);
+            }
+            if ((mask(Float4::load(row + x) >= threshold4) & lanes) != 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Low-resolution software depth buffer for occlusion culling without the GPU pyramid. Large
+// occluder quads are rasterized into it with four-wide SIMD, after which section boxes are
+// tested against it. Rows are split into bands so rasterization can be spread across jobs.
+class OcclusionRasterizer {
+    public:
+        static constexpr int WIDTH = 256;
+        static constexpr int HEIGHT = 128;
+        static constexpr int BAND_HEIGHT = 16;
+        static constexpr int BANDS = HEIGHT / BAND_HEIGHT;
+        static constexpr int TILE_SIZE = 8;
+        static constexpr int TILES_X = WIDTH / TILE_SIZE;
+        static constexpr int TILES_Y = HEIGHT / TILE_SIZE;
+
+        // World-space corners in winding order.
+        struct Quad {
+            float corners[4][3];
+        };
+
+        // One face of the axis-aligned cube of the given size at origin, facing along +axis or -axis.
+        static Quad cubeFace(const float origin[3], float size, int axis, bool positive);
+
+        OcclusionRasterizer();
+
+        // Projects the occluders with a column-major view-projection matrix (Vulkan clip space,
+        // depth 0..1) and keeps the maxOccluders with the largest screen area. Clears the buffer.
+        void begin(const float viewProj[16], const std::vector<Quad>& occluders, size_t maxOccluders);
+        // Rasterizes every kept occluder into the rows of one band, then refreshes the band's
+        // tile maxima. Bands are independent.
+        void rasterizeBand(int band);
+        // False only when every pixel under the box's screen rectangle holds nearer occluder depth.
+        [[nodiscard]] bool isVisible(const float minCorner[3], const float maxCorner[3]) const;
+
+        [[nodiscard]] size_t occluderCount() const { return mTriangles.size() / 2; }
+
+    private:
+        // Edge functions and the depth plane in pixel space, evaluated at pixel centers.
+        struct Triangle {
+            float edgeA[3], edgeB[3], edgeC[3];
+            float depthA, depthB, depthC;
+            int minX, maxX, minY, maxY;
+        };
+
+        struct Projected {
+            float x, y, z;
+        };
+
+        bool project(const float p[3], Projected& out) const;
+        bool setupTriangle(const Projected& a, const Projected& b, const Projected& c, Triangle& out) const;
+
+        float mViewProj[16];
+        std::vector<Triangle> mTriangles;
+        // Nearest depth per pixel, row-major; 1.0 where nothing has been drawn.
+        std::vector<float> mDepth;
+        // Farthest depth of each TILE_SIZE square, so boxes behind solid walls are rejected
+        // without visiting every pixel.
+        std::vector<float> mTileMax;
+};
@@ -0,0 +1,212 @@
+#include "RandomTicks.h"
+
+#include <array>
+#include <unordered_set>
+#include "JobSystem.h"
+#include "Simd.h"
+
+namespace {
+
+constexpr int PHASES = 3;
+constexpr int POSITIONS_PER_COLUMN = Column::SECTIONS * RandomTickEngine::TICKS_PER_SECTION;
+// Grass looks for dirt this far away.
+constexpr int GRASS_SPREAD_DOWN = 3;
+constexpr int LEAF_SUPPORT_RADIUS = 2;
+
+uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Four interleaved xorshift32 generators.
+class Xorshift4 {
+    public:
+        explicit Xorshift4(uint64_t seed) {
+            uint32_t lanes[4];
+            for (uint32_t& lane : lanes) {
+                do {
+                    lane = static_cast<uint32_t>(splitMix64(seed));
+                } while (lane == 0);
+            }
+            mState = UInt4::set(lanes[0], lanes[1], lanes[2], lanes[3]);
+        }
+
+        // count must be a multiple of four.
+        void fill(uint32_t* out, size_t count) {
+            for (size_t i = 0; i < count; i += 4) {
+                mState = mState ^ shiftLeft<13>(mState);
+                mState = mState ^ shiftRight<17>(mState);
+                mState = mState ^ shiftLeft<5>(mState);
+                mState.store(out + i);
+            }
+        }
+
+    private:
+        UInt4 mState;
+};
+
+constexpr std::array<bool, BLOCK_COUNT> tickableBlocks() {
+    std::array<bool, BLOCK_COUNT> tickable{};
+    tickable[GRASS] = true;
+    tickable[LEAVES] = true;
+    return tickable;
+}
+
+constexpr std::array<bool, BLOCK_COUNT> TICKABLE = tickableBlocks();
+
+bool hasTickableBlocks(const Section& section) {
+    if (section.isEmpty()) {
+        return false;
+    }
+    for (BlockId block : section.palette()) {
+        if (block < BLOCK_COUNT && TICKABLE[block]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<BlockPos> tickGrass(World& world, BlockPos pos, uint32_t random) {
+    if (isOpaque(world.getBlock(pos.x, pos.y + 1, pos.z))) {
+        world.setBlock(pos.x, pos.y, pos.z, DIRT);
+        return pos;
+    }
+    // One try at a block within one step sideways, up to three down or one up.
+    const int32_t x = pos.x + static_cast<int32_t>(random % 3) - 1;
+    const int32_t z = pos.z + static_cast<int32_t>((random / 3) % 3) - 1;
+    const int32_t y = pos.y + static_cast<int32_t>((random / 9) % (GRASS_SPREAD_DOWN + 2)) - GRASS_SPREAD_DOWN;
+    if (world.getBlock(x, y, z) == DIRT && !isOpaque(world.getBlock(x, y + 1, z))) {
+        world.setBlock(x, y, z, GRASS);
+        return BlockPos{x, y, z};
+    }
+    return std::nullopt;
+}
+
+std::optional<BlockPos> tickLeaves(World& world, BlockPos pos) {
+    for (int dy = -LEAF_SUPPORT_RADIUS; dy <= LEAF_SUPPORT_RADIUS; dy++) {
+        for (int dz = -LEAF_SUPPORT_RADIUS; dz <= LEAF_SUPPORT_RADIUS; dz++) {
+            for (int dx = -LEAF_SUPPORT_RADIUS; dx <= LEAF_SUPPORT_RADIUS; dx++) {
+                if (world.getBlock(pos.x + dx, pos.y + dy, pos.z + dz) == LOG) {
+                    return std::nullopt;
+                }
+            }
+        }
+    }
+    world.setBlock(pos.x, pos.y, pos.z, AIR);
+    return pos;
+}
+
+}
+
+bool RandomTickEngine::ticksRandomly(BlockId block) {
+    return block < BLOCK_COUNT && TICKABLE[block];
+}
+
+std::optional<BlockPos> RandomTickEngine::randomTick(World& world, BlockPos pos, BlockId block, uint32_t random) {
+    switch (block) {
+        case GRASS:
+            return tickGrass(world, pos, random);
+        case LEAVES:
+            return tickLeaves(world, pos);
+        default:
+            return std::nullopt;
+    }
+}
+
+void RandomTickEngine::tickColumn(World& world, ColumnPos pos, ColumnResult& result) const {
+    const Column* column = world.column(pos);
+    // Seeded by tick and column so results don't depend on which thread runs the column.
+    uint64_t seed = mSeed ^ (mTick * 0x9E3779B97F4A7C15ull) ^ ColumnPosHash()(pos);
+    Xorshift4 rng(splitMix64(seed));
+    std::array<uint32_t, POSITIONS_PER_COLUMN> randoms;
+    rng.fill(randoms.data(), randoms.size());
+
+    struct Candidate {
+        BlockPos pos;
+        uint32_t random;
+    };
+    std::array<std::array<Candidate, POSITIONS_PER_COLUMN>, BLOCK_COUNT> batches;
+    std::array<int, BLOCK_COUNT> batchSizes{};
+    for (int sy = 0; sy < Column::SECTIONS; sy++) {
+        const Section& section = column->section(sy);
+        result.stats.sections++;
+        if (!hasTickableBlocks(section)) {
+            result.stats.skipped++;
+            continue;
+        }
+        for (int i = 0; i < TICKS_PER_SECTION; i++) {
+            // 12 bits pick the block; the rest go to the block's tick.
+            const uint32_t random = randoms[sy * TICKS_PER_SECTION + i];
+            const int x = static_cast<int>(random & 15);
+            const int z = static_cast<int>((random >> 4) & 15);
+            const int y = static_cast<int>((random >> 8) & 15);
+            const BlockId block = section.get(x, y, z);
+            if (block < BLOCK_COUNT && TICKABLE[block]) {
+                const BlockPos blockPos{pos.x * Section::SIZE + x, sy * Section::SIZE + y, pos.z * Section::SIZE + z};
+                batches[block][batchSizes[block]++] = {blockPos, random >> 12};
+            }
+        }
+    }
+
+    for (BlockId block = 0; block < BLOCK_COUNT; block++) {
+        for (int i = 0; i < batchSizes[block]; i++) {
+            const Candidate& candidate = batches[block][i];
+            result.stats.ticked++;
+            // An earlier tick in this column may have replaced the block.
+            if (column->get(blockInSection(candidate.pos.x), candidate.pos.y, blockInSection(candidate.pos.z)) != block) {
+                continue;
+            }
+            if (const std::optional<BlockPos> changed = randomTick(world, candidate.pos, block, candidate.random)) {
+                result.stats.changed++;
+                result.changed.push_back(changed.value());
+            }
+        }
+    }
+}
+
+RandomTickEngine::TickStats RandomTickEngine::tick(World& world, JobSystem& jobs) {
+    mTick++;
+    std::array<std::vector<ColumnPos>, PHASES * PHASES> phases;
+    for (const auto& [pos, column] : world.columns()) {
+        const int px = ((pos.x % PHASES) + PHASES) % PHASES;
+        const int pz = ((pos.z % PHASES) + PHASES) % PHASES;
+        phases[px * PHASES + pz].push_back(pos);
+    }
+
+    TickStats stats;
+    std::unordered_set<SectionPos, SectionPosHash> dirty;
+    std::vector<ColumnResult> results;
+    for (const std::vector<ColumnPos>& columns : phases) {
+        results.assign(columns.size(), {});
+        jobs.parallelFor(columns.size(), 4, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                tickColumn(world, columns[i], results[i]);
+            }
+        });
+        for (const ColumnResult& result : results) {
+            stats.sections += result.stats.sections;
+            stats.skipped += result.stats.skipped;
+            stats.ticked += result.stats.ticked;
+            stats.changed += result.stats.changed;
+            // Every tick changes at most one block; its neighbours need remeshing too.
+            for (const BlockPos& pos : result.changed) {
+                for (int axis = 0; axis < 3; axis++) {
+                    for (int step = -1; step <= 1; step++) {
+                        BlockPos neighbor = pos;
+                        (axis == 0 ? neighbor.x : axis == 1 ? neighbor.y : neighbor.z) += step;
+                        dirty.insert({blockToSection(neighbor.x), blockToSection(neighbor.y), blockToSection(neighbor.z)});
+                    }
+                }
+            }
+        }
+    }
+    mDirtySections.insert(mDirtySections.end(), dirty.begin(), dirty.end());
+    return stats;
+}
+
+void RandomTickEngine::takeDirtySections(std::vector<SectionPos>& out) {
+    out.insert(out.end(), mDirtySections.begin(), mDirtySections.end());
+    mDirtySections.clear();
+}
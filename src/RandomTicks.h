@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "Block.h"
+#include "World.h"
+
+class JobSystem;
+
+// Minecraft's random ticks: every tick, TICKS_PER_SECTION random blocks of each loaded section
+// get a chance to change on their own. Grass spreads onto nearby dirt and dies under opaque
+// blocks; leaves with no log nearby decay.
+class RandomTickEngine {
+    public:
+        static constexpr int TICKS_PER_SECTION = 3;
+
+        struct TickStats {
+            size_t sections = 0;
+            // Sections whose palette has no block type that random-ticks.
+            size_t skipped = 0;
+            size_t ticked = 0;
+            size_t changed = 0;
+        };
+
+        explicit RandomTickEngine(uint64_t seed) : mSeed(seed) {}
+
+        // Draws every section's positions in bulk and runs them grouped by block type. Columns
+        // are split into nine interleaved sets three columns apart, so the blocks the columns
+        // of one set may touch never overlap, and each set is spread across the job system.
+        TickStats tick(World& world, JobSystem& jobs);
+
+        [[nodiscard]] static bool ticksRandomly(BlockId block);
+        // Runs block's random tick at pos with random bits to spend. Returns the block it changed,
+        // if any, which for spreading grass isn't pos itself.
+        static std::optional<BlockPos> randomTick(World& world, BlockPos pos, BlockId block, uint32_t random);
+
+        // Sections changed since the last call, plus the sections sharing the changed faces.
+        void takeDirtySections(std::vector<SectionPos>& out);
+
+    private:
+        struct ColumnResult {
+            TickStats stats;
+            std::vector<BlockPos> changed;
+        };
+
+        void tickColumn(World& world, ColumnPos pos, ColumnResult& result) const;
+
+        uint64_t mSeed;
+        uint64_t mTick = 0;
+        std::vector<SectionPos> mDirtySections;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <optional>
+
+// First-fit allocator over [0, capacity) in arbitrary units. Freed ranges are merged with
+// their free neighbours so long-lived arenas don't fragment into slivers.
+class RangeAllocator {
+    public:
+        explicit RangeAllocator(uint32_t capacity = 0) {
+            reset(capacity);
+        }
+
+        void reset(uint32_t capacity) {
+            mFree.clear();
+            mCapacity = capacity;
+            mUsed = 0;
+            if (capacity > 0) {
+                mFree[0] = capacity;
+            }
+        }
+
+        std::optional<uint32_t> allocate(uint32_t size) {
+            if (size == 0) {
+                return std::nullopt;
+            }
+            for (auto it = mFree.begin(); it != mFree.end(); ++it) {
+                if (it->second < size) {
+                    continue;
+                }
+                const uint32_t offset = it->first;
+                const uint32_t remaining = it->second - size;
+                mFree.erase(it);
+                if (remaining > 0) {
+                    mFree[offset + size] = remaining;
+                }
+                mUsed += size;
+                return offset;
+            }
+            return std::nullopt;
+        }
+
+        void free(uint32_t offset, uint32_t size) {
+            if (size == 0) {
+                return;
+            }
+            mUsed -= size;
+            auto next = mFree.lower_bound(offset);
+            if (next != mFree.begin()) {
+                auto prev = std::prev(next);
+                if (prev->first + prev->second == offset) {
+                    offset = prev->first;
+                    size += prev->second;
+                    mFree.erase(prev);
+                }
+            }
+            if (next != mFree.end() && offset + size == next->first) {
+                size += next->second;
+                mFree.erase(next);
+            }
+            mFree[offset] = size;
+        }
+
+        [[nodiscard]] uint32_t capacity() const { return mCapacity; }
+        [[nodiscard]] uint32_t used() const { return mUsed; }
+
+    private:
+        // Free ranges by offset.
+        std::map<uint32_t, uint32_t> mFree;
+        uint32_t mCapacity = 0;
+        uint32_t mUsed = 0;
+};
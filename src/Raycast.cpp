@@ -0,0 +1,264 @@
+#include "Raycast.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "JobSystem.h"
+#include "Mesher.h"
+#include "Simd.h"
+
+namespace {
+
+constexpr float INF = std::numeric_limits<float>::infinity();
+constexpr int BRICK_SIZE = 4;
+constexpr int PACKET = 4;
+
+// Per-lane traversal state, laid out so the tMax rows load straight into Float4.
+struct Packet {
+    alignas(16) float tMax[3][PACKET];
+    alignas(16) float tDelta[3][PACKET];
+    alignas(16) float t[PACKET];
+    float origin[3][PACKET];
+    float inverse[3][PACKET];
+    int32_t cell[3][PACKET];
+    int32_t step[3][PACKET];
+    int face[PACKET];
+    float maxDistance[PACKET];
+    // Last section each lane looked up.
+    SectionPos sectionPos[PACKET];
+    const Section* section[PACKET];
+    uint64_t bricks[PACKET];
+};
+
+// Ray parameter where the lane leaves its current cell along axis, never behind the lane.
+float exitT(const Packet& p, int axis, int lane) {
+    if (p.step[axis][lane] == 0) {
+        return INF;
+    }
+    const auto boundary = static_cast<float>(p.cell[axis][lane] + (p.step[axis][lane] > 0 ? 1 : 0));
+    return std::max((boundary - p.origin[axis][lane]) * p.inverse[axis][lane], p.t[lane]);
+}
+
+// Entering a block by stepping +axis crosses its negative face.
+int entryFace(int axis, int step) {
+    return axis * 2 + (step > 0 ? 0 : 1);
+}
+
+void initLane(Packet& p, int lane, const Ray& ray) {
+    p.t[lane] = 0.0f;
+    p.maxDistance[lane] = ray.maxDistance;
+    p.face[lane] = FACE_COUNT;
+    p.section[lane] = nullptr;
+    p.sectionPos[lane] = {INT32_MIN, INT32_MIN, INT32_MIN};
+    p.bricks[lane] = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        const float d = ray.direction[axis];
+        p.origin[axis][lane] = ray.origin[axis];
+        p.cell[axis][lane] = static_cast<int32_t>(std::floor(ray.origin[axis]));
+        p.step[axis][lane] = d > 0.0f ? 1 : (d < 0.0f ? -1 : 0);
+        p.inverse[axis][lane] = d != 0.0f ? 1.0f / d : INF;
+        p.tDelta[axis][lane] = std::fabs(p.inverse[axis][lane]);
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        p.tMax[axis][lane] = exitT(p, axis, lane);
+    }
+}
+
+// Moves the lane to the first cell past the empty aligned cube of `size` blocks it is in.
+void skipCube(Packet& p, int lane, int32_t size) {
+    int32_t low[3];
+    float best = INF;
+    int exitAxis = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        low[axis] = p.cell[axis][lane] & ~(size - 1);
+        if (p.step[axis][lane] == 0) {
+            continue;
+        }
+        const auto boundary = static_cast<float>(low[axis] + (p.step[axis][lane] > 0 ? size : 0));
+        const float t = (boundary - p.origin[axis][lane]) * p.inverse[axis][lane];
+        if (t < best) {
+            best = t;
+            exitAxis = axis;
+        }
+    }
+    p.t[lane] = std::max(p.t[lane], best);
+    if (best == INF) {
+        return;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        if (axis == exitAxis) {
+            p.cell[axis][lane] = p.step[axis][lane] > 0 ? low[axis] + size : low[axis] - 1;
+        } else {
+            const auto cell = static_cast<int32_t>(std::floor(p.origin[axis][lane] + (1.0f / p.inverse[axis][lane]) * p.t[lane]));
+            p.cell[axis][lane] = std::clamp(cell, low[axis], low[axis] + size - 1);
+        }
+    }
+    p.face[lane] = entryFace(exitAxis, p.step[exitAxis][lane]);
+    for (int axis = 0; axis < 3; axis++) {
+        p.tMax[axis][lane] = exitT(p, axis, lane);
+    }
+}
+
+}
+
+uint64_t brickMask(const Section& section) {
+    if (section.isEmpty()) {
+        return 0;
+    }
+    if (section.isUniform()) {
+        return ~0ull;
+    }
+    std::vector<uint32_t> blocks(Section::VOLUME);
+    section.decode(blocks.data());
+    uint64_t mask = 0;
+    for (int y = 0; y < Section::SIZE; y++) {
+        for (int z = 0; z < Section::SIZE; z++) {
+            for (int x = 0; x < Section::SIZE; x++) {
+                if (blocks[Section::index(x, y, z)] != AIR) {
+                    mask |= 1ull << ((y / BRICK_SIZE) * 16 + (z / BRICK_SIZE) * 4 + x / BRICK_SIZE);
+                }
+            }
+        }
+    }
+    return mask;
+}
+
+void VoxelRaycaster::update(SectionPos pos) {
+    const Section* section = mWorld.section(pos);
+    if (section == nullptr || section->isEmpty()) {
+        mBricks.erase(pos);
+    } else {
+        mBricks[pos] = brickMask(*section);
+    }
+}
+
+void VoxelRaycaster::rebuild(JobSystem& jobs) {
+    std::vector<std::pair<SectionPos, const Section*>> sections;
+    for (const auto& [pos, column] : mWorld.columns()) {
+        for (int sy = 0; sy < Column::SECTIONS; sy++) {
+            if (!column.section(sy).isEmpty()) {
+                sections.push_back({{pos.x, sy, pos.z}, &column.section(sy)});
+            }
+        }
+    }
+    std::vector<uint64_t> masks(sections.size());
+    jobs.parallelFor(sections.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            masks[i] = brickMask(*sections[i].second);
+        }
+    });
+    mBricks.clear();
+    for (size_t i = 0; i < sections.size(); i++) {
+        mBricks[sections[i].first] = masks[i];
+    }
+}
+
+RayHit VoxelRaycaster::cast(const Ray& ray) const {
+    RayHit hit;
+    castPacket(&ray, 1, &hit);
+    return hit;
+}
+
+void VoxelRaycaster::castBatch(const Ray* rays, size_t count, RayHit* hits, JobSystem& jobs) const {
+    constexpr size_t GRAIN = 64 * PACKET;
+    jobs.parallelFor(count, GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += PACKET) {
+            castPacket(rays + i, static_cast<int>(std::min<size_t>(PACKET, end - i)), hits + i);
+        }
+    });
+}
+
+void VoxelRaycaster::castPacket(const Ray* rays, int count, RayHit* hits) const {
+    Packet p;
+    for (int lane = 0; lane < PACKET; lane++) {
+        // Idle lanes trace a copy of the first ray and are never read back.
+        initLane(p, lane, rays[lane < count ? lane : 0]);
+    }
+
+    const Float4 zero = Float4::splat(0.0f);
+    const Float4 allLanes = zero >= zero;
+    int active = (1 << count) - 1;
+    while (active != 0) {
+        // Each lane either finishes, jumps over empty space, or needs one block step.
+        int stepping = 0;
+        for (int lane = 0; lane < PACKET; lane++) {
+            const int bit = 1 << lane;
+            if ((active & bit) == 0) {
+                continue;
+            }
+            const int32_t x = p.cell[0][lane];
+            const int32_t y = p.cell[1][lane];
+            const int32_t z = p.cell[2][lane];
+            if (p.t[lane] > p.maxDistance[lane] || (y < 0 && p.step[1][lane] <= 0) ||
+                (y >= Column::HEIGHT && p.step[1][lane] >= 0)) {
+                hits[lane] = RayHit{};
+                active &= ~bit;
+                continue;
+            }
+
+            const SectionPos pos{blockToSection(x), blockToSection(y), blockToSection(z)};
+            if (pos != p.sectionPos[lane]) {
+                p.sectionPos[lane] = pos;
+                p.section[lane] = mWorld.section(pos);
+                auto it = mBricks.find(pos);
+                p.bricks[lane] = it != mBricks.end() ? it->second : ~0ull;
+            }
+            const Section* section = p.section[lane];
+            if (section == nullptr || section->isEmpty()) {
+                skipCube(p, lane, Section::SIZE);
+                continue;
+            }
+            const int32_t lx = blockInSection(x);
+            const int32_t ly = blockInSection(y);
+            const int32_t lz = blockInSection(z);
+            if (((p.bricks[lane] >> ((ly / BRICK_SIZE) * 16 + (lz / BRICK_SIZE) * 4 + lx / BRICK_SIZE)) & 1) == 0) {
+                skipCube(p, lane, BRICK_SIZE);
+                continue;
+            }
+            const BlockId id = section->get(lx, ly, lz);
+            if (id != AIR) {
+                RayHit& hit = hits[lane];
+                hit.hit = true;
+                hit.block[0] = x;
+                hit.block[1] = y;
+                hit.block[2] = z;
+                hit.face = p.face[lane];
+                hit.distance = p.t[lane];
+                hit.id = id;
+                active &= ~bit;
+                continue;
+            }
+            stepping |= bit;
+        }
+        if (stepping == 0) {
+            continue;
+        }
+
+        // Every stepping lane advances along the axis whose boundary is nearest.
+        const Float4 laneBits = Float4::set(
+            static_cast<float>(stepping & 1), static_cast<float>(stepping & 2), static_cast<float>(stepping & 4), static_cast<float>(stepping & 8));
+        const Float4 selected = laneBits >= Float4::splat(0.5f);
+        Float4 tx = Float4::load(p.tMax[0]);
+        Float4 ty = Float4::load(p.tMax[1]);
+        Float4 tz = Float4::load(p.tMax[2]);
+        const Float4 mx = (ty >= tx) & (tz >= tx) & selected;
+        const Float4 my = select(mx, zero, tz >= ty) & selected;
+        const Float4 mz = select(mx | my, zero, allLanes) & selected;
+        const Float4 t = select(mx, tx, select(my, ty, select(mz, tz, Float4::load(p.t))));
+        t.store(p.t);
+        select(mx, tx + Float4::load(p.tDelta[0]), tx).store(p.tMax[0]);
+        select(my, ty + Float4::load(p.tDelta[1]), ty).store(p.tMax[1]);
+        select(mz, tz + Float4::load(p.tDelta[2]), tz).store(p.tMax[2]);
+
+        const int axisBits[3] = {mask(mx), mask(my), mask(mz)};
+        for (int axis = 0; axis < 3; axis++) {
+            for (int lane = 0; lane < PACKET; lane++) {
+                if ((axisBits[axis] & (1 << lane)) != 0) {
+                    p.cell[axis][lane] += p.step[axis][lane];
+                    p.face[lane] = entryFace(axis, p.step[axis][lane]);
+                }
+            }
+        }
+    }
+}
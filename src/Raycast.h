@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include "Block.h"
+#include "World.h"
+
+class JobSystem;
+
+struct Ray {
+    float origin[3];
+    // Needn't be normalized; distances are measured in multiples of its length.
+    float direction[3];
+    float maxDistance;
+};
+
+struct RayHit {
+    bool hit = false;
+    int32_t block[3] = {};
+    // Face of the hit block the ray entered through, in Mesher.h face order; FACE_COUNT when
+    // the ray started inside the block.
+    int face = 0;
+    float distance = 0.0f;
+    BlockId id = AIR;
+};
+
+// Bit ((y / 4) * 16 + (z / 4) * 4 + x / 4) is set when that 4x4x4 brick holds a non-air block.
+uint64_t brickMask(const Section& section);
+
+// Amanatides-Woo traversal of the block grid, stopping at the first non-air block. Empty and
+// unloaded sections are crossed in one step, and so are empty bricks of sections whose masks
+// update() has recorded; sections without a recorded mask are walked block by block.
+class VoxelRaycaster {
+    public:
+        explicit VoxelRaycaster(const World& world) : mWorld(world) {}
+
+        // Records the brick mask of a section after it changes, or drops it once unloaded.
+        void update(SectionPos pos);
+        // Records every loaded section.
+        void rebuild(JobSystem& jobs);
+
+        [[nodiscard]] RayHit cast(const Ray& ray) const;
+        // Spreads the rays across the job system in packets of four; the speedup over cast()
+        // comes from the threads. Only the choice of axis to step is four-wide: the section
+        // lookups, brick tests and block fetches that dominate run per lane, so on one thread a
+        // packet costs about as much as four cast() calls. Hits match cast().
+        void castBatch(const Ray* rays, size_t count, RayHit* hits, JobSystem& jobs) const;
+
+    private:
+        void castPacket(const Ray* rays, int count, RayHit* hits) const;
+
+        const World& mWorld;
+        std::unordered_map<SectionPos, uint64_t, SectionPosHash> mBricks;
+};
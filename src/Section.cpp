@@ -0,0 +1,126 @@
+#include "Section.h"
+
+#include <algorithm>
+#include <cstdint>
+
+Section::Section() : Section(AIR) {}
+
+Section::Section(BlockId fill) {
+    this->fill(fill);
+}
+
+void Section::fill(BlockId block) {
+    mPalette.assign(1, block);
+    mData.clear();
+    mBits = 0;
+    mNonAir = block == AIR ? 0 : VOLUME;
+}
+
+bool Section::paletteContains(BlockId block) const {
+    return std::find(mPalette.begin(), mPalette.end(), block) != mPalette.end();
+}
+
+void Section::set(int x, int y, int z, BlockId block) {
+    const int i = index(x, y, z);
+    const BlockId previous = getIndex(i);
+    if (previous == block) {
+        return;
+    }
+
+    auto it = std::find(mPalette.begin(), mPalette.end(), block);
+    uint32_t entry = static_cast<uint32_t>(it - mPalette.begin());
+    if (it == mPalette.end()) {
+        mPalette.push_back(block);
+        uint32_t needed = 1;
+        while ((1u << needed) < mPalette.size()) {
+            needed *= 2;
+        }
+        if (needed > mBits) {
+            grow(needed);
+        }
+    }
+    writeIndex(i, entry);
+
+    if (previous == AIR) {
+        mNonAir++;
+    } else if (block == AIR) {
+        mNonAir--;
+    }
+}
+
+void Section::writeIndex(int i, uint32_t value) {
+    const uint32_t perWord = 64 / mBits;
+    const uint32_t shift = (i % perWord) * mBits;
+    uint64_t& word = mData[i / perWord];
+    word = (word & ~(((1ull << mBits) - 1) << shift)) | (static_cast<uint64_t>(value) << shift);
+}
+
+// Bit widths stay powers of two so an index never straddles two words.
+void Section::grow(uint32_t bits) {
+    std::vector<uint32_t> indices(VOLUME);
+    for (int i = 0; i < VOLUME; i++) {
+        indices[i] = paletteIndex(i);
+    }
+
+    mBits = bits;
+    const uint32_t perWord = 64 / mBits;
+    mData.assign((VOLUME + perWord - 1) / perWord, 0);
+    for (int i = 0; i < VOLUME; i++) {
+        writeIndex(i, indices[i]);
+    }
+}
+
+void Section::decode(uint32_t* out) const {
+    if (mBits == 0) {
+        std::fill(out, out + VOLUME, mPalette[0]);
+        return;
+    }
+    const uint32_t perWord = 64 / mBits;
+    const uint64_t mask = (1ull << mBits) - 1;
+    int i = 0;
+    for (uint64_t word : mData) {
+        for (uint32_t j = 0; j < perWord && i < VOLUME; j++, i++) {
+            out[i] = mPalette[(word >> (j * mBits)) & mask];
+        }
+    }
+}
+
+void Section::encode(const uint32_t* blocks) {
+    mPalette.clear();
+    mNonAir = 0;
+    std::vector<uint32_t> indices(VOLUME);
+    BlockId last = 0;
+    uint32_t lastEntry = UINT32_MAX;
+    for (int i = 0; i < VOLUME; i++) {
+        const BlockId block = static_cast<BlockId>(blocks[i]);
+        if (lastEntry == UINT32_MAX || block != last) {
+            auto it = std::find(mPalette.begin(), mPalette.end(), block);
+            lastEntry = static_cast<uint32_t>(it - mPalette.begin());
+            if (it == mPalette.end()) {
+                mPalette.push_back(block);
+            }
+            last = block;
+        }
+        indices[i] = lastEntry;
+        if (block != AIR) {
+            mNonAir++;
+        }
+    }
+
+    mBits = 0;
+    if (mPalette.size() > 1) {
+        mBits = 1;
+        while ((1u << mBits) < mPalette.size()) {
+            mBits *= 2;
+        }
+    }
+    mData.clear();
+    if (mBits == 0) {
+        return;
+    }
+    const uint32_t perWord = 64 / mBits;
+    mData.assign((VOLUME + perWord - 1) / perWord, 0);
+    for (int i = 0; i < VOLUME; i++) {
+        writeIndex(i, indices[i]);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Block.h"
+
+// A 16x16x16 cube of blocks stored as indices into a per-section palette. Indices are
+// bit-packed with as few bits as the palette needs; a single-entry palette stores no
+// indices at all, so uniform sections (all air, all stone) cost almost nothing.
+class Section {
+    public:
+        static constexpr int SIZE = 16;
+        static constexpr int VOLUME = SIZE * SIZE * SIZE;
+
+        Section();
+        explicit Section(BlockId fill);
+
+        static int index(int x, int y, int z) {
+            return (y * SIZE + z) * SIZE + x;
+        }
+
+        [[nodiscard]] BlockId get(int x, int y, int z) const {
+            return mPalette[paletteIndex(index(x, y, z))];
+        }
+
+        [[nodiscard]] BlockId getIndex(int i) const {
+            return mPalette[paletteIndex(i)];
+        }
+
+        void set(int x, int y, int z, BlockId block);
+        void fill(BlockId block);
+
+        // Expands the palette into VOLUME block ids laid out by index().
+        void decode(uint32_t* out) const;
+        // Rebuilds palette and indices from VOLUME block ids laid out by index().
+        void encode(const uint32_t* blocks);
+
+        [[nodiscard]] const std::vector<BlockId>& palette() const { return mPalette; }
+        [[nodiscard]] uint32_t bitsPerBlock() const { return mBits; }
+        [[nodiscard]] bool isEmpty() const { return mNonAir == 0; }
+        [[nodiscard]] int nonAirCount() const { return mNonAir; }
+        [[nodiscard]] bool isUniform() const { return mPalette.size() == 1; }
+        [[nodiscard]] bool paletteContains(BlockId block) const;
+
+    private:
+        [[nodiscard]] uint32_t paletteIndex(int i) const {
+            if (mBits == 0) {
+                return 0;
+            }
+            const uint32_t perWord = 64 / mBits;
+            const uint64_t word = mData[i / perWord];
+            return static_cast<uint32_t>((word >> ((i % perWord) * mBits)) & ((1ull << mBits) - 1));
+        }
+
+        void writeIndex(int i, uint32_t value);
+        void grow(uint32_t bits);
+
+        std::vector<BlockId> mPalette;
+        std::vector<uint64_t> mData;
+        uint32_t mBits = 0;
+        int mNonAir = 0;
+};
@@ -0,0 +1,81 @@
+#include "ShaderWatcher.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <system_error>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderWatcher::ShaderWatcher(std::string directory) : mDirectory(std::move(directory)) {
+#ifdef __linux__
+    mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // Compilers either rewrite the file in place or write a new one and rename it over.
+    if (mInotify >= 0 && inotify_add_watch(mInotify, mDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        printf("can't watch %s with inotify, polling instead\n", mDirectory.c_str());
+        close(mInotify);
+        mInotify = -1;
+    }
+#endif
+    if (mInotify < 0) {
+        // Only records what's there.
+        scan(nullptr);
+    }
+}
+
+ShaderWatcher::~ShaderWatcher() {
+#ifdef __linux__
+    if (mInotify >= 0) {
+        close(mInotify);
+    }
+#endif
+}
+
+std::vector<std::string> ShaderWatcher::poll(uint64_t nowNs) {
+    std::vector<std::string> changed;
+#ifdef __linux__
+    if (mInotify >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t bytes;
+        while ((bytes = read(mInotify, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < bytes;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0) {
+                    changed.emplace_back(event->name);
+                }
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+    }
+#endif
+    if (mInotify < 0 && nowNs - mLastScanNs >= SCAN_INTERVAL_NS) {
+        mLastScanNs = nowNs;
+        scan(&changed);
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+void ShaderWatcher::scan(std::vector<std::string>* changed) {
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(mDirectory, error)) {
+        if (!entry.is_regular_file(error)) {
+            continue;
+        }
+        const auto writeTime = entry.last_write_time(error);
+        if (error) {
+            continue;
+        }
+        std::string name = entry.path().filename().string();
+        auto [it, added] = mWriteTimes.emplace(name, writeTime);
+        if (!added && it->second == writeTime) {
+            continue;
+        }
+        it->second = writeTime;
+        if (changed != nullptr) {
+            changed->push_back(std::move(name));
+        }
+    }
+}
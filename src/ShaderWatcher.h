@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports files in one directory that were written since the last poll(). Uses inotify where
+// it's available and otherwise compares modification times, at most every SCAN_INTERVAL_NS.
+class ShaderWatcher {
+    public:
+        static constexpr uint64_t SCAN_INTERVAL_NS = 250'000'000;
+
+        explicit ShaderWatcher(std::string directory);
+        ~ShaderWatcher();
+
+        ShaderWatcher(const ShaderWatcher&) = delete;
+        ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+        // File names, not paths, changed since the last call. Never blocks.
+        std::vector<std::string> poll(uint64_t nowNs);
+
+        [[nodiscard]] bool usesInotify() const { return mInotify >= 0; }
+
+    private:
+        // Appends files that are new or rewritten since the previous scan, if changed isn't null.
+        void scan(std::vector<std::string>* changed);
+
+        std::string mDirectory;
+        int mInotify = -1;
+        std::unordered_map<std::string, std::filesystem::file_time_type> mWriteTimes;
+        uint64_t mLastScanNs = 0;
+};
@@ -1,2 +0,0 @@
-/Users/evankelch/VulkanSDK/1.3.290.0/macOS/bin/glslc shader.vert -o vert.spv
-/Users/evankelch/VulkanSDK/1.3.290.0/macOS/bin/glslc shader.frag -o frag.spv
@@ -0,0 +1,24 @@
+#version 450
+
+// The head of CameraPushConstants in main.cpp; models only need the matrix.
+layout(push_constant) uniform Camera {
+    mat4 viewProj;
+} camera;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+// Per instance, see ModelInstance in main.cpp.
+layout(location = 2) in vec4 offsetYaw;
+layout(location = 3) in vec4 tintScale;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    float c = cos(offsetYaw.w);
+    float s = sin(offsetYaw.w);
+    vec3 local = inPosition * tintScale.w;
+    vec3 turned = vec3(c * local.x + s * local.z, local.y, c * local.z - s * local.x);
+    // offsetYaw.xyz is already relative to the camera.
+    gl_Position = camera.viewProj * vec4(turned + offsetYaw.xyz, 1.0);
+    fragColor = inColor * tintScale.rgb;
+}
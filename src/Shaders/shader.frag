@@ -1,9 +1,33 @@
 #version 450
 
+// Set per pipeline variant; see buildPipelineVariant() in main.cpp.
+layout(constant_id = 0) const int ALPHA_MODE = 0;
+layout(constant_id = 1) const int DEBUG_VIEW = 0;
+
+const int ALPHA_CUTOUT = 1;
+const int ALPHA_TRANSLUCENT = 2;
+const int DEBUG_DEPTH = 1;
+const int DEBUG_OVERDRAW = 2;
+
+// Until vertices carry alpha: cutout treats near-black as transparent, and translucent
+// geometry is drawn at a fixed opacity.
+const float CUTOUT_THRESHOLD = 0.02;
+const float TRANSLUCENT_ALPHA = 0.6;
+
 layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
-}
\ No newline at end of file
+    if (ALPHA_MODE == ALPHA_CUTOUT && max(fragColor.r, max(fragColor.g, fragColor.b)) < CUTOUT_THRESHOLD) {
+        discard;
+    }
+    if (DEBUG_VIEW == DEBUG_DEPTH) {
+        outColor = vec4(vec3(pow(gl_FragCoord.z, 32.0)), 1.0);
+    } else if (DEBUG_VIEW == DEBUG_OVERDRAW) {
+        // Blended additively, so ten layers saturate.
+        outColor = vec4(vec3(0.1), 1.0);
+    } else {
+        outColor = vec4(fragColor, ALPHA_MODE == ALPHA_TRANSLUCENT ? TRANSLUCENT_ALPHA : 1.0);
+    }
+}
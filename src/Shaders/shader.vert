@@ -1,11 +1,31 @@
 #version 450
 
-layout(location = 0) in vec2 inPosition;
+// Matches CameraPushConstants in main.cpp.
+layout(push_constant) uniform Camera {
+    // Takes positions relative to the camera.
+    mat4 viewProj;
+    ivec4 cameraBlock;
+    vec4 cameraFraction;
+    // w != 0: this draw's origin in blocks. Otherwise the draw is a section whose origin is
+    // looked up by instance index, which the cull pass sets to the section's slot.
+    ivec4 drawOrigin;
+} camera;
+
+struct Bounds {
+    ivec4 origin;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer SectionBounds { Bounds bounds[]; };
+
+layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
 
 void main() {
-    gl_Position = vec4(inPosition, 0.0, 1.0);
+    ivec3 origin = camera.drawOrigin.w != 0 ? camera.drawOrigin.xyz : bounds[gl_InstanceIndex].origin.xyz;
+    // The origin offset is exact in integers, so only the in-block remainder is ever a float.
+    vec3 relative = vec3(origin - camera.cameraBlock.xyz) + inPosition - camera.cameraFraction.xyz;
+    gl_Position = camera.viewProj * vec4(relative, 1.0);
     fragColor = inColor;
-}
\ No newline at end of file
+}
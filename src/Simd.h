@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+
+// Four-wide float and uint32 vectors: SSE2 on x86-64, NEON on ARM64, plain arrays everywhere
+// else. Float comparisons return lane masks (all bits set or clear) that select() and mask() consume.
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MC_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define MC_SIMD_NEON 1
+#endif
+
+struct Float4 {
+#if defined(MC_SIMD_SSE2)
+    __m128 v;
+#elif defined(MC_SIMD_NEON)
+    float32x4_t v;
+#else
+    float v[4];
+#endif
+
+    static Float4 splat(float x) {
+#if defined(MC_SIMD_SSE2)
+        return {_mm_set1_ps(x)};
+#elif defined(MC_SIMD_NEON)
+        return {vdupq_n_f32(x)};
+#else
+        return {{x, x, x, x}};
+#endif
+    }
+
+    static Float4 set(float a, float b, float c, float d) {
+#if defined(MC_SIMD_SSE2)
+        return {_mm_setr_ps(a, b, c, d)};
+#elif defined(MC_SIMD_NEON)
+        const float lanes[4] = {a, b, c, d};
+        return {vld1q_f32(lanes)};
+#else
+        return {{a, b, c, d}};
+#endif
+    }
+
+    static Float4 load(const float* p) {
+#if defined(MC_SIMD_SSE2)
+        return {_mm_loadu_ps(p)};
+#elif defined(MC_SIMD_NEON)
+        return {vld1q_f32(p)};
+#else
+        return {{p[0], p[1], p[2], p[3]}};
+#endif
+    }
+
+    void store(float* p) const {
+#if defined(MC_SIMD_SSE2)
+        _mm_storeu_ps(p, v);
+#elif defined(MC_SIMD_NEON)
+        vst1q_f32(p, v);
+#else
+        for (int i = 0; i < 4; i++) {
+            p[i] = v[i];
+        }
+#endif
+    }
+};
+
+#if defined(MC_SIMD_SSE2)
+inline Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Float4 min(Float4 a, Float4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline Float4 max(Float4 a, Float4 b) { return {_mm_max_ps(a.v, b.v)}; }
+inline Float4 operator>=(Float4 a, Float4 b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+inline Float4 operator<(Float4 a, Float4 b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+inline Float4 operator&(Float4 a, Float4 b) { return {_mm_and_ps(a.v, b.v)}; }
+inline Float4 operator|(Float4 a, Float4 b) { return {_mm_or_ps(a.v, b.v)}; }
+inline Float4 select(Float4 mask, Float4 a, Float4 b) { return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))}; }
+// One bit per lane, lane 0 in bit 0.
+inline int mask(Float4 m) { return _mm_movemask_ps(m.v); }
+#elif defined(MC_SIMD_NEON)
+inline Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+inline Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+inline Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+inline Float4 min(Float4 a, Float4 b) { return {vminq_f32(a.v, b.v)}; }
+inline Float4 max(Float4 a, Float4 b) { return {vmaxq_f32(a.v, b.v)}; }
+inline Float4 operator>=(Float4 a, Float4 b) { return {vreinterpretq_f32_u32(vcgeq_f32(a.v, b.v))}; }
+inline Float4 operator<(Float4 a, Float4 b) { return {vreinterpretq_f32_u32(vcltq_f32(a.v, b.v))}; }
+inline Float4 operator&(Float4 a, Float4 b) { return {vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)))}; }
+inline Float4 operator|(Float4 a, Float4 b) { return {vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)))}; }
+inline Float4 select(Float4 mask, Float4 a, Float4 b) { return {vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v)}; }
+inline int mask(Float4 m) {
+    const uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(m.v), 31);
+    const int32_t weights[4] = {1, 2, 4, 8};
+    return static_cast<int>(vaddvq_u32(vmulq_u32(bits, vreinterpretq_u32_s32(vld1q_s32(weights)))));
+}
+#else
+inline Float4 operator+(Float4 a, Float4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+inline Float4 operator-(Float4 a, Float4 b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+inline Float4 operator*(Float4 a, Float4 b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+inline Float4 min(Float4 a, Float4 b) {
+    return {{a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1], a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3]}};
+}
+inline Float4 max(Float4 a, Float4 b) {
+    return {{a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1], a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3]}};
+}
+
+namespace simd_detail {
+inline float laneMask(bool set) {
+    union { uint32_t u; float f; } bits{set ? 0xFFFFFFFFu : 0u};
+    return bits.f;
+}
+inline bool laneSet(float lane) {
+    union { float f; uint32_t u; } bits{lane};
+    return bits.u != 0;
+}
+}
+
+inline Float4 operator>=(Float4 a, Float4 b) {
+    Float4 r;
+    for (int i = 0; i < 4; i++) {
+        r.v[i] = simd_detail::laneMask(a.v[i] >= b.v[i]);
+    }
+    return r;
+}
+inline Float4 operator<(Float4 a, Float4 b) {
+    Float4 r;
+    for (int i = 0; i < 4; i++) {
+        r.v[i] = simd_detail::laneMask(a.v[i] < b.v[i]);
+    }
+    return r;
+}
+inline Float4 operator&(Float4 a, Float4 b) {
+    Float4 r;
+    for (int i = 0; i < 4; i++) {
+        r.v[i] = simd_detail::laneMask(simd_detail::laneSet(a.v[i]) && simd_detail::laneSet(b.v[i]));
+    }
+    return r;
+}
+inline Float4 operator|(Float4 a, Float4 b) {
+    Float4 r;
+    for (int i = 0; i < 4; i++) {
+        r.v[i] = simd_detail::laneMask(simd_detail::laneSet(a.v[i]) || simd_detail::laneSet(b.v[i]));
+    }
+    return r;
+}
+inline Float4 select(Float4 mask, Float4 a, Float4 b) {
+    Float4 r;
+    for (int i = 0; i < 4; i++) {
+        r.v[i] = simd_detail::laneSet(mask.v[i]) ? a.v[i] : b.v[i];
+    }
+    return r;
+}
+inline int mask(Float4 m) {
+    int bits = 0;
+    for (int i = 0; i < 4; i++) {
+        bits |= simd_detail::laneSet(m.v[i]) ? 1 << i : 0;
+    }
+    return bits;
+}
+#endif
+
+struct UInt4 {
+#if defined(MC_SIMD_SSE2)
+    __m128i v;
+#elif defined(MC_SIMD_NEON)
+    uint32x4_t v;
+#else
+    uint32_t v[4];
+#endif
+
+    static UInt4 set(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+#if defined(MC_SIMD_SSE2)
+        return {_mm_setr_epi32(static_cast<int>(a), static_cast<int>(b), static_cast<int>(c), static_cast<int>(d))};
+#elif defined(MC_SIMD_NEON)
+        const uint32_t lanes[4] = {a, b, c, d};
+        return {vld1q_u32(lanes)};
+#else
+        return {{a, b, c, d}};
+#endif
+    }
+
+    void store(uint32_t* p) const {
+#if defined(MC_SIMD_SSE2)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+#elif defined(MC_SIMD_NEON)
+        vst1q_u32(p, v);
+#else
+        for (int i = 0; i < 4; i++) {
+            p[i] = v[i];
+        }
+#endif
+    }
+};
+
+#if defined(MC_SIMD_SSE2)
+inline UInt4 operator^(UInt4 a, UInt4 b) { return {_mm_xor_si128(a.v, b.v)}; }
+template <int N> inline UInt4 shiftLeft(UInt4 a) { return {_mm_slli_epi32(a.v, N)}; }
+template <int N> inline UInt4 shiftRight(UInt4 a) { return {_mm_srli_epi32(a.v, N)}; }
+#elif defined(MC_SIMD_NEON)
+inline UInt4 operator^(UInt4 a, UInt4 b) { return {veorq_u32(a.v, b.v)}; }
+template <int N> inline UInt4 shiftLeft(UInt4 a) { return {vshlq_n_u32(a.v, N)}; }
+template <int N> inline UInt4 shiftRight(UInt4 a) { return {vshrq_n_u32(a.v, N)}; }
+#else
+inline UInt4 operator^(UInt4 a, UInt4 b) { return {{a.v[0] ^ b.v[0], a.v[1] ^ b.v[1], a.v[2] ^ b.v[2], a.v[3] ^ b.v[3]}}; }
+template <int N> inline UInt4 shiftLeft(UInt4 a) { return {{a.v[0] << N, a.v[1] << N, a.v[2] << N, a.v[3] << N}}; }
+template <int N> inline UInt4 shiftRight(UInt4 a) { return {{a.v[0] >> N, a.v[1] >> N, a.v[2] >> N, a.v[3] >> N}}; }
+#endif
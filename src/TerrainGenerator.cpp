@@ -0,0 +1,141 @@
+#include "TerrainGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static uint64_t mix64(uint64_t v) {
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdull;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ull;
+    v ^= v >> 33;
+    return v;
+}
+
+static float smooth(float t) {
+    return t * t * (3.0f - 2.0f * t);
+}
+
+static float lerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+float TerrainGenerator::lattice2(int32_t x, int32_t z) const {
+    uint64_t h = mix64(mSeed ^ (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(z)));
+    return static_cast<float>(h >> 40) / static_cast<float>(1 << 23) - 1.0f;
+}
+
+float TerrainGenerator::lattice3(int32_t x, int32_t y, int32_t z) const {
+    uint64_t h = mix64(mSeed + 0x9e3779b97f4a7c15ull * static_cast<uint32_t>(y));
+    h = mix64(h ^ (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(z)));
+    return static_cast<float>(h >> 40) / static_cast<float>(1 << 23) - 1.0f;
+}
+
+float TerrainGenerator::noise2(float x, float z) const {
+    const float fx = std::floor(x);
+    const float fz = std::floor(z);
+    const auto ix = static_cast<int32_t>(fx);
+    const auto iz = static_cast<int32_t>(fz);
+    const float tx = smooth(x - fx);
+    const float tz = smooth(z - fz);
+
+    const float a = lerp(lattice2(ix, iz), lattice2(ix + 1, iz), tx);
+    const float b = lerp(lattice2(ix, iz + 1), lattice2(ix + 1, iz + 1), tx);
+    return lerp(a, b, tz);
+}
+
+float TerrainGenerator::noise3(float x, float y, float z) const {
+    const float fx = std::floor(x);
+    const float fy = std::floor(y);
+    const float fz = std::floor(z);
+    const auto ix = static_cast<int32_t>(fx);
+    const auto iy = static_cast<int32_t>(fy);
+    const auto iz = static_cast<int32_t>(fz);
+    const float tx = smooth(x - fx);
+    const float ty = smooth(y - fy);
+    const float tz = smooth(z - fz);
+
+    float layers[2];
+    for (int dy = 0; dy < 2; dy++) {
+        const float a = lerp(lattice3(ix, iy + dy, iz), lattice3(ix + 1, iy + dy, iz), tx);
+        const float b = lerp(lattice3(ix, iy + dy, iz + 1), lattice3(ix + 1, iy + dy, iz + 1), tx);
+        layers[dy] = lerp(a, b, tz);
+    }
+    return lerp(layers[0], layers[1], ty);
+}
+
+float TerrainGenerator::fbm2(float x, float z, int octaves) const {
+    float total = 0.0f;
+    float amplitude = 1.0f;
+    float norm = 0.0f;
+    for (int i = 0; i < octaves; i++) {
+        total += noise2(x, z) * amplitude;
+        norm += amplitude;
+        amplitude *= 0.5f;
+        x *= 2.0f;
+        z *= 2.0f;
+    }
+    return total / norm;
+}
+
+int TerrainGenerator::surfaceHeight(int32_t x, int32_t z) const {
+    const float hills = fbm2(static_cast<float>(x) / 96.0f, static_cast<float>(z) / 96.0f, 5);
+    const float mountains = std::max(0.0f, noise2(static_cast<float>(x) / 256.0f + 17.0f, static_cast<float>(z) / 256.0f - 31.0f));
+    const int height = SEA_LEVEL + static_cast<int>(hills * 18.0f + mountains * mountains * 90.0f);
+    return std::clamp(height, 1, Column::HEIGHT - 1);
+}
+
+bool TerrainGenerator::isCave(int32_t x, int32_t y, int32_t z) const {
+    if (y < 5) {
+        return false;
+    }
+    const float n = noise3(static_cast<float>(x) / 24.0f, static_cast<float>(y) / 12.0f, static_cast<float>(z) / 24.0f);
+    return n > 0.45f;
+}
+
+void TerrainGenerator::generateColumn(ColumnPos pos, Column& column) const {
+    int heights[Section::SIZE][Section::SIZE];
+    int maxHeight = 0;
+    for (int z = 0; z < Section::SIZE; z++) {
+        for (int x = 0; x < Section::SIZE; x++) {
+            heights[z][x] = surfaceHeight(pos.x * Section::SIZE + x, pos.z * Section::SIZE + z);
+            maxHeight = std::max(maxHeight, heights[z][x]);
+        }
+    }
+
+    std::vector<uint32_t> blocks(Section::VOLUME);
+    for (int sy = 0; sy < Column::SECTIONS; sy++) {
+        const int baseY = sy * Section::SIZE;
+        if (baseY > std::max(maxHeight, SEA_LEVEL)) {
+            column.clearSection(sy);
+            continue;
+        }
+
+        for (int y = 0; y < Section::SIZE; y++) {
+            const int wy = baseY + y;
+            for (int z = 0; z < Section::SIZE; z++) {
+                for (int x = 0; x < Section::SIZE; x++) {
+                    const int surface = heights[z][x];
+                    BlockId block = AIR;
+                    if (wy < surface - 3) {
+                        block = STONE;
+                    } else if (wy < surface) {
+                        block = surface <= SEA_LEVEL + 1 ? SAND : DIRT;
+                    } else if (wy == surface) {
+                        block = surface <= SEA_LEVEL + 1 ? SAND : GRASS;
+                    } else if (wy <= SEA_LEVEL) {
+                        block = WATER;
+                    }
+
+                    if (block != AIR && block != WATER && wy < surface - 2
+                        && isCave(pos.x * Section::SIZE + x, wy, pos.z * Section::SIZE + z)) {
+                        block = wy < 11 ? LAVA : AIR;
+                    }
+                    blocks[Section::index(x, y, z)] = block;
+                }
+            }
+        }
+        column.mutableSection(sy).encode(blocks.data());
+    }
+}
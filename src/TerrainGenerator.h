@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include "World.h"
+
+// Deterministic heightmap terrain with carved caves, driven entirely by the seed.
+class TerrainGenerator {
+    public:
+        static constexpr int SEA_LEVEL = 62;
+
+        explicit TerrainGenerator(uint64_t seed) : mSeed(seed) {}
+
+        void generateColumn(ColumnPos pos, Column& column) const;
+
+        [[nodiscard]] int surfaceHeight(int32_t x, int32_t z) const;
+        [[nodiscard]] bool isCave(int32_t x, int32_t y, int32_t z) const;
+
+        // Smooth value noise in [-1, 1].
+        [[nodiscard]] float noise2(float x, float z) const;
+        [[nodiscard]] float noise3(float x, float y, float z) const;
+        [[nodiscard]] float fbm2(float x, float z, int octaves) const;
+
+        [[nodiscard]] uint64_t seed() const { return mSeed; }
+
+    private:
+        [[nodiscard]] float lattice2(int32_t x, int32_t z) const;
+        [[nodiscard]] float lattice3(int32_t x, int32_t y, int32_t z) const;
+
+        uint64_t mSeed;
+};
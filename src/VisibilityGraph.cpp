@@ -0,0 +1,131 @@
+#include "VisibilityGraph.h"
+
+#include <array>
+#include "Mesher.h"
+
+uint16_t computeConnectivity(const uint32_t* blocks) {
+    constexpr int S = Section::SIZE;
+    std::array<bool, Section::VOLUME> closed{};
+    for (int i = 0; i < Section::VOLUME; i++) {
+        closed[i] = isOpaque(static_cast<BlockId>(blocks[i]));
+    }
+
+    uint16_t mask = 0;
+    std::array<uint16_t, Section::VOLUME> stack{};
+    for (int seed = 0; seed < Section::VOLUME; seed++) {
+        if (closed[seed]) {
+            continue;
+        }
+        // Every cell is marked closed once visited, so each open region is filled once.
+        int top = 0;
+        stack[top++] = static_cast<uint16_t>(seed);
+        closed[seed] = true;
+        int faces = 0;
+        while (top > 0) {
+            const int i = stack[--top];
+            const int x = i % S;
+            const int z = (i / S) % S;
+            const int y = i / (S * S);
+            const int neighbors[FACE_COUNT] = {
+                x > 0 ? i - 1 : -1, x < S - 1 ? i + 1 : -1,
+                y > 0 ? i - S * S : -1, y < S - 1 ? i + S * S : -1,
+                z > 0 ? i - S : -1, z < S - 1 ? i + S : -1,
+            };
+            for (int face = 0; face < FACE_COUNT; face++) {
+                const int n = neighbors[face];
+                if (n < 0) {
+                    faces |= 1 << face;
+                } else if (!closed[n]) {
+                    closed[n] = true;
+                    stack[top++] = static_cast<uint16_t>(n);
+                }
+            }
+        }
+        for (int a = 0; a < FACE_COUNT; a++) {
+            for (int b = a + 1; b < FACE_COUNT; b++) {
+                if ((faces & (1 << a)) != 0 && (faces & (1 << b)) != 0) {
+                    mask |= static_cast<uint16_t>(1u << facePairBit(a, b));
+                }
+            }
+        }
+        if (mask == ALL_FACES_CONNECTED) {
+            break;
+        }
+    }
+    return mask;
+}
+
+uint16_t VisibilityGraph::connectivity(const World& world, SectionPos pos) const {
+    auto it = mMasks.find(pos);
+    if (it != mMasks.end()) {
+        return it->second;
+    }
+    const Section* section = world.section(pos);
+    if (section == nullptr) {
+        return 0;
+    }
+    // Uniform opaque sections are closed; anything else without a computed mask is treated as open.
+    if (section->isUniform() && isOpaque(section->palette()[0])) {
+        return 0;
+    }
+    return ALL_FACES_CONNECTED;
+}
+
+void VisibilityGraph::traverse(const World& world, SectionPos start, int radius, std::vector<SectionPos>& out) {
+    const int side = 2 * radius + 1;
+    mColumns.assign(static_cast<size_t>(side) * side, nullptr);
+    for (int dz = -radius; dz <= radius; dz++) {
+        for (int dx = -radius; dx <= radius; dx++) {
+            mColumns[static_cast<size_t>(dz + radius) * side + (dx + radius)] = world.column({start.x + dx, start.z + dz});
+        }
+    }
+    // Grid index of a section, or -1 outside the radius, the world height or the loaded columns.
+    auto cell = [&](SectionPos pos) {
+        const int gx = pos.x - start.x + radius;
+        const int gz = pos.z - start.z + radius;
+        if (gx < 0 || gx >= side || gz < 0 || gz >= side || pos.y < 0 || pos.y >= Column::SECTIONS) {
+            return -1;
+        }
+        const int column = gz * side + gx;
+        return mColumns[column] == nullptr ? -1 : column * Column::SECTIONS + pos.y;
+    };
+
+    const int startCell = cell(start);
+    if (startCell < 0) {
+        return;
+    }
+    if (mVisited.size() != mColumns.size() * Column::SECTIONS) {
+        mVisited.assign(mColumns.size() * Column::SECTIONS, 0);
+        mTraversal = 0;
+    }
+    mTraversal++;
+    mQueue.clear();
+    mVisited[startCell] = mTraversal;
+    mQueue.push_back({start, -1, 0});
+
+    // mQueue only grows during the traversal, so an index serves as the queue head.
+    for (size_t head = 0; head < mQueue.size(); head++) {
+        const Step step = mQueue[head];
+        out.push_back(step.pos);
+        const uint16_t mask = step.entryFace < 0 ? ALL_FACES_CONNECTED : connectivity(world, step.pos);
+        if (mask == 0) {
+            continue;
+        }
+        for (int face = 0; face < FACE_COUNT; face++) {
+            const int opposite = face ^ 1;
+            if ((step.directions & (1 << opposite)) != 0) {
+                continue;
+            }
+            if (step.entryFace >= 0 && (step.entryFace == face || (mask & (1u << facePairBit(step.entryFace, face))) == 0)) {
+                continue;
+            }
+            const SectionPos next{step.pos.x + FACE_OFFSETS[face][0], step.pos.y + FACE_OFFSETS[face][1], step.pos.z + FACE_OFFSETS[face][2]};
+            const int nextCell = cell(next);
+            if (nextCell < 0 || mVisited[nextCell] == mTraversal) {
+                continue;
+            }
+            mVisited[nextCell] = mTraversal;
+            mQueue.push_back({next, opposite, static_cast<uint8_t>(step.directions | (1 << face))});
+        }
+    }
+}
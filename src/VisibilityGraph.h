@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "World.h"
+
+// Bit for each unordered pair of the six section faces (in Mesher.h face order), 15 in all.
+inline int facePairBit(int a, int b) {
+    if (a > b) {
+        std::swap(a, b);
+    }
+    return a * 5 - a * (a - 1) / 2 + (b - a - 1);
+}
+
+constexpr uint16_t ALL_FACES_CONNECTED = 0x7FFF;
+
+// Which faces of a section can see each other through non-opaque blocks, computed by flood
+// filling the open cells of the decoded section (Section::VOLUME ids laid out by Section::index()).
+uint16_t computeConnectivity(const uint32_t* blocks);
+
+// Cave culling: sections reachable from the camera's section by entering each section through
+// one face and leaving through a face connected to it, never stepping back towards the camera.
+// Underground sections behind solid rock are never reached.
+class VisibilityGraph {
+    public:
+        void setConnectivity(SectionPos pos, uint16_t mask) { mMasks[pos] = mask; }
+        void erase(SectionPos pos) { mMasks.erase(pos); }
+        [[nodiscard]] uint16_t connectivity(const World& world, SectionPos pos) const;
+
+        // Appends every reachable loaded section within radius columns of start, starting
+        // section included.
+        void traverse(const World& world, SectionPos start, int radius, std::vector<SectionPos>& out);
+
+    private:
+        struct Step {
+            SectionPos pos;
+            int entryFace;
+            // Directions taken since the start; their opposites are never taken.
+            uint8_t directions;
+        };
+
+        // Non-uniform sections only; uniform ones are fully open or fully closed.
+        std::unordered_map<SectionPos, uint16_t, SectionPosHash> mMasks;
+        // Dense grid around the start: loaded columns, and the traversal that last visited each section.
+        std::vector<const Column*> mColumns;
+        std::vector<uint32_t> mVisited;
+        uint32_t mTraversal = 0;
+        std::vector<Step> mQueue;
+};
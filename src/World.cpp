@@ -0,0 +1,79 @@
+#include "World.h"
+
+#include <atomic>
+
+namespace {
+
+const std::shared_ptr<Section>& emptySection() {
+    static const std::shared_ptr<Section> EMPTY = std::make_shared<Section>();
+    return EMPTY;
+}
+
+}
+
+Column::Column() {
+    mSections.fill(emptySection());
+}
+
+Section& Column::mutableSection(int sy) {
+    std::shared_ptr<Section>& section = mSections[sy];
+    // Owners are only added by copying the column, never while it is being written, so a count
+    // of one can't grow behind our back; a snapshot released concurrently costs a needless clone.
+    // use_count() is a relaxed load, so a count of one says nothing about when the save thread
+    // finished reading through the owner it dropped. The acquire fence pairs with the release
+    // decrement of that drop and orders its reads before our writes.
+    if (section.use_count() > 1) {
+        section = std::make_shared<Section>(*section);
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *section;
+}
+
+void Column::clearSection(int sy) {
+    mSections[sy] = emptySection();
+}
+
+Column& World::createColumn(ColumnPos pos) {
+    return mColumns[pos];
+}
+
+void World::removeColumn(ColumnPos pos) {
+    mColumns.erase(pos);
+}
+
+Column* World::column(ColumnPos pos) {
+    auto it = mColumns.find(pos);
+    return it == mColumns.end() ? nullptr : &it->second;
+}
+
+const Column* World::column(ColumnPos pos) const {
+    auto it = mColumns.find(pos);
+    return it == mColumns.end() ? nullptr : &it->second;
+}
+
+const Section* World::section(SectionPos pos) const {
+    if (pos.y < 0 || pos.y >= Column::SECTIONS) {
+        return nullptr;
+    }
+    const Column* col = column({pos.x, pos.z});
+    return col == nullptr ? nullptr : &col->section(pos.y);
+}
+
+BlockId World::getBlock(int32_t x, int32_t y, int32_t z) const {
+    if (y < 0 || y >= Column::HEIGHT) {
+        return AIR;
+    }
+    const Column* col = column({blockToSection(x), blockToSection(z)});
+    return col == nullptr ? static_cast<BlockId>(AIR) : col->get(blockInSection(x), y, blockInSection(z));
+}
+
+void World::setBlock(int32_t x, int32_t y, int32_t z, BlockId block) {
+    if (y < 0 || y >= Column::HEIGHT) {
+        return;
+    }
+    Column* col = column({blockToSection(x), blockToSection(z)});
+    if (col != nullptr) {
+        col->set(blockInSection(x), y, blockInSection(z), block);
+    }
+}
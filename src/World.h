@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include "Section.h"
+
+struct ColumnPos {
+    int32_t x;
+    int32_t z;
+
+    bool operator==(const ColumnPos& other) const {
+        return x == other.x && z == other.z;
+    }
+    bool operator!=(const ColumnPos& other) const {
+        return !(*this == other);
+    }
+};
+
+struct ColumnPosHash {
+    size_t operator()(const ColumnPos& pos) const {
+        return std::hash<uint64_t>()((static_cast<uint64_t>(static_cast<uint32_t>(pos.x)) << 32) | static_cast<uint32_t>(pos.z));
+    }
+};
+
+struct SectionPos {
+    int32_t x;
+    int32_t y;
+    int32_t z;
+
+    bool operator==(const SectionPos& other) const {
+        return x == other.x && y == other.y && z == other.z;
+    }
+    bool operator!=(const SectionPos& other) const {
+        return !(*this == other);
+    }
+};
+
+// Hashes any position with int32_t x, y and z members.
+template <typename Pos>
+struct Int3Hash {
+    size_t operator()(const Pos& pos) const {
+        uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(pos.x)) * 73856093u)
+            ^ (static_cast<uint64_t>(static_cast<uint32_t>(pos.y)) * 19349663u)
+            ^ (static_cast<uint64_t>(static_cast<uint32_t>(pos.z)) * 83492791u);
+        return std::hash<uint64_t>()(key);
+    }
+};
+
+using SectionPosHash = Int3Hash<SectionPos>;
+
+struct BlockPos {
+    int32_t x;
+    int32_t y;
+    int32_t z;
+
+    bool operator==(const BlockPos& other) const {
+        return x == other.x && y == other.y && z == other.z;
+    }
+    bool operator!=(const BlockPos& other) const {
+        return !(*this == other);
+    }
+};
+
+using BlockPosHash = Int3Hash<BlockPos>;
+
+// Block coordinates are converted with arithmetic shifts so negative coordinates round
+// towards negative infinity.
+inline int32_t blockToSection(int32_t block) {
+    return block >> 4;
+}
+
+inline int32_t blockInSection(int32_t block) {
+    return block & (Section::SIZE - 1);
+}
+
+// A vertical stack of sections covering the full world height. Sections are copy-on-write:
+// copying a column only shares its sections, and writing to a shared section clones it first,
+// so a copy is a cheap snapshot that later writes to the original never disturb. Sections that
+// were never written all share one empty section.
+class Column {
+    public:
+        static constexpr int SECTIONS = 16;
+        static constexpr int HEIGHT = SECTIONS * Section::SIZE;
+
+        Column();
+
+        [[nodiscard]] const Section& section(int sy) const { return *mSections[sy]; }
+        // Clones the section first if anything else shares it.
+        Section& mutableSection(int sy);
+        // Back to the shared empty section.
+        void clearSection(int sy);
+
+        [[nodiscard]] BlockId get(int x, int y, int z) const {
+            return mSections[y >> 4]->get(x, y & 15, z);
+        }
+
+        void set(int x, int y, int z, BlockId block) {
+            mutableSection(y >> 4).set(x, y & 15, z, block);
+        }
+
+    private:
+        std::array<std::shared_ptr<Section>, SECTIONS> mSections;
+};
+
+class World {
+    public:
+        using ColumnMap = std::unordered_map<ColumnPos, Column, ColumnPosHash>;
+
+        Column& createColumn(ColumnPos pos);
+        void removeColumn(ColumnPos pos);
+
+        Column* column(ColumnPos pos);
+        [[nodiscard]] const Column* column(ColumnPos pos) const;
+        [[nodiscard]] const Section* section(SectionPos pos) const;
+
+        // Reads outside loaded columns or the world height return AIR; writes there are dropped.
+        [[nodiscard]] BlockId getBlock(int32_t x, int32_t y, int32_t z) const;
+        void setBlock(int32_t x, int32_t y, int32_t z, BlockId block);
+
+        [[nodiscard]] const ColumnMap& columns() const { return mColumns; }
+        [[nodiscard]] size_t columnCount() const { return mColumns.size(); }
+
+    private:
+        ColumnMap mColumns;
+};
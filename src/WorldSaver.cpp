@@ -0,0 +1,215 @@
+#include "WorldSaver.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include "ColumnCodec.h"
+
+namespace {
+
+constexpr char REGION_MAGIC[4] = {'M', 'C', 'R', '1'};
+constexpr size_t REGION_SLOTS = WorldSaver::REGION_COLUMNS * WorldSaver::REGION_COLUMNS;
+constexpr size_t REGION_HEADER_BYTES = sizeof(REGION_MAGIC) + REGION_SLOTS * 8;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void writeLe32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint32_t readLe32(const uint8_t* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+ColumnPos regionOf(ColumnPos pos) {
+    return {pos.x >> 5, pos.z >> 5};
+}
+
+size_t slotOf(ColumnPos pos) {
+    return static_cast<size_t>(pos.z & (WorldSaver::REGION_COLUMNS - 1)) * WorldSaver::REGION_COLUMNS +
+        static_cast<size_t>(pos.x & (WorldSaver::REGION_COLUMNS - 1));
+}
+
+// The whole file, or empty if it is missing or its header is damaged.
+std::vector<uint8_t> readRegion(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return {};
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < REGION_HEADER_BYTES || !std::equal(std::begin(REGION_MAGIC), std::end(REGION_MAGIC), data.begin())) {
+        return {};
+    }
+    return data;
+}
+
+// The slot's column data within a region read by readRegion(), if it has any.
+bool regionEntry(const std::vector<uint8_t>& region, size_t slot, const uint8_t*& data, size_t& size) {
+    if (region.empty()) {
+        return false;
+    }
+    const uint8_t* entry = region.data() + sizeof(REGION_MAGIC) + slot * 8;
+    const uint32_t offset = readLe32(entry);
+    size = readLe32(entry + 4);
+    if (size == 0 || offset < REGION_HEADER_BYTES || offset > region.size() || size > region.size() - offset) {
+        return false;
+    }
+    data = region.data() + offset;
+    return true;
+}
+
+}
+
+static_assert(WorldSaver::REGION_COLUMNS == 32, "regionOf() shifts by 5");
+
+WorldSaver::WorldSaver(std::string directory) : mDirectory(std::move(directory)), mThread([this] { saveLoop(); }) {}
+
+WorldSaver::~WorldSaver() {
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDone.wait(lock, [this] { return !mSaving; });
+        mStopping = true;
+    }
+    mWake.notify_all();
+    mThread.join();
+}
+
+bool WorldSaver::save(const World& world) {
+    const auto start = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSaving) {
+        return false;
+    }
+    mSnapshot.clear();
+    mSnapshot.reserve(world.columnCount());
+    for (const auto& [pos, column] : world.columns()) {
+        mSnapshot.emplace_back(pos, column);
+    }
+    mPendingStats = {};
+    mPendingStats.columns = mSnapshot.size();
+    mPendingStats.snapshotMs = millisecondsSince(start);
+    mSaving = true;
+    mWake.notify_one();
+    return true;
+}
+
+bool WorldSaver::busy() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSaving;
+}
+
+void WorldSaver::wait() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this] { return !mSaving; });
+}
+
+uint64_t WorldSaver::completedSaves() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCompleted;
+}
+
+WorldSaver::SaveStats WorldSaver::lastSave() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLastSave;
+}
+
+std::string WorldSaver::regionPath(ColumnPos region) const {
+    return mDirectory + "/r." + std::to_string(region.x) + "." + std::to_string(region.z) + ".mcr";
+}
+
+void WorldSaver::saveLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWake.wait(lock, [this] { return mSaving || mStopping; });
+        if (mStopping) {
+            return;
+        }
+        // The snapshot is only touched here until mSaving is cleared.
+        lock.unlock();
+        const auto start = std::chrono::steady_clock::now();
+        SaveStats stats = mPendingStats;
+        std::map<std::pair<int32_t, int32_t>, std::vector<size_t>> regions;
+        for (size_t i = 0; i < mSnapshot.size(); i++) {
+            const ColumnPos region = regionOf(mSnapshot[i].first);
+            regions[{region.x, region.z}].push_back(i);
+        }
+        std::error_code error;
+        std::filesystem::create_directories(mDirectory, error);
+        for (const auto& [region, columns] : regions) {
+            stats.bytes += writeRegion({region.first, region.second}, mSnapshot, columns);
+        }
+        stats.regions = regions.size();
+        // Stop sharing sections, so writers no longer clone them.
+        mSnapshot.clear();
+        stats.writeMs = millisecondsSince(start);
+
+        lock.lock();
+        mLastSave = stats;
+        mCompleted++;
+        mSaving = false;
+        mDone.notify_all();
+    }
+}
+
+size_t WorldSaver::writeRegion(ColumnPos region, const Snapshot& snapshot, const std::vector<size_t>& columns) const {
+    const std::string path = regionPath(region);
+    const std::vector<uint8_t> previous = readRegion(path);
+    std::array<const Column*, REGION_SLOTS> saved{};
+    for (size_t i : columns) {
+        saved[slotOf(snapshot[i].first)] = &snapshot[i].second;
+    }
+
+    std::vector<uint8_t> out(REGION_HEADER_BYTES);
+    std::copy(std::begin(REGION_MAGIC), std::end(REGION_MAGIC), out.begin());
+    for (size_t slot = 0; slot < REGION_SLOTS; slot++) {
+        const size_t offset = out.size();
+        const uint8_t* data;
+        size_t size;
+        if (saved[slot] != nullptr) {
+            encodeColumn(*saved[slot], out);
+        } else if (regionEntry(previous, slot, data, size)) {
+            out.insert(out.end(), data, data + size);
+        }
+        const size_t written = out.size() - offset;
+        writeLe32(out.data() + sizeof(REGION_MAGIC) + slot * 8, written > 0 ? static_cast<uint32_t>(offset) : 0);
+        writeLe32(out.data() + sizeof(REGION_MAGIC) + slot * 8 + 4, static_cast<uint32_t>(written));
+    }
+
+    // Written aside and renamed over the old file, so a crash mid-save leaves the previous save.
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+        if (!file) {
+            printf("failed to write %s\n", temporary.c_str());
+            return 0;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        printf("failed to replace %s: %s\n", path.c_str(), error.message().c_str());
+        return 0;
+    }
+    return out.size();
+}
+
+bool WorldSaver::loadColumn(ColumnPos pos, Column& column) const {
+    const std::vector<uint8_t> region = readRegion(regionPath(regionOf(pos)));
+    const uint8_t* data;
+    size_t size;
+    return regionEntry(region, slotOf(pos), data, size) && decodeColumn(data, size, column);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "World.h"
+
+// Saves the world into region files on its own thread. A save only copies each loaded column,
+// which shares its sections (see Column), so the caller's tick pays for a few reference counts
+// per section; the simulation keeps writing and clones just the sections it touches while the
+// save thread encodes and writes the snapshot.
+//
+// A region file holds REGION_COLUMNS x REGION_COLUMNS columns: the magic "MCR1", a table of
+// (offset, size) pairs as little-endian uint32s, then each column in encodeColumn() form.
+// Columns of a region that aren't loaded keep what the file already had.
+class WorldSaver {
+    public:
+        static constexpr int REGION_COLUMNS = 32;
+
+        struct SaveStats {
+            size_t columns = 0;
+            size_t regions = 0;
+            size_t bytes = 0;
+            // On the caller's thread.
+            double snapshotMs = 0.0;
+            // On the save thread.
+            double writeMs = 0.0;
+        };
+
+        explicit WorldSaver(std::string directory);
+        // Finishes a save in progress.
+        ~WorldSaver();
+
+        WorldSaver(const WorldSaver&) = delete;
+        WorldSaver& operator=(const WorldSaver&) = delete;
+
+        // Snapshots every loaded column and starts saving it. Returns false, taking no snapshot,
+        // while the previous save is still running.
+        bool save(const World& world);
+        [[nodiscard]] bool busy() const;
+        void wait();
+
+        [[nodiscard]] uint64_t completedSaves() const;
+        [[nodiscard]] SaveStats lastSave() const;
+
+        // Reads a saved column back. Returns false if it was never saved or the data is damaged.
+        bool loadColumn(ColumnPos pos, Column& column) const;
+
+    private:
+        using Snapshot = std::vector<std::pair<ColumnPos, Column>>;
+
+        void saveLoop();
+        // Returns the bytes written.
+        size_t writeRegion(ColumnPos region, const Snapshot& snapshot, const std::vector<size_t>& columns) const;
+        [[nodiscard]] std::string regionPath(ColumnPos region) const;
+
+        std::string mDirectory;
+        mutable std::mutex mMutex;
+        std::condition_variable mWake;
+        std::condition_variable mDone;
+        Snapshot mSnapshot;
+        bool mSaving = false;
+        bool mStopping = false;
+        uint64_t mCompleted = 0;
+        SaveStats mPendingStats;
+        SaveStats mLastSave;
+        // Last, so everything above exists before the thread starts.
+        std::thread mThread;
+};
@@ -6,21 +6,57 @@
 #include <SDL3/SDL_vulkan.h>
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_video.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <random>
 #include <set>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
 #include <fstream>
 #include <glm.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include "Camera.h"
+#include "ChunkStreamer.h"
+#include "ColumnCache.h"
+#include "Components.h"
+#include "Ecs.h"
+#include "FrameStats.h"
+#include "JobSystem.h"
+#include "LodMesher.h"
+#include "Mesher.h"
+#include "Models.h"
+#include "OcclusionRasterizer.h"
+#include "RangeAllocator.h"
+#include "ShaderWatcher.h"
+#include "TerrainGenerator.h"
+#include "VisibilityGraph.h"
+#include "World.h"
+#include "WorldSaver.h"
+#include "Shaders/vert_spv.h"
+#include "Shaders/model_spv.h"
+#include "Shaders/frag_spv.h"
+#include "Shaders/mesher_spv.h"
+#include "Shaders/hiz_spv.h"
+#include "Shaders/cull_spv.h"
 
 constexpr int SCREEN_WIDTH = 1200;
 constexpr int SCREEN_HEIGHT = 800;
+constexpr uint64_t WORLD_SEED = 20241201;
 
 const std::vector validationLayers = {
     "VK_LAYER_KHRONOS_validation"
@@ -62,7 +98,6 @@ static std::vector<char> readFile(const std::string& file_name) {
 
     const int64_t file_size = file.tellg();
     std::vector<char> buffer(file_size);
-    std::cout << "Size of " << file_name << ": " << file_size << std::endl;
 
     file.seekg(0);
     file.read(buffer.data(), file_size);
@@ -71,6 +106,21 @@ static std::vector<char> readFile(const std::string& file_name) {
     return buffer;
 }
 
+// Compiled from src/Shaders and embedded by the build; see CMakeLists.txt.
+struct EmbeddedSpirv {
+    const char* name;
+    const uint32_t* words;
+    size_t count;
+};
+static constexpr EmbeddedSpirv EMBEDDED_SHADERS[] = {
+    {"vert", VERT_SPIRV, std::size(VERT_SPIRV)},
+    {"model", MODEL_SPIRV, std::size(MODEL_SPIRV)},
+    {"frag", FRAG_SPIRV, std::size(FRAG_SPIRV)},
+    {"mesher", MESHER_SPIRV, std::size(MESHER_SPIRV)},
+    {"hiz", HIZ_SPIRV, std::size(HIZ_SPIRV)},
+    {"cull", CULL_SPIRV, std::size(CULL_SPIRV)},
+};
+
 void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
     createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -83,6 +133,7 @@ class HelloTriangleApplication {
         void run() {
             initSDL();
             openWindow();
+            loadPresentProfile();
             initVulkan();
             mainLoop();
             cleanup();
@@ -94,6 +145,8 @@ class HelloTriangleApplication {
         VkDevice mLogicalDevice = VK_NULL_HANDLE;
         VkQueue mGraphicsQueue = VK_NULL_HANDLE;
         VkQueue mPresentQueue = VK_NULL_HANDLE;
+        VkQueue mComputeQueue = VK_NULL_HANDLE;
+        VkQueue mTransferQueue = VK_NULL_HANDLE;
         VkSurfaceKHR mSurface = VK_NULL_HANDLE;
         VkExtent2D mSwapchainExtent{};
         VkFormat mSwapFormat{};
@@ -103,31 +156,399 @@ class HelloTriangleApplication {
         std::vector<VkFramebuffer> mSwapchainFrameBuffers;
         VkRenderPass mRenderPass = VK_NULL_HANDLE;
         VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
-        VkPipeline mGraphicsPipeline = VK_NULL_HANDLE;
         VkCommandPool mCommandPool = VK_NULL_HANDLE;
-        VkBuffer mVertexBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory mDeviceMemory = VK_NULL_HANDLE;
+        VkCommandPool mComputeCommandPool = VK_NULL_HANDLE;
+        VkCommandPool mTransferCommandPool = VK_NULL_HANDLE;
         std::vector<VkCommandBuffer> mCommandBuffers;
         std::vector<VkSemaphore> mImageAvailableSemaphores;
         std::vector<VkSemaphore> mRenderFinishSemaphores;
         std::vector<VkFence> mFlightFences;
-        static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
         uint32_t mCurrentFrame = 0;
         bool mFramebufferResized = false;
 
+        struct PresentProfile {
+            VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            uint32_t framesInFlight = 2;
+            uint32_t imageCount = 0; // 0 = minImageCount + 1
+        };
+        PresentProfile mProfile;
+        VkPresentModeKHR mPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+        FrameStats mFrameStats;
+        uint64_t mInputSampleNs = 0;
+        uint64_t mLastPresentNs = 0;
+        double mSweepSeconds = 0.0;
+
+        // Resources retired while frames may still reference them are destroyed once the
+        // submission that was current at retirement has completed.
+        struct PendingDeletion {
+            uint64_t submission;
+            std::function<void()> destroy;
+        };
+        std::deque<PendingDeletion> mDeletionQueue;
+        std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> mFrameSubmissions{};
+        uint64_t mSubmissionCount = 0;
+        uint64_t mCompletedSubmission = 0;
+
         const std::vector<const char*> requiredDeviceExtensions = {
-            "VK_KHR_portability_subset",
             VK_KHR_SWAPCHAIN_EXTENSION_NAME
         };
+        // Must be enabled when the implementation exposes it (MoltenVK), absent everywhere else.
+        static constexpr const char* PORTABILITY_SUBSET_EXTENSION_NAME = "VK_KHR_portability_subset";
 
         struct QueueFamilyIndicies {
             std::optional<uint32_t> graphicsFamily;
             std::optional<uint32_t> presentFamily;
+            // Fall back to the graphics family when the device has no dedicated family.
+            std::optional<uint32_t> computeFamily;
+            std::optional<uint32_t> transferFamily;
 
             [[nodiscard]] bool isComplete() const {
                 return graphicsFamily.has_value() && presentFamily.has_value();
             }
         };
+        QueueFamilyIndicies mQueueFamilies;
+
+        enum class BufferOwner { Graphics, Compute };
+
+        // A copy recorded on the transfer queue whose buffer still has to be acquired by the
+        // graphics or compute family before use. Entries without a buffer only make the next
+        // submission wait on the semaphore.
+        struct PendingAcquire {
+            VkBuffer buffer;
+            VkDeviceSize offset;
+            VkDeviceSize size;
+            VkSemaphore transferDone;
+            VkPipelineStageFlags dstStage;
+            VkAccessFlags dstAccess;
+        };
+        std::vector<PendingAcquire> mPendingGraphicsAcquires;
+        std::vector<PendingAcquire> mPendingComputeAcquires;
+
+        struct InFlightUpload {
+            VkFence fence;
+            VkCommandBuffer commandBuffer;
+            // Where its data starts in mUploadStaging.
+            VkDeviceSize stagingOffset;
+        };
+        // Retired in submission order, so the oldest upload's offset is where the staging ring's
+        // free space ends.
+        std::deque<InFlightUpload> mInFlightUploads;
+        // Fences and command buffers of retired uploads, and semaphores whose waits have
+        // completed, reused instead of being created for every upload.
+        std::vector<InFlightUpload> mIdleUploads;
+        std::vector<VkSemaphore> mIdleSemaphores;
+
+        struct GpuBuffer {
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            void* mapped = nullptr;
+        };
+
+        // Every upload is staged in this ring rather than in a buffer of its own.
+        static constexpr VkDeviceSize UPLOAD_STAGING_BYTES = 32ull << 20;
+        GpuBuffer mUploadStaging;
+        VkDeviceSize mUploadHead = 0;
+
+        bool mMultiDrawIndirect = false;
+        bool mDrawIndirectFirstInstance = false;
+        VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+
+        // GPU mesher (Shaders/mesher.comp). Sections are meshed in batches into fixed-size input
+        // buffers; every meshed section owns a draw slot whose indirect command the mesher fills.
+        // A batch is two submissions: the first counts faces, then the host allocates each
+        // section's vertices from mFullResArena and the second emits them there.
+        static constexpr uint32_t MAX_SECTION_DRAWS = 16384;
+        static constexpr uint32_t MAX_MESH_BATCH_SECTIONS = 128;
+        static constexpr uint32_t MAX_MESH_BATCH_ENTRIES = MAX_MESH_BATCH_SECTIONS * 7;
+        static constexpr VkDeviceSize TERRAIN_ARENA_BYTES = 256ull << 20;
+        VkDescriptorSetLayout mMesherSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout mMesherPipelineLayout = VK_NULL_HANDLE;
+        VkPipeline mMesherPipeline = VK_NULL_HANDLE;
+        VkDescriptorSet mMesherSet = VK_NULL_HANDLE;
+        GpuBuffer mMeshBlocks;
+        GpuBuffer mMeshNeighbors;
+        GpuBuffer mMeshSlots;
+        GpuBuffer mMeshFaceCounts;
+        GpuBuffer mBlockTable;
+        GpuBuffer mSectionDrawCommands;
+        GpuBuffer mTerrainArena;
+        // Host-visible: the face counts are read back and each section's first vertex written
+        // between a batch's two submissions. NO_RANGE marks a section that didn't fit.
+        GpuBuffer mMeshFirstVertices;
+        static constexpr uint32_t NO_RANGE = 0xFFFFFFFFu;
+
+        struct MesherParams {
+            uint32_t pass;
+            uint32_t sectionCount;
+        };
+
+        struct MeshBatch {
+            std::vector<SectionPos> sections;
+            std::vector<uint32_t> slots;
+            std::vector<uint32_t> blocks;
+            std::vector<int32_t> neighbors;
+            std::vector<VkSemaphore> uploadSemaphores;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+            // Recorded into both submissions, so a reload in between can't split the batch.
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            // Set once the face counts are back and the emitting submission is in flight.
+            bool emitting = false;
+            // Sections left undrawn because mFullResArena had no room for them.
+            size_t overflowed = 0;
+            // A mesher pipeline replaced by a shader reload while this batch was using it.
+            VkPipeline retiredPipeline = VK_NULL_HANDLE;
+        };
+        std::optional<MeshBatch> mMeshBatch;
+        std::deque<SectionPos> mMeshQueue;
+        std::vector<SectionPos> mSectionSlots;
+        uint32_t mDrawnSectionSlots = 0;
+        bool mValidateMesher = false;
+
+        // Level of detail. Columns near the camera draw the GPU mesher's full-resolution slots,
+        // kept in mFullResArena, farther ones CPU-built meshes (LodMesher.h) kept in the top
+        // LOD_ARENA_BYTES of the terrain arena. Every mesh has its own slots and only those of a column's displayed
+        // level are active, so a column switches level in one frame once its target is ready.
+        static constexpr VkDeviceSize LOD_ARENA_BYTES = 64ull << 20;
+        static constexpr uint32_t GPU_MESH_ARENA_VERTICES = (TERRAIN_ARENA_BYTES - LOD_ARENA_BYTES) / sizeof(MeshVertex);
+        static constexpr VkDeviceSize LOD_STAGING_BYTES = 4ull << 20;
+        static constexpr uint32_t MAX_LOD_BUILDS_PER_FRAME = 8;
+        static constexpr float LOD_HYSTERESIS = 1.0f;
+        struct LodMesh {
+            bool built = false;
+            uint32_t firstVertex = 0;
+            uint32_t vertexCount = 0;
+            std::vector<uint32_t> slots;
+        };
+        struct ColumnLod {
+            // Level whose slots are active, -1 until one is ready.
+            int displayed = -1;
+            int target = -1;
+            bool fullResQueued = false;
+            uint32_t fullResPending = 0;
+            std::vector<uint32_t> fullResSlots;
+            // (first vertex, count) in mFullResArena of each meshed full-resolution section.
+            std::vector<std::pair<uint32_t, uint32_t>> fullResRanges;
+            // Indexed by level; level 0 lives in fullResSlots.
+            std::array<LodMesh, LOD_LEVELS> meshes;
+        };
+        std::unordered_map<ColumnPos, ColumnLod, ColumnPosHash> mColumnLods;
+        // MC_LOD_DISTANCE: columns from the camera where level 1 starts; each level doubles it.
+        float mLodDistance = 8.0f;
+        RangeAllocator mFullResArena;
+        RangeAllocator mLodArena;
+        std::vector<uint32_t> mFreeSlots;
+        std::vector<uint8_t> mSlotActive;
+        // Host-visible, LOD_STAGING_BYTES per frame in flight; recordLodUploads() copies what a
+        // frame staged into the arena and the draw commands before anything reads them.
+        GpuBuffer mLodStaging;
+        VkDeviceSize mLodStagingUsed = 0;
+        std::vector<VkBufferCopy> mLodVertexCopies;
+        std::vector<VkBufferCopy> mLodDrawCopies;
+
+        // Hi-Z occlusion culling. Each frame draws last frame's visible sections depth-only, reduces
+        // that depth into a pyramid (Shaders/hiz.comp), then tests every candidate section against
+        // it (Shaders/cull.comp) and compacts the survivors into mVisibleDraws for the main pass.
+        struct DepthTargets {
+            VkImage depthImage = VK_NULL_HANDLE;
+            VkDeviceMemory depthMemory = VK_NULL_HANDLE;
+            VkImageView depthView = VK_NULL_HANDLE;
+            VkFramebuffer prepassFramebuffer = VK_NULL_HANDLE;
+            VkImage pyramidImage = VK_NULL_HANDLE;
+            VkDeviceMemory pyramidMemory = VK_NULL_HANDLE;
+            VkImageView pyramidView = VK_NULL_HANDLE;
+            std::vector<VkImageView> pyramidLevelViews;
+            std::vector<VkExtent2D> pyramidLevelExtents;
+            std::vector<VkDescriptorSet> hizSets;
+            VkDescriptorSet cullSet = VK_NULL_HANDLE;
+            bool pyramidInitialized = false;
+        };
+        DepthTargets mDepthTargets;
+        VkFormat mDepthFormat = VK_FORMAT_UNDEFINED;
+        VkRenderPass mDepthPrepassRenderPass = VK_NULL_HANDLE;
+        VkSampler mHizSampler = VK_NULL_HANDLE;
+        VkDescriptorSetLayout mHizSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout mHizPipelineLayout = VK_NULL_HANDLE;
+        VkPipeline mHizPipeline = VK_NULL_HANDLE;
+        VkDescriptorSetLayout mCullSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout mCullPipelineLayout = VK_NULL_HANDLE;
+        VkPipeline mCullPipeline = VK_NULL_HANDLE;
+        GpuBuffer mSectionBounds;
+        GpuBuffer mCullCandidates;
+        GpuBuffer mVisibleDraws;
+        GpuBuffer mCullCounters;
+        GpuBuffer mCullReadback;
+        std::array<bool, MAX_FRAMES_IN_FLIGHT> mCullReadbackPending{};
+        // VK_KHR_draw_indirect_count; without it the visible list is zero-filled and drawn in full.
+        PFN_vkCmdDrawIndirectCountKHR mCmdDrawIndirectCount = nullptr;
+
+        // Every pipeline is created through this cache, which is kept in PIPELINE_CACHE_FILE
+        // between runs so later startups and shader reloads skip recompiling what hasn't changed.
+        static constexpr const char* PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+        VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+
+        // Terrain pipelines are built on first use and cached by a packed key. The pass picks the
+        // fixed-function state and, with the debug view, frag.spv's specialization constants, so
+        // a variant's unused branches are compiled out rather than tested per fragment.
+        enum PipelinePass : uint32_t {
+            PASS_OPAQUE,
+            PASS_CUTOUT,
+            PASS_TRANSLUCENT,
+            PASS_DEPTH_PREPASS,
+        };
+        // MC_DEBUG_VIEW=depth|overdraw.
+        enum DebugView : uint32_t {
+            DEBUG_NONE,
+            DEBUG_DEPTH,
+            DEBUG_OVERDRAW,
+        };
+        // Instanced variants draw repeated models with model.vert in place of shader.vert.
+        static constexpr uint32_t PIPELINE_INSTANCED = 1 << 4;
+        static constexpr uint32_t pipelineKey(PipelinePass pass, DebugView debugView, bool instanced = false) {
+            return pass | debugView << 2 | (instanced ? PIPELINE_INSTANCED : 0);
+        }
+        std::unordered_map<uint32_t, VkPipeline> mPipelineVariants;
+        DebugView mDebugView = DEBUG_NONE;
+
+        // shader.vert's push constants, within the 128 bytes every device guarantees. Positions
+        // are made camera-relative in integer blocks before any float math, so precision holds
+        // far from the world origin; per draw only drawOrigin is pushed.
+        struct CameraPushConstants {
+            glm::mat4 viewProj;
+            glm::ivec4 cameraBlock;
+            glm::vec4 cameraFraction;
+            // w != 0: this draw's origin in blocks. Otherwise the draw is a section and its origin
+            // is read from mSectionBounds at the instance index, which the cull pass sets to its slot.
+            glm::ivec4 drawOrigin;
+        };
+        static_assert(sizeof(CameraPushConstants) <= 128, "push constants past the guaranteed minimum");
+        CameraPushConstants mCameraPush{};
+        VkDescriptorSetLayout mTerrainSetLayout = VK_NULL_HANDLE;
+        VkDescriptorSet mTerrainSet = VK_NULL_HANDLE;
+
+        // MC_SHADER_RELOAD=1 watches Shaders/ and rebuilds the pipelines whose SPIR-V changed on
+        // a background thread; they're swapped in at the start of a frame, and the old ones
+        // destroyed once the frames and mesh batch using them retire.
+        enum ShaderPipelines : uint32_t {
+            SHADERS_GRAPHICS = 1 << 0,
+            SHADERS_MESHER = 1 << 1,
+            SHADERS_HIZ = 1 << 2,
+            SHADERS_CULL = 1 << 3,
+        };
+        struct ShaderReload {
+            uint32_t pipelines = 0;
+            // Every cached variant, keyed as in mPipelineVariants.
+            std::vector<std::pair<uint32_t, VkPipeline>> variants;
+            VkPipeline mesher = VK_NULL_HANDLE;
+            VkPipeline hiz = VK_NULL_HANDLE;
+            VkPipeline cull = VK_NULL_HANDLE;
+            std::string error;
+            double ms = 0.0;
+        };
+        // Writes usually come in bursts (one per shader compiled); a rebuild waits for them to settle.
+        static constexpr uint64_t SHADER_SETTLE_NS = 100'000'000;
+        std::unique_ptr<ShaderWatcher> mShaderWatcher;
+        uint32_t mChangedShaders = 0;
+        uint64_t mShaderChangeNs = 0;
+        std::future<ShaderReload> mShaderReload;
+
+        // Every section spans Section::SIZE blocks, so only its origin is kept, in whole blocks
+        // so that it stays exact however far out it is.
+        struct SectionBounds {
+            glm::ivec4 origin;
+        };
+
+        struct HizParams {
+            int32_t srcSize[2];
+            int32_t dstSize[2];
+        };
+
+        // Bounds are tested camera-relative, like shader.vert draws them.
+        struct CullParams {
+            glm::mat4 viewProj;
+            glm::ivec4 cameraBlock;
+            glm::vec4 cameraFraction;
+            uint32_t candidateOffset;
+            uint32_t candidateCount;
+            uint32_t pyramidLevels;
+            uint32_t occlusionTest;
+            int32_t depthSize[2];
+        };
+        static_assert(sizeof(CullParams) <= 128, "push constants past the guaranteed minimum");
+
+        struct CullCounters {
+            uint32_t visible;
+            uint32_t occluded;
+            uint32_t frustumCulled;
+        };
+
+        // Software occlusion (MC_CULLING=cpu) for when the Hi-Z path is unavailable or too slow:
+        // exposed faces of fully solid sections are rasterized into a small CPU depth buffer and
+        // the candidates they hide never reach the cull pass, which then only tests the frustum.
+        static constexpr size_t MAX_OCCLUDERS = 512;
+        bool mCpuOcclusion = false;
+        JobSystem mJobs;
+        OcclusionRasterizer mOcclusionRasterizer;
+        std::vector<OcclusionRasterizer::Quad> mOccluders;
+        // Column of each occluder, so they leave with it.
+        std::vector<ColumnPos> mOccluderColumns;
+        // Host copy of mSectionBounds, which lives in write-combined memory.
+        std::vector<SectionBounds> mSlotBounds;
+        std::vector<uint8_t> mSlotVisible;
+        std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> mCpuOccluded{};
+        glm::mat4 mViewProj{1.0f};
+
+        // Cave culling (MC_CAVE_CULLING=0 disables): only sections reachable from the camera's
+        // section through connected faces are candidates. The traversal is redone when the camera
+        // changes section or newly meshed sections bring new connectivity masks.
+        bool mCaveCulling = true;
+        VisibilityGraph mVisibilityGraph;
+        std::vector<SectionPos> mReachableSections;
+        std::vector<uint8_t> mSlotReachable;
+        std::optional<SectionPos> mReachableFrom;
+        std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> mCaveCulled{};
+        // Item drops, mobs and foliage are entities with a Position and a Model. Each frame they're
+        // grouped by mesh into this frame's MAX_MODEL_INSTANCES of mModelInstances, and every mesh
+        // is one instanced draw however many copies there are. MC_MODELS=<count> scatters some.
+        static constexpr uint32_t MAX_MODEL_INSTANCES = 16384;
+        struct ModelDraw {
+            uint32_t firstVertex = 0;
+            uint32_t vertexCount = 0;
+            uint32_t firstInstance = 0;
+            uint32_t instanceCount = 0;
+        };
+        EntityRegistry mEntities;
+        GpuBuffer mModelVertices;
+        GpuBuffer mModelInstances;
+        std::array<ModelDraw, MODEL_MESH_COUNT> mModelDraws{};
+        uint64_t mModelUpdateNs = 0;
+
+        // WASD moves, space and shift rise and sink, the arrow keys look around.
+        Camera mCamera;
+        uint64_t mCameraUpdateNs = 0;
+        static constexpr float CAMERA_SPEED = 12.0f;
+        static constexpr float CAMERA_TURN_SPEED = 1.8f;
+        int mViewRadius = 6;
+
+        World mWorld;
+        TerrainGenerator mTerrain{WORLD_SEED};
+        // Columns are generated, handed to updateLod() and released around the camera within
+        // per-frame budgets; the queues and rates are printed once a second while it works.
+        ChunkStreamer mStreamer{mWorld, mTerrain, mJobs};
+        // MC_COLUMN_CACHE_MB: unloaded columns and built LOD meshes kept for when the camera
+        // comes back.
+        ColumnCache mColumnCache{64ull << 20};
+        ChunkStreamer::Stats mStreamTotals;
+        uint64_t mStreamFrames = 0;
+        uint64_t mStreamReportNs = 0;
+        // MC_AUTOSAVE=<seconds>: loaded columns are saved into "world/" in the background that
+        // often, and once more on exit.
+        std::unique_ptr<WorldSaver> mSaver;
+        uint64_t mAutosaveIntervalNs = 0;
+        uint64_t mLastAutosaveNs = 0;
+        uint64_t mReportedSaves = 0;
 
         struct SwapChainSupportDetails {
             VkSurfaceCapabilitiesKHR capabilities;
@@ -136,7 +557,7 @@ class HelloTriangleApplication {
         };
 
         struct Vertex {
-            glm::vec2 pos;
+            glm::vec3 pos;
             glm::vec3 color;
 
             static VkVertexInputBindingDescription getBindingDescription() {
@@ -151,7 +572,7 @@ class HelloTriangleApplication {
                 std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
                 attributeDescriptions[0].binding = 0;
                 attributeDescriptions[0].location = 0;
-                attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+                attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
                 attributeDescriptions[0].offset = offsetof(Vertex, pos);
 
                 attributeDescriptions[1].binding = 0;
@@ -162,10 +583,36 @@ class HelloTriangleApplication {
             }
         };
 
-        const std::vector<Vertex> mVertices = {
-            {{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-            {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
-            {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+        static_assert(sizeof(Vertex) == sizeof(MeshVertex), "terrain arena vertices are drawn through the Vertex binding");
+
+        // Binding 1 of the instanced pipelines, one per drawn model.
+        struct ModelInstance {
+            // Position of the model's origin relative to the camera, and its yaw.
+            glm::vec4 offsetYaw;
+            // RGB tint, and a uniform scale.
+            glm::vec4 tintScale;
+
+            static VkVertexInputBindingDescription getBindingDescription() {
+                VkVertexInputBindingDescription description{};
+                description.binding = 1;
+                description.stride = sizeof(ModelInstance);
+                description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+                return description;
+            }
+
+            static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
+                std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+                attributeDescriptions[0].binding = 1;
+                attributeDescriptions[0].location = 2;
+                attributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                attributeDescriptions[0].offset = offsetof(ModelInstance, offsetYaw);
+
+                attributeDescriptions[1].binding = 1;
+                attributeDescriptions[1].location = 3;
+                attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                attributeDescriptions[1].offset = offsetof(ModelInstance, tintScale);
+                return attributeDescriptions;
+            }
         };
 
         static bool initSDL() {
@@ -189,6 +636,48 @@ class HelloTriangleApplication {
             return true;
         }
 
+        static const char* presentModeName(VkPresentModeKHR mode) {
+            switch (mode) {
+                case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+                case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+                case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+                case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo_relaxed";
+                default: return "unknown";
+            }
+        }
+
+        static std::optional<VkPresentModeKHR> parsePresentMode(const std::string& name) {
+            for (VkPresentModeKHR mode : {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR}) {
+                if (name == presentModeName(mode)) {
+                    return mode;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // MC_PRESENT_MODE=fifo|fifo_relaxed|mailbox|immediate, MC_FRAMES_IN_FLIGHT=1..3,
+        // MC_SWAPCHAIN_IMAGES=n, MC_PROFILE_SWEEP=<seconds per profile>
+        void loadPresentProfile() {
+            if (const char* mode = std::getenv("MC_PRESENT_MODE")) {
+                if (auto parsed = parsePresentMode(mode)) {
+                    mProfile.presentMode = parsed.value();
+                } else {
+                    std::cout << "Unknown MC_PRESENT_MODE '" << mode << "', using " << presentModeName(mProfile.presentMode) << std::endl;
+                }
+            }
+            if (const char* frames = std::getenv("MC_FRAMES_IN_FLIGHT")) {
+                mProfile.framesInFlight = std::clamp<uint32_t>(std::strtoul(frames, nullptr, 10), 1, MAX_FRAMES_IN_FLIGHT);
+            }
+            if (const char* images = std::getenv("MC_SWAPCHAIN_IMAGES")) {
+                mProfile.imageCount = std::strtoul(images, nullptr, 10);
+            }
+            if (const char* sweep = std::getenv("MC_PROFILE_SWEEP")) {
+                mSweepSeconds = std::strtod(sweep, nullptr);
+            }
+            printf("present profile: mode %s, frames in flight %u, swapchain images %u\n",
+                presentModeName(mProfile.presentMode), mProfile.framesInFlight, mProfile.imageCount);
+        }
+
         void initVulkan() {
             createInstance();
             createSurface();
@@ -197,12 +686,22 @@ class HelloTriangleApplication {
             createSwapChain();
             createSwapChainViews();
             createRenderPass();
+            createPipelineCache();
+            watchShaders();
             createGraphicsPipeline();
-            createFrameBuffers();
+            createDescriptorPool();
+            createMesherPipeline();
+            createCullingPipelines();
             createCommandPool();
-            createVertexBuffer();
+            createUploadStaging();
+            createTerrainBuffers();
+            createCullingBuffers();
+            createModelBuffers();
+            createDepthTargets();
+            createFrameBuffers();
             createCommandBuffers();
             createSyncObjects();
+            setupWorld();
         }
 
         void createSurface() {
@@ -214,9 +713,15 @@ class HelloTriangleApplication {
 
         void createLogicalDevice() {
             QueueFamilyIndicies indices = findQueueFamilies(mPhysicalDevice);
+            mQueueFamilies = indices;
+            printf("queue families: graphics %u, present %u, compute %u%s, transfer %u%s\n",
+                indices.graphicsFamily.value(), indices.presentFamily.value(),
+                indices.computeFamily.value(), indices.computeFamily != indices.graphicsFamily ? " (dedicated)" : "",
+                indices.transferFamily.value(), indices.transferFamily != indices.graphicsFamily ? " (dedicated)" : "");
 
             std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-            std::set uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+            std::set uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value(),
+                indices.computeFamily.value(), indices.transferFamily.value()};
             float queuePriority = 1.0f;
             for (uint32_t queueFamily : uniqueQueueFamilies) {
                 VkDeviceQueueCreateInfo queueCreateInfo {};
@@ -227,14 +732,29 @@ class HelloTriangleApplication {
                 queueCreateInfos.push_back(queueCreateInfo);
             }
 
+            VkPhysicalDeviceFeatures supportedFeatures;
+            vkGetPhysicalDeviceFeatures(mPhysicalDevice, &supportedFeatures);
+            mMultiDrawIndirect = supportedFeatures.multiDrawIndirect;
+            mDrawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
             VkPhysicalDeviceFeatures logicalDeviceFeatures{};
+            logicalDeviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+            logicalDeviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
             VkDeviceCreateInfo logicalDeviceCreateInfo{};
             logicalDeviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
             logicalDeviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
             logicalDeviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
             logicalDeviceCreateInfo.pEnabledFeatures = &logicalDeviceFeatures;
-            logicalDeviceCreateInfo.enabledExtensionCount = requiredDeviceExtensions.size();
-            logicalDeviceCreateInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
+            std::vector<const char*> deviceExtensions = requiredDeviceExtensions;
+            if (supportsDeviceExtension(mPhysicalDevice, PORTABILITY_SUBSET_EXTENSION_NAME)) {
+                deviceExtensions.push_back(PORTABILITY_SUBSET_EXTENSION_NAME);
+            }
+            const bool drawIndirectCount = supportsDeviceExtension(mPhysicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            if (drawIndirectCount) {
+                deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            }
+            logicalDeviceCreateInfo.enabledExtensionCount = deviceExtensions.size();
+            logicalDeviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
             if (enableValidationLayers) {
                 logicalDeviceCreateInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -248,6 +768,13 @@ class HelloTriangleApplication {
             }
             vkGetDeviceQueue(mLogicalDevice, indices.graphicsFamily.value(), 0, &mGraphicsQueue);
             vkGetDeviceQueue(mLogicalDevice, indices.presentFamily.value(), 0, &mPresentQueue);
+            vkGetDeviceQueue(mLogicalDevice, indices.computeFamily.value(), 0, &mComputeQueue);
+            vkGetDeviceQueue(mLogicalDevice, indices.transferFamily.value(), 0, &mTransferQueue);
+
+            if (drawIndirectCount) {
+                mCmdDrawIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndirectCountKHR>(
+                    vkGetDeviceProcAddr(mLogicalDevice, "vkCmdDrawIndirectCountKHR"));
+            }
         }
 
         void setupDebugMessenger() const {
@@ -274,16 +801,108 @@ class HelloTriangleApplication {
             std::vector<VkPhysicalDevice> physDevices(deviceCount);
             vkEnumeratePhysicalDevices(gInstance, &deviceCount, physDevices.data());
 
-            for (const auto& device : physDevices) {
-                if (isDeviceSuitable(device)) {
-                    mPhysicalDevice = device;
-                    break;
+            const char* overrideName = std::getenv("MC_GPU");
+            if (overrideName != nullptr && *overrideName == '\0') {
+                overrideName = nullptr;
+            }
+            std::optional<size_t> overrideIndex;
+            if (overrideName != nullptr) {
+                char* end = nullptr;
+                size_t index = std::strtoul(overrideName, &end, 10);
+                if (*end == '\0') {
+                    overrideIndex = index;
+                }
+            }
+
+            int64_t bestScore = -1;
+            bool overridden = false;
+            for (size_t i = 0; i < physDevices.size(); i++) {
+                VkPhysicalDeviceProperties props;
+                vkGetPhysicalDeviceProperties(physDevices[i], &props);
+                bool suitable = isDeviceSuitable(physDevices[i]);
+                int64_t score = suitable ? scorePhysicalDevice(physDevices[i]) : -1;
+                printf("GPU %zu: %s (%s) score %lld%s\n", i, props.deviceName, deviceTypeName(props.deviceType),
+                    static_cast<long long>(score), suitable ? "" : " [unsuitable]");
+                if (!suitable || overridden) {
+                    continue;
+                }
+
+                bool matchesOverride = overrideIndex.has_value() ? overrideIndex.value() == i
+                    : overrideName != nullptr && containsIgnoreCase(props.deviceName, overrideName);
+                if (matchesOverride) {
+                    mPhysicalDevice = physDevices[i];
+                    overridden = true;
+                } else if (score > bestScore) {
+                    mPhysicalDevice = physDevices[i];
+                    bestScore = score;
                 }
             }
 
             if (mPhysicalDevice == VK_NULL_HANDLE) {
                 throw std::runtime_error("Failed to find suitable physical device");
             }
+            if (overrideName != nullptr && !overridden) {
+                std::cout << "MC_GPU='" << overrideName << "' matched no suitable device, using highest score" << std::endl;
+            }
+
+            VkPhysicalDeviceProperties chosen;
+            vkGetPhysicalDeviceProperties(mPhysicalDevice, &chosen);
+            printf("Using GPU: %s (%s)\n", chosen.deviceName, overridden ? "MC_GPU override" : "highest score");
+        }
+
+        static const char* deviceTypeName(VkPhysicalDeviceType type) {
+            switch (type) {
+                case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+                case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+                case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+                case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+                default: return "other";
+            }
+        }
+
+        static bool containsIgnoreCase(const std::string& haystack, const std::string& needle) {
+            auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            });
+            return it != haystack.end();
+        }
+
+        // Device type dominates so a discrete GPU always beats an integrated one or a software
+        // rasterizer; memory, limits and optional features break ties within a type.
+        static int64_t scorePhysicalDevice(VkPhysicalDevice device) {
+            VkPhysicalDeviceProperties props;
+            vkGetPhysicalDeviceProperties(device, &props);
+            VkPhysicalDeviceFeatures features;
+            vkGetPhysicalDeviceFeatures(device, &features);
+            VkPhysicalDeviceMemoryProperties memProps;
+            vkGetPhysicalDeviceMemoryProperties(device, &memProps);
+
+            int64_t score = 0;
+            switch (props.deviceType) {
+                case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score += 1000000; break;
+                case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score += 500000; break;
+                case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score += 250000; break;
+                case VK_PHYSICAL_DEVICE_TYPE_CPU: break;
+                default: score += 100000; break;
+            }
+
+            VkDeviceSize deviceLocalBytes = 0;
+            for (uint32_t i = 0; i < memProps.memoryHeapCount; i++) {
+                if (memProps.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                    deviceLocalBytes = std::max(deviceLocalBytes, memProps.memoryHeaps[i].size);
+                }
+            }
+            score += std::min<int64_t>(static_cast<int64_t>(deviceLocalBytes >> 20), 65536) * 4;
+
+            score += props.limits.maxImageDimension2D / 16;
+            score += props.limits.maxComputeSharedMemorySize / 1024;
+            if (props.limits.maxDrawIndirectCount > 1) score += 2000;
+
+            if (features.multiDrawIndirect) score += 5000;
+            if (features.drawIndirectFirstInstance) score += 2000;
+            if (features.samplerAnisotropy) score += 1000;
+            if (features.fillModeNonSolid) score += 250;
+            return score;
         }
 
         bool isDeviceSuitable(VkPhysicalDevice physDevice) {
@@ -297,6 +916,20 @@ class HelloTriangleApplication {
             return indicies.isComplete() && swapChainAdequate;
         }
 
+        static bool supportsDeviceExtension(VkPhysicalDevice physDevice, const char* extension) {
+            uint32_t supportedExtCount;
+            vkEnumerateDeviceExtensionProperties(physDevice, nullptr, &supportedExtCount, nullptr);
+            std::vector<VkExtensionProperties> supportedExtensions(supportedExtCount);
+            vkEnumerateDeviceExtensionProperties(physDevice, nullptr, &supportedExtCount, supportedExtensions.data());
+
+            for (const VkExtensionProperties& supported : supportedExtensions) {
+                if (strcmp(supported.extensionName, extension) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
         bool checkDeviceExtensionsSupported(VkPhysicalDevice physDevice) {
             uint32_t supportedExtCount;
             vkEnumerateDeviceExtensionProperties(physDevice, nullptr, &supportedExtCount, nullptr);
@@ -320,21 +953,37 @@ class HelloTriangleApplication {
             std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
             vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-            int i = 0;
-            for (const auto& queueFamily : queueFamilies) {
-                if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                    indicies.graphicsFamily = i;
-
-                    VkBool32 presentSupport = false;
-                    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentSupport);
-                    if (presentSupport) {
-                        indicies.presentFamily = i;
+            for (uint32_t i = 0; i < queueFamilyCount; i++) {
+                const VkQueueFlags flags = queueFamilies[i].queueFlags;
+                VkBool32 presentSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentSupport);
+
+                if (flags & VK_QUEUE_GRAPHICS_BIT) {
+                    // Prefer a graphics family that can also present.
+                    if (!indicies.graphicsFamily.has_value() || (presentSupport && indicies.presentFamily != indicies.graphicsFamily)) {
+                        indicies.graphicsFamily = i;
+                        if (presentSupport) {
+                            indicies.presentFamily = i;
+                        }
                     }
+                } else if ((flags & VK_QUEUE_COMPUTE_BIT) && !indicies.computeFamily.has_value()) {
+                    indicies.computeFamily = i;
+                } else if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT) && !indicies.transferFamily.has_value()) {
+                    indicies.transferFamily = i;
                 }
-                if (indicies.isComplete()) {
-                    break;
+
+                if (presentSupport && !indicies.presentFamily.has_value()) {
+                    indicies.presentFamily = i;
+                }
+            }
+
+            if (indicies.graphicsFamily.has_value()) {
+                if (!indicies.computeFamily.has_value()) {
+                    indicies.computeFamily = indicies.graphicsFamily;
+                }
+                if (!indicies.transferFamily.has_value()) {
+                    indicies.transferFamily = indicies.graphicsFamily;
                 }
-                i++;
             }
             return indicies;
         }
@@ -371,10 +1020,11 @@ class HelloTriangleApplication {
 
         VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& presentModes) {
             for (const auto& pMode : presentModes) {
-                if (pMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+                if (pMode == mProfile.presentMode) {
                     return pMode;
                 }
             }
+            std::cout << "Present mode " << presentModeName(mProfile.presentMode) << " not supported, falling back to fifo" << std::endl;
             return VK_PRESENT_MODE_FIFO_KHR;
         }
 
@@ -430,13 +1080,14 @@ class HelloTriangleApplication {
             }
         }
 
-        void createSwapChain() {
+        void createSwapChain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE) {
             SwapChainSupportDetails swapChainDetails = querySwapChainSupport(mPhysicalDevice);
             VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainDetails.formats);
             VkExtent2D extent = chooseSwapExtent(swapChainDetails.capabilities);
             VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainDetails.presentModes);
 
-            uint32_t imageCount = swapChainDetails.capabilities.minImageCount + 1;
+            uint32_t imageCount = mProfile.imageCount > 0 ? mProfile.imageCount : swapChainDetails.capabilities.minImageCount + 1;
+            imageCount = std::max(imageCount, swapChainDetails.capabilities.minImageCount);
             if (swapChainDetails.capabilities.maxImageCount > 0 && imageCount > swapChainDetails.capabilities.maxImageCount) {
                 imageCount = swapChainDetails.capabilities.maxImageCount;
             }
@@ -451,7 +1102,7 @@ class HelloTriangleApplication {
             createInfo.imageArrayLayers = 1;
             createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-            QueueFamilyIndicies indices = findQueueFamilies(mPhysicalDevice);
+            const QueueFamilyIndicies& indices = mQueueFamilies;
             uint32_t queueIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
             if (indices.graphicsFamily != indices.presentFamily) {
                 createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
@@ -467,7 +1118,7 @@ class HelloTriangleApplication {
             createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
             createInfo.presentMode = presentMode;
             createInfo.clipped = VK_TRUE;
-            createInfo.oldSwapchain = VK_NULL_HANDLE;
+            createInfo.oldSwapchain = oldSwapchain;
 
             if (vkCreateSwapchainKHR(mLogicalDevice, &createInfo, nullptr, &mSwapChain) != VK_SUCCESS) {
                 throw std::runtime_error("Failed to create swapchain\n");
@@ -479,6 +1130,7 @@ class HelloTriangleApplication {
 
             mSwapchainExtent = extent;
             mSwapFormat = surfaceFormat.format;
+            mPresentMode = presentMode;
         }
 
         void createSwapChainViews() {
@@ -519,18 +1171,67 @@ class HelloTriangleApplication {
             vkDestroySwapchainKHR(mLogicalDevice, mSwapChain, nullptr);
         }
 
-        void recreateSwapchain() {
+        bool recreateSwapchain() {
+            int width, height;
+            SDL_GetWindowSizeInPixels(gWindow, &width, &height);
+            if (width == 0 || height == 0) {
+                mFramebufferResized = true;
+                return false;
+            }
             std::cout << "recreating swapchain" <<std::endl;
-            vkDeviceWaitIdle(mLogicalDevice);
 
-            cleanupSwapchain();
+            VkSwapchainKHR oldSwapchain = mSwapChain;
+            std::vector<VkImageView> oldViews = std::move(mSwapchainViews);
+            std::vector<VkFramebuffer> oldFramebuffers = std::move(mSwapchainFrameBuffers);
+            DepthTargets oldDepthTargets = std::move(mDepthTargets);
+            mSwapchainViews.clear();
+            mSwapchainFrameBuffers.clear();
 
-            createSwapChain();
+            createSwapChain(oldSwapchain);
             createSwapChainViews();
+            createDepthTargets();
             createFrameBuffers();
+
+            deferDestroy([this, oldSwapchain, oldViews, oldFramebuffers, oldDepthTargets]() {
+                destroyDepthTargets(oldDepthTargets);
+                for (VkFramebuffer framebuffer : oldFramebuffers) {
+                    vkDestroyFramebuffer(mLogicalDevice, framebuffer, nullptr);
+                }
+                for (VkImageView imageView : oldViews) {
+                    vkDestroyImageView(mLogicalDevice, imageView, nullptr);
+                }
+                vkDestroySwapchainKHR(mLogicalDevice, oldSwapchain, nullptr);
+            });
+            return true;
+        }
+
+        void deferDestroy(std::function<void()> destroy) {
+            mDeletionQueue.push_back({mSubmissionCount, std::move(destroy)});
+        }
+
+        void flushDeletionQueue(uint64_t completedSubmission) {
+            while (!mDeletionQueue.empty() && mDeletionQueue.front().submission <= completedSubmission) {
+                mDeletionQueue.front().destroy();
+                mDeletionQueue.pop_front();
+            }
+        }
+
+        VkFormat findDepthFormat() {
+            // Depth-only formats, so the attachment can be sampled by the pyramid build as is.
+            for (VkFormat format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM}) {
+                VkFormatProperties props;
+                vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, format, &props);
+                const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+                if ((props.optimalTilingFeatures & required) == required) {
+                    return format;
+                }
+            }
+            throw std::runtime_error("No sampleable depth format!");
         }
 
         void createRenderPass() {
+            mDepthFormat = findDepthFormat();
+
             VkAttachmentDescription colorAttachment {};
             colorAttachment.format = mSwapFormat;
             colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -541,27 +1242,45 @@ class HelloTriangleApplication {
             colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
             colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
+            // The main pass keeps testing against the prepass depth, after the pyramid build read it.
+            VkAttachmentDescription depthAttachment {};
+            depthAttachment.format = mDepthFormat;
+            depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
             VkAttachmentReference colorRef {};
             colorRef.attachment = 0;
             colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+            VkAttachmentReference depthRef {};
+            depthRef.attachment = 1;
+            depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
             VkSubpassDescription subpass {};
             subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
             subpass.colorAttachmentCount = 1;
             subpass.pColorAttachments = &colorRef;
+            subpass.pDepthStencilAttachment = &depthRef;
 
             VkSubpassDependency dependency{};
             dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-            dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
             dependency.srcAccessMask = 0;
             dependency.dstSubpass = 0;
-            dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+            dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+            std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
             VkRenderPassCreateInfo passCreate {};
             passCreate.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-            passCreate.attachmentCount = 1;
-            passCreate.pAttachments = &colorAttachment;
+            passCreate.attachmentCount = static_cast<uint32_t>(attachments.size());
+            passCreate.pAttachments = attachments.data();
             passCreate.subpassCount = 1;
             passCreate.pSubpasses = &subpass;
             passCreate.dependencyCount = 1;
@@ -570,14 +1289,184 @@ class HelloTriangleApplication {
             if (vkCreateRenderPass(mLogicalDevice, &passCreate, nullptr, &mRenderPass) != VK_SUCCESS) {
                 throw std::runtime_error("Failed to create render pass!");
             }
+
+            // Depth prepass: left readable by the pyramid build.
+            depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            depthRef.attachment = 0;
+
+            VkSubpassDescription prepass {};
+            prepass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            prepass.pDepthStencilAttachment = &depthRef;
+
+            std::array<VkSubpassDependency, 2> prepassDependencies{};
+            prepassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+            prepassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            prepassDependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            prepassDependencies[0].dstSubpass = 0;
+            prepassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+            prepassDependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            prepassDependencies[1].srcSubpass = 0;
+            prepassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            prepassDependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            prepassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+            prepassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            prepassDependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            passCreate.attachmentCount = 1;
+            passCreate.pAttachments = &depthAttachment;
+            passCreate.pSubpasses = &prepass;
+            passCreate.dependencyCount = static_cast<uint32_t>(prepassDependencies.size());
+            passCreate.pDependencies = prepassDependencies.data();
+
+            if (vkCreateRenderPass(mLogicalDevice, &passCreate, nullptr, &mDepthPrepassRenderPass) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create depth prepass render pass!");
+            }
+        }
+
+        void createPipelineCache() {
+            std::vector<char> data;
+            std::ifstream file(PIPELINE_CACHE_FILE, std::ios::binary);
+            if (file) {
+                data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+            // The driver ignores data another device or driver version wrote.
+            VkPipelineCacheCreateInfo cacheInfo{};
+            cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+            cacheInfo.initialDataSize = data.size();
+            cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+            if (vkCreatePipelineCache(mLogicalDevice, &cacheInfo, nullptr, &mPipelineCache) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create pipeline cache!");
+            }
+            printf("pipeline cache: %zu bytes loaded\n", data.size());
+        }
+
+        void savePipelineCache() {
+            size_t size = 0;
+            vkGetPipelineCacheData(mLogicalDevice, mPipelineCache, &size, nullptr);
+            std::vector<char> data(size);
+            if (size == 0 || vkGetPipelineCacheData(mLogicalDevice, mPipelineCache, &size, data.data()) != VK_SUCCESS) {
+                return;
+            }
+            std::ofstream file(PIPELINE_CACHE_FILE, std::ios::binary | std::ios::trunc);
+            file.write(data.data(), static_cast<std::streamsize>(size));
         }
 
         void createGraphicsPipeline() {
-            auto vert = readFile("Shaders/vert.spv");
-            auto frag = readFile("Shaders/frag.spv");
+            VkDescriptorSetLayoutBinding boundsBinding{};
+            boundsBinding.binding = 0;
+            boundsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            boundsBinding.descriptorCount = 1;
+            boundsBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+            VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+            setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            setLayoutInfo.bindingCount = 1;
+            setLayoutInfo.pBindings = &boundsBinding;
+            if (vkCreateDescriptorSetLayout(mLogicalDevice, &setLayoutInfo, nullptr, &mTerrainSetLayout) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create terrain descriptor set layout!");
+            }
+
+            VkPushConstantRange pushRange{};
+            pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+            pushRange.offset = 0;
+            pushRange.size = sizeof(CameraPushConstants);
+
+            VkPipelineLayoutCreateInfo pipelineLayoutCreate {};
+            pipelineLayoutCreate.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pipelineLayoutCreate.setLayoutCount = 1;
+            pipelineLayoutCreate.pSetLayouts = &mTerrainSetLayout;
+            pipelineLayoutCreate.pushConstantRangeCount = 1;
+            pipelineLayoutCreate.pPushConstantRanges = &pushRange;
+
+            if (vkCreatePipelineLayout(mLogicalDevice, &pipelineLayoutCreate, nullptr, &mPipelineLayout) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create pipeline layout!");
+            }
+            if (const char* view = std::getenv("MC_DEBUG_VIEW")) {
+                if (std::strcmp(view, "depth") == 0) {
+                    mDebugView = DEBUG_DEPTH;
+                } else if (std::strcmp(view, "overdraw") == 0) {
+                    mDebugView = DEBUG_OVERDRAW;
+                }
+            }
+            // The variants every frame binds, so the first frame doesn't pay for them.
+            for (auto& variant : buildPipelineVariants({pipelineKey(PASS_OPAQUE, mDebugView), pipelineKey(PASS_DEPTH_PREPASS, DEBUG_NONE)})) {
+                mPipelineVariants.insert(variant);
+            }
+        }
+
+        VkPipeline pipelineVariant(PipelinePass pass, DebugView debugView, bool instanced = false) {
+            const uint32_t key = pipelineKey(pass, debugView, instanced);
+            auto it = mPipelineVariants.find(key);
+            if (it == mPipelineVariants.end()) {
+                it = mPipelineVariants.insert(buildPipelineVariants({key}).front()).first;
+            }
+            return it->second;
+        }
+
+        static std::string pipelineVariantName(uint32_t key) {
+            static constexpr const char* PASSES[] = {"opaque", "cutout", "translucent", "depth-prepass"};
+            static constexpr const char* VIEWS[] = {"", "+depth-view", "+overdraw"};
+            return std::string(PASSES[key & 3]) + VIEWS[(key >> 2) & 3] + ((key & PIPELINE_INSTANCED) != 0 ? "+instanced" : "");
+        }
+
+        // Builds the keyed variants from the current vert, model and frag shaders, which are loaded
+        // once for all of them. Reads nothing that changes after startup, so shader reloads call
+        // it off the main thread.
+        std::vector<std::pair<uint32_t, VkPipeline>> buildPipelineVariants(const std::vector<uint32_t>& keys) {
+            auto vert = loadShader("vert");
+            auto model = loadShader("model");
+            auto frag = loadShader("frag");
 
             VkShaderModule vertShaderMod = createShaderModule(vert);
+            VkShaderModule modelShaderMod = createShaderModule(model);
             VkShaderModule fragShaderMod = createShaderModule(frag);
+            std::vector<std::pair<uint32_t, VkPipeline>> variants;
+            for (uint32_t key : keys) {
+                const uint64_t start = SDL_GetTicksNS();
+                const VkPipeline pipeline = buildPipelineVariant(key, (key & PIPELINE_INSTANCED) != 0 ? modelShaderMod : vertShaderMod, fragShaderMod);
+                if (pipeline == VK_NULL_HANDLE) {
+                    break;
+                }
+                variants.emplace_back(key, pipeline);
+                printf("pipeline variant %s built in %.2f ms\n", pipelineVariantName(key).c_str(),
+                    static_cast<double>(SDL_GetTicksNS() - start) / 1e6);
+            }
+            vkDestroyShaderModule(mLogicalDevice, vertShaderMod, nullptr);
+            vkDestroyShaderModule(mLogicalDevice, modelShaderMod, nullptr);
+            vkDestroyShaderModule(mLogicalDevice, fragShaderMod, nullptr);
+            if (variants.size() != keys.size()) {
+                const std::string name = pipelineVariantName(keys[variants.size()]);
+                for (auto& variant : variants) {
+                    vkDestroyPipeline(mLogicalDevice, variant.second, nullptr);
+                }
+                throw std::runtime_error("Failed to create pipeline variant " + name + "!");
+            }
+            return variants;
+        }
+
+        // VK_NULL_HANDLE if the driver refuses it.
+        VkPipeline buildPipelineVariant(uint32_t key, VkShaderModule vertShaderMod, VkShaderModule fragShaderMod) {
+            const auto pass = static_cast<PipelinePass>(key & 3);
+            const auto debugView = static_cast<DebugView>((key >> 2) & 3);
+
+            // Matches the constant_ids in shader.frag.
+            struct Specialization {
+                int32_t alphaMode;
+                int32_t debugView;
+            };
+            const Specialization specialization{static_cast<int32_t>(pass), static_cast<int32_t>(debugView)};
+            const std::array<VkSpecializationMapEntry, 2> specializationEntries = {{
+                {0, offsetof(Specialization, alphaMode), sizeof(int32_t)},
+                {1, offsetof(Specialization, debugView), sizeof(int32_t)},
+            }};
+            VkSpecializationInfo specializationInfo{};
+            specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+            specializationInfo.pMapEntries = specializationEntries.data();
+            specializationInfo.dataSize = sizeof(specialization);
+            specializationInfo.pData = &specialization;
 
             VkPipelineShaderStageCreateInfo vertShaderStageInfo {};
             vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -590,6 +1479,7 @@ class HelloTriangleApplication {
             fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
             fragShaderStageInfo.module = fragShaderMod;
             fragShaderStageInfo.pName = "main";
+            fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
             VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
@@ -602,12 +1492,21 @@ class HelloTriangleApplication {
             VkPipelineVertexInputStateCreateInfo vertexInput {};
             vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-            auto bindingDescription = Vertex::getBindingDescription();
-            vertexInput.vertexBindingDescriptionCount = 1;
-            vertexInput.pVertexBindingDescriptions = &bindingDescription;
-
-            auto attributeDescriptions = Vertex::getAttributeDescriptions();
-            vertexInput.vertexAttributeDescriptionCount = attributeDescriptions.size();
+            const std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+                Vertex::getBindingDescription(), ModelInstance::getBindingDescription()};
+            std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+            for (const auto& attribute : Vertex::getAttributeDescriptions()) {
+                attributeDescriptions.push_back(attribute);
+            }
+            const bool instanced = (key & PIPELINE_INSTANCED) != 0;
+            if (instanced) {
+                for (const auto& attribute : ModelInstance::getAttributeDescriptions()) {
+                    attributeDescriptions.push_back(attribute);
+                }
+            }
+            vertexInput.vertexBindingDescriptionCount = instanced ? 2 : 1;
+            vertexInput.pVertexBindingDescriptions = bindingDescriptions.data();
+            vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
             vertexInput.pVertexAttributeDescriptions = attributeDescriptions.data();
 
             VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
@@ -615,24 +1514,11 @@ class HelloTriangleApplication {
             inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
             inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-            VkViewport viewport {};
-            viewport.x = 0.0f;
-            viewport.y = 0.0f;
-            viewport.width = static_cast<float>(mSwapchainExtent.width);
-            viewport.height = static_cast<float>(mSwapchainExtent.height);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-
-            VkRect2D scissor {};
-            scissor.offset = {0,0};
-            scissor.extent = mSwapchainExtent;
-
             VkPipelineViewportStateCreateInfo viewportState {};
             viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+            // Both are dynamic.
             viewportState.viewportCount = 1;
-            viewportState.pViewports = &viewport;
             viewportState.scissorCount = 1;
-            viewportState.pScissors = &scissor;
 
             VkPipelineRasterizationStateCreateInfo rasterizer {};
             rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -640,8 +1526,11 @@ class HelloTriangleApplication {
             rasterizer.rasterizerDiscardEnable = VK_FALSE;
             rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
             rasterizer.lineWidth = 1.0f;
-            rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-            rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+            // Cutout geometry (leaves, grass) is seen from both sides.
+            rasterizer.cullMode = pass == PASS_CUTOUT ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+            // Faces are wound counter-clockwise seen from outside (Mesher.cpp), which the y-flipped
+            // projection keeps counter-clockwise in framebuffer space.
+            rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
             rasterizer.depthBiasEnable = VK_FALSE;
 
             VkPipelineMultisampleStateCreateInfo multisampling {};
@@ -652,139 +1541,2028 @@ class HelloTriangleApplication {
             VkPipelineColorBlendAttachmentState colorBlendAttachment {};
             colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
             colorBlendAttachment.blendEnable = VK_FALSE;
+            if (debugView == DEBUG_OVERDRAW) {
+                colorBlendAttachment.blendEnable = VK_TRUE;
+                colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+                colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+                colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+                colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+                colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+                colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+            } else if (pass == PASS_TRANSLUCENT) {
+                colorBlendAttachment.blendEnable = VK_TRUE;
+                colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+                colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+                colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+                colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+                colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+                colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+            }
+
+            VkPipelineDepthStencilStateCreateInfo depthStencil {};
+            depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+            // Overdraw counts every fragment, hidden or not.
+            depthStencil.depthTestEnable = debugView == DEBUG_OVERDRAW ? VK_FALSE : VK_TRUE;
+            depthStencil.depthWriteEnable = pass == PASS_TRANSLUCENT || debugView == DEBUG_OVERDRAW ? VK_FALSE : VK_TRUE;
+            depthStencil.depthCompareOp = pass == PASS_DEPTH_PREPASS ? VK_COMPARE_OP_LESS : VK_COMPARE_OP_LESS_OR_EQUAL;
 
             VkPipelineColorBlendStateCreateInfo colorBlending {};
             colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
             colorBlending.logicOpEnable = VK_FALSE;
-            colorBlending.attachmentCount = 1;
+            // The occlusion prepass writes depth only, from the vertex stage alone.
+            colorBlending.attachmentCount = pass == PASS_DEPTH_PREPASS ? 0 : 1;
             colorBlending.pAttachments = &colorBlendAttachment;
 
-            VkPipelineLayoutCreateInfo pipelineLayoutCreate {};
-            pipelineLayoutCreate.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-            if (vkCreatePipelineLayout(mLogicalDevice, &pipelineLayoutCreate, nullptr, &mPipelineLayout) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to create pipeline layout!");
-            }
-
             VkGraphicsPipelineCreateInfo pipelineCreate {};
             pipelineCreate.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-            pipelineCreate.stageCount = 2;
+            pipelineCreate.stageCount = pass == PASS_DEPTH_PREPASS ? 1 : 2;
             pipelineCreate.pStages = shaderStages;
             pipelineCreate.pVertexInputState = &vertexInput;
             pipelineCreate.pInputAssemblyState = &inputAssembly;
             pipelineCreate.pViewportState = &viewportState;
             pipelineCreate.pRasterizationState = &rasterizer;
             pipelineCreate.pMultisampleState = &multisampling;
+            pipelineCreate.pDepthStencilState = &depthStencil;
             pipelineCreate.pColorBlendState = &colorBlending;
             pipelineCreate.pDynamicState = &dynamicCreateInfo;
             pipelineCreate.layout = mPipelineLayout;
-            pipelineCreate.renderPass = mRenderPass;
+            pipelineCreate.renderPass = pass == PASS_DEPTH_PREPASS ? mDepthPrepassRenderPass : mRenderPass;
             pipelineCreate.subpass = 0;
 
-            if (vkCreateGraphicsPipelines(mLogicalDevice, VK_NULL_HANDLE, 1, &pipelineCreate, nullptr, &mGraphicsPipeline) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to create graphics pipeline!");
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            if (vkCreateGraphicsPipelines(mLogicalDevice, mPipelineCache, 1, &pipelineCreate, nullptr, &pipeline) != VK_SUCCESS) {
+                return VK_NULL_HANDLE;
             }
-
-            vkDestroyShaderModule(mLogicalDevice, vertShaderMod, nullptr);
-            vkDestroyShaderModule(mLogicalDevice, fragShaderMod, nullptr);
+            return pipeline;
         }
 
-        VkShaderModule createShaderModule(const std::vector<char>& bytes) {
-            VkShaderModuleCreateInfo createInfo {};
-            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-            createInfo.codeSize = bytes.size();
-            createInfo.pCode = reinterpret_cast<const uint32_t*>(bytes.data());
-
-            VkShaderModule shaderModule;
-            if (vkCreateShaderModule(mLogicalDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to create shader module");
+        void createDescriptorPool() {
+            std::array<VkDescriptorPoolSize, 3> poolSizes{};
+            poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            poolSizes[0].descriptorCount = 64;
+            poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            poolSizes[1].descriptorCount = 64;
+            poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            poolSizes[2].descriptorCount = 64;
+
+            VkDescriptorPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+            // One set per pyramid level; a resize keeps the old levels alive until retired.
+            poolInfo.maxSets = 64;
+            poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+            poolInfo.pPoolSizes = poolSizes.data();
+
+            if (vkCreateDescriptorPool(mLogicalDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create descriptor pool!");
             }
-            return shaderModule;
         }
 
-        void createFrameBuffers() {
-            mSwapchainFrameBuffers.resize(mSwapchainViews.size());
-
-            for (size_t i = 0; i < mSwapchainViews.size(); i++) {
-                VkImageView attachments[] = {mSwapchainViews[i]};
-                VkFramebufferCreateInfo framebuffer {};
-                framebuffer.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-                framebuffer.renderPass = mRenderPass;
-                framebuffer.attachmentCount = 1;
-                framebuffer.pAttachments = attachments;
-                framebuffer.width = mSwapchainExtent.width;
-                framebuffer.height = mSwapchainExtent.height;
-                framebuffer.layers = 1;
-
-                if (vkCreateFramebuffer(mLogicalDevice, &framebuffer, nullptr, &mSwapchainFrameBuffers[i]) != VK_SUCCESS) {
-                    throw std::runtime_error("Failed to create framebuffer");
-                }
+        VkPipeline createComputePipeline(const std::string& shader, VkPipelineLayout layout) {
+            auto comp = loadShader(shader);
+            VkShaderModule compShaderMod = createShaderModule(comp);
+
+            VkComputePipelineCreateInfo pipelineCreate{};
+            pipelineCreate.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineCreate.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipelineCreate.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipelineCreate.stage.module = compShaderMod;
+            pipelineCreate.stage.pName = "main";
+            pipelineCreate.layout = layout;
+
+            VkPipeline pipeline;
+            const VkResult result = vkCreateComputePipelines(mLogicalDevice, mPipelineCache, 1, &pipelineCreate, nullptr, &pipeline);
+            vkDestroyShaderModule(mLogicalDevice, compShaderMod, nullptr);
+            if (result != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create compute pipeline: " + shader);
             }
+            return pipeline;
         }
 
-        void createCommandPool() {
-            QueueFamilyIndicies queueFamilyIndices = findQueueFamilies(mPhysicalDevice);
+        void createMesherPipeline() {
+            std::array<VkDescriptorSetLayoutBinding, 8> bindings{};
+            for (uint32_t i = 0; i < bindings.size(); i++) {
+                bindings[i].binding = i;
+                bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                bindings[i].descriptorCount = 1;
+                bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            }
 
-            VkCommandPoolCreateInfo poolInfo {};
-            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-            poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-            poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+            VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+            setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            setLayoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+            setLayoutInfo.pBindings = bindings.data();
+            if (vkCreateDescriptorSetLayout(mLogicalDevice, &setLayoutInfo, nullptr, &mMesherSetLayout) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create mesher descriptor set layout!");
+            }
 
-            if (vkCreateCommandPool(mLogicalDevice, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to create command pool!");
+            VkPushConstantRange pushRange{};
+            pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            pushRange.offset = 0;
+            pushRange.size = sizeof(MesherParams);
+
+            VkPipelineLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            layoutInfo.setLayoutCount = 1;
+            layoutInfo.pSetLayouts = &mMesherSetLayout;
+            layoutInfo.pushConstantRangeCount = 1;
+            layoutInfo.pPushConstantRanges = &pushRange;
+            if (vkCreatePipelineLayout(mLogicalDevice, &layoutInfo, nullptr, &mMesherPipelineLayout) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create mesher pipeline layout!");
             }
-        }
 
-        void createVertexBuffer() {
-            VkBufferCreateInfo createInfo{};
-            createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-            createInfo.size = sizeof(mVertices[0]) * mVertices.size();
-            createInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            mMesherPipeline = createComputePipeline("mesher", mMesherPipelineLayout);
+        }
 
-            if (vkCreateBuffer(mLogicalDevice, &createInfo, nullptr, &mVertexBuffer) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to create vertex buffer!");
+        // MC_CULLING=gpu|cpu picks Hi-Z or software occlusion; both share the frustum test in cull.comp.
+        void createCullingPipelines() {
+            if (const char* mode = std::getenv("MC_CULLING")) {
+                mCpuOcclusion = std::strcmp(mode, "cpu") == 0;
+            }
+            printf("occlusion culling: %s\n", mCpuOcclusion ? "software" : "Hi-Z");
+
+            VkSamplerCreateInfo samplerInfo{};
+            samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+            samplerInfo.magFilter = VK_FILTER_NEAREST;
+            samplerInfo.minFilter = VK_FILTER_NEAREST;
+            samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+            samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+            if (vkCreateSampler(mLogicalDevice, &samplerInfo, nullptr, &mHizSampler) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create Hi-Z sampler!");
             }
 
-            VkMemoryRequirements memReqs;
-            vkGetBufferMemoryRequirements(mLogicalDevice, mVertexBuffer, &memReqs);
+            std::array<VkDescriptorSetLayoutBinding, 2> hizBindings{};
+            hizBindings[0].binding = 0;
+            hizBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            hizBindings[0].descriptorCount = 1;
+            hizBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            hizBindings[1].binding = 1;
+            hizBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            hizBindings[1].descriptorCount = 1;
+            hizBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+            std::array<VkDescriptorSetLayoutBinding, 6> cullBindings{};
+            for (uint32_t i = 0; i < cullBindings.size(); i++) {
+                cullBindings[i].binding = i;
+                cullBindings[i].descriptorType = i == 5 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                cullBindings[i].descriptorCount = 1;
+                cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            }
 
-            VkMemoryAllocateInfo allocInfo{};
-            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-            allocInfo.allocationSize = memReqs.size;
-            allocInfo.memoryTypeIndex = findMemReqs(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+            setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            setLayoutInfo.bindingCount = static_cast<uint32_t>(hizBindings.size());
+            setLayoutInfo.pBindings = hizBindings.data();
+            if (vkCreateDescriptorSetLayout(mLogicalDevice, &setLayoutInfo, nullptr, &mHizSetLayout) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create Hi-Z descriptor set layout!");
+            }
+            setLayoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+            setLayoutInfo.pBindings = cullBindings.data();
+            if (vkCreateDescriptorSetLayout(mLogicalDevice, &setLayoutInfo, nullptr, &mCullSetLayout) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create cull descriptor set layout!");
+            }
 
-            if (vkAllocateMemory(mLogicalDevice, &allocInfo, nullptr, &mDeviceMemory) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to alloc memory!");
+            VkPushConstantRange pushRange{};
+            pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            pushRange.offset = 0;
+            pushRange.size = sizeof(HizParams);
+
+            VkPipelineLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            layoutInfo.setLayoutCount = 1;
+            layoutInfo.pSetLayouts = &mHizSetLayout;
+            layoutInfo.pushConstantRangeCount = 1;
+            layoutInfo.pPushConstantRanges = &pushRange;
+            if (vkCreatePipelineLayout(mLogicalDevice, &layoutInfo, nullptr, &mHizPipelineLayout) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create Hi-Z pipeline layout!");
+            }
+            pushRange.size = sizeof(CullParams);
+            layoutInfo.pSetLayouts = &mCullSetLayout;
+            if (vkCreatePipelineLayout(mLogicalDevice, &layoutInfo, nullptr, &mCullPipelineLayout) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create cull pipeline layout!");
             }
 
-            vkBindBufferMemory(mLogicalDevice, mVertexBuffer, mDeviceMemory, 0);
-            void* data;
-            vkMapMemory(mLogicalDevice, mDeviceMemory, 0, createInfo.size, 0, &data);
-            memcpy(data, mVertices.data(), createInfo.size);
-            vkUnmapMemory(mLogicalDevice, mDeviceMemory);
+            mHizPipeline = createComputePipeline("hiz", mHizPipelineLayout);
+            mCullPipeline = createComputePipeline("cull", mCullPipelineLayout);
         }
 
-        uint32_t findMemReqs(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-            VkPhysicalDeviceMemoryProperties physMemProps;
-            vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &physMemProps);
-
-            for (uint32_t i = 0; i < physMemProps.memoryTypeCount; i++) {
-                if ((typeFilter & (1 << i)) && (physMemProps.memoryTypes[i].propertyFlags & properties) == properties) {
-                    return i; //help
-                }
+        void watchShaders() {
+            const char* env = std::getenv("MC_SHADER_RELOAD");
+            if (env == nullptr || std::strcmp(env, "0") == 0) {
+                return;
             }
-            throw std::runtime_error("failed to find suitable memory type!");
+            mShaderWatcher = std::make_unique<ShaderWatcher>("Shaders");
+            printf("shader reload: watching Shaders/ (%s)\n", mShaderWatcher->usesInotify() ? "inotify" : "polling");
         }
 
-        void createCommandBuffers() {
-            mCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-
-            VkCommandBufferAllocateInfo allocInfo{};
+        static uint32_t pipelinesUsing(const std::string& file) {
+            if (file == "vert.spv" || file == "model.spv" || file == "frag.spv") {
+                return SHADERS_GRAPHICS;
+            }
+            if (file == "mesher.spv") {
+                return SHADERS_MESHER;
+            }
+            if (file == "hiz.spv") {
+                return SHADERS_HIZ;
+            }
+            if (file == "cull.spv") {
+                return SHADERS_CULL;
+            }
+            return 0;
+        }
+
+        // Runs on the reload thread. Layouts and render passes never change, so only the
+        // pipelines themselves are rebuilt.
+        ShaderReload buildShaderPipelines(uint32_t pipelines, const std::vector<uint32_t>& variantKeys) {
+            const uint64_t start = SDL_GetTicksNS();
+            ShaderReload reload;
+            reload.pipelines = pipelines;
+            try {
+                if ((pipelines & SHADERS_GRAPHICS) != 0) {
+                    reload.variants = buildPipelineVariants(variantKeys);
+                }
+                if ((pipelines & SHADERS_MESHER) != 0) {
+                    reload.mesher = createComputePipeline("mesher", mMesherPipelineLayout);
+                }
+                if ((pipelines & SHADERS_HIZ) != 0) {
+                    reload.hiz = createComputePipeline("hiz", mHizPipelineLayout);
+                }
+                if ((pipelines & SHADERS_CULL) != 0) {
+                    reload.cull = createComputePipeline("cull", mCullPipelineLayout);
+                }
+            } catch (const std::exception& error) {
+                destroyShaderReload(reload);
+                reload.error = error.what();
+            }
+            reload.ms = static_cast<double>(SDL_GetTicksNS() - start) / 1e6;
+            return reload;
+        }
+
+        void destroyShaderReload(ShaderReload& reload) {
+            for (auto& variant : reload.variants) {
+                vkDestroyPipeline(mLogicalDevice, variant.second, nullptr);
+            }
+            reload.variants.clear();
+            for (VkPipeline* pipeline : {&reload.mesher, &reload.hiz, &reload.cull}) {
+                vkDestroyPipeline(mLogicalDevice, *pipeline, nullptr);
+                *pipeline = VK_NULL_HANDLE;
+            }
+        }
+
+        // Called at the start of a frame, once its fence has signalled and before anything is
+        // recorded, so a finished rebuild can be swapped in without touching in-flight frames.
+        void updateShaderReload() {
+            if (mShaderWatcher == nullptr) {
+                return;
+            }
+            const uint64_t now = SDL_GetTicksNS();
+            for (const std::string& file : mShaderWatcher->poll(now)) {
+                if (const uint32_t pipelines = pipelinesUsing(file)) {
+                    mChangedShaders |= pipelines;
+                    mShaderChangeNs = now;
+                }
+            }
+            if (mShaderReload.valid()) {
+                if (mShaderReload.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    return;
+                }
+                swapShaderPipelines(mShaderReload.get());
+            }
+            if (mChangedShaders != 0 && now - mShaderChangeNs >= SHADER_SETTLE_NS) {
+                // Variants first built while this runs are built from the new files anyway.
+                std::vector<uint32_t> variantKeys;
+                for (const auto& variant : mPipelineVariants) {
+                    variantKeys.push_back(variant.first);
+                }
+                mShaderReload = std::async(std::launch::async, [this, pipelines = mChangedShaders, variantKeys = std::move(variantKeys)]() {
+                    return buildShaderPipelines(pipelines, variantKeys);
+                });
+                mChangedShaders = 0;
+            }
+        }
+
+        void swapShaderPipelines(const ShaderReload& reload) {
+            if (!reload.error.empty()) {
+                printf("shader reload failed, keeping the running pipelines: %s\n", reload.error.c_str());
+                return;
+            }
+            auto retire = [this](VkPipeline& current, VkPipeline replacement) {
+                deferDestroy([this, old = current]() { vkDestroyPipeline(mLogicalDevice, old, nullptr); });
+                current = replacement;
+            };
+            if ((reload.pipelines & SHADERS_GRAPHICS) != 0) {
+                for (const auto& variant : reload.variants) {
+                    retire(mPipelineVariants[variant.first], variant.second);
+                }
+            }
+            if ((reload.pipelines & SHADERS_MESHER) != 0) {
+                // Mesh batches retire by their own fence rather than the frame count, so the
+                // pipeline a batch in flight was recorded with is released along with it.
+                if (mMeshBatch.has_value() && mMeshBatch->retiredPipeline == VK_NULL_HANDLE) {
+                    mMeshBatch->retiredPipeline = mMesherPipeline;
+                    mMesherPipeline = reload.mesher;
+                } else {
+                    retire(mMesherPipeline, reload.mesher);
+                }
+            }
+            if ((reload.pipelines & SHADERS_HIZ) != 0) {
+                retire(mHizPipeline, reload.hiz);
+            }
+            if ((reload.pipelines & SHADERS_CULL) != 0) {
+                retire(mCullPipeline, reload.cull);
+            }
+            printf("shader reload: %s%s%s%s rebuilt in %.1f ms\n",
+                (reload.pipelines & SHADERS_GRAPHICS) != 0 ? " terrain" : "", (reload.pipelines & SHADERS_MESHER) != 0 ? " mesher" : "",
+                (reload.pipelines & SHADERS_HIZ) != 0 ? " hiz" : "", (reload.pipelines & SHADERS_CULL) != 0 ? " cull" : "", reload.ms);
+        }
+
+        // The SPIR-V embedded at build time. Under MC_SHADER_RELOAD, Shaders/<name>.spv is loaded
+        // instead when it exists, so rebuilt shaders take effect without a restart.
+        std::vector<char> loadShader(const std::string& name) const {
+            const std::string path = "Shaders/" + name + ".spv";
+            if (mShaderWatcher != nullptr && std::ifstream(path).is_open()) {
+                auto bytes = readFile(path);
+                checkSpirv(bytes, path);
+                return bytes;
+            }
+            for (const EmbeddedSpirv& shader : EMBEDDED_SHADERS) {
+                if (name == shader.name) {
+                    const auto* bytes = reinterpret_cast<const char*>(shader.words);
+                    return std::vector<char>(bytes, bytes + shader.count * sizeof(uint32_t));
+                }
+            }
+            throw std::runtime_error("No embedded shader named " + name);
+        }
+
+        // Drivers aren't required to survive malformed SPIR-V, and a reload can catch a file
+        // half-written.
+        static void checkSpirv(const std::vector<char>& bytes, const std::string& path) {
+            constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+            uint32_t magic = 0;
+            if (bytes.size() >= 20 && bytes.size() % 4 == 0) {
+                memcpy(&magic, bytes.data(), sizeof(magic));
+            }
+            if (magic != SPIRV_MAGIC) {
+                throw std::runtime_error("Not a SPIR-V module: " + path);
+            }
+        }
+
+        VkShaderModule createShaderModule(const std::vector<char>& bytes) {
+            VkShaderModuleCreateInfo createInfo {};
+            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            createInfo.codeSize = bytes.size();
+            createInfo.pCode = reinterpret_cast<const uint32_t*>(bytes.data());
+
+            VkShaderModule shaderModule;
+            if (vkCreateShaderModule(mLogicalDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create shader module");
+            }
+            return shaderModule;
+        }
+
+        void createFrameBuffers() {
+            mSwapchainFrameBuffers.resize(mSwapchainViews.size());
+
+            for (size_t i = 0; i < mSwapchainViews.size(); i++) {
+                VkImageView attachments[] = {mSwapchainViews[i], mDepthTargets.depthView};
+                VkFramebufferCreateInfo framebuffer {};
+                framebuffer.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+                framebuffer.renderPass = mRenderPass;
+                framebuffer.attachmentCount = 2;
+                framebuffer.pAttachments = attachments;
+                framebuffer.width = mSwapchainExtent.width;
+                framebuffer.height = mSwapchainExtent.height;
+                framebuffer.layers = 1;
+
+                if (vkCreateFramebuffer(mLogicalDevice, &framebuffer, nullptr, &mSwapchainFrameBuffers[i]) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to create framebuffer");
+                }
+            }
+        }
+
+        void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage,
+                         VkImage& image, VkDeviceMemory& memory) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent = {width, height, 1};
+            imageInfo.mipLevels = mipLevels;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = usage;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if (vkCreateImage(mLogicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create image!");
+            }
+
+            VkMemoryRequirements memReqs;
+            vkGetImageMemoryRequirements(mLogicalDevice, image, &memReqs);
+
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = memReqs.size;
+            allocInfo.memoryTypeIndex = findMemReqs(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            if (vkAllocateMemory(mLogicalDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to alloc image memory!");
+            }
+            vkBindImageMemory(mLogicalDevice, image, memory, 0);
+        }
+
+        VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t baseMip, uint32_t levelCount) {
+            VkImageViewCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            createInfo.image = image;
+            createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            createInfo.format = format;
+            createInfo.subresourceRange.aspectMask = aspect;
+            createInfo.subresourceRange.baseMipLevel = baseMip;
+            createInfo.subresourceRange.levelCount = levelCount;
+            createInfo.subresourceRange.baseArrayLayer = 0;
+            createInfo.subresourceRange.layerCount = 1;
+
+            VkImageView view;
+            if (vkCreateImageView(mLogicalDevice, &createInfo, nullptr, &view) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create image view!");
+            }
+            return view;
+        }
+
+        // Depth attachment, prepass framebuffer and depth pyramid for the current swapchain extent.
+        void createDepthTargets() {
+            DepthTargets& targets = mDepthTargets;
+            targets = {};
+            createImage(mSwapchainExtent.width, mSwapchainExtent.height, 1, mDepthFormat,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, targets.depthImage, targets.depthMemory);
+            targets.depthView = createImageView(targets.depthImage, mDepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1);
+
+            VkFramebufferCreateInfo framebuffer {};
+            framebuffer.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebuffer.renderPass = mDepthPrepassRenderPass;
+            framebuffer.attachmentCount = 1;
+            framebuffer.pAttachments = &targets.depthView;
+            framebuffer.width = mSwapchainExtent.width;
+            framebuffer.height = mSwapchainExtent.height;
+            framebuffer.layers = 1;
+            if (vkCreateFramebuffer(mLogicalDevice, &framebuffer, nullptr, &targets.prepassFramebuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create prepass framebuffer");
+            }
+
+            // Level 0 is half the attachment, rounded up, down to a single texel.
+            VkExtent2D extent = mSwapchainExtent;
+            do {
+                extent = {(extent.width + 1) / 2, (extent.height + 1) / 2};
+                targets.pyramidLevelExtents.push_back(extent);
+            } while (extent.width > 1 || extent.height > 1);
+            const auto levels = static_cast<uint32_t>(targets.pyramidLevelExtents.size());
+
+            createImage(targets.pyramidLevelExtents[0].width, targets.pyramidLevelExtents[0].height, levels, VK_FORMAT_R32_SFLOAT,
+                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, targets.pyramidImage, targets.pyramidMemory);
+            targets.pyramidView = createImageView(targets.pyramidImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, levels);
+            for (uint32_t level = 0; level < levels; level++) {
+                targets.pyramidLevelViews.push_back(createImageView(targets.pyramidImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level, 1));
+            }
+
+            std::vector<VkDescriptorSetLayout> setLayouts(levels, mHizSetLayout);
+            setLayouts.push_back(mCullSetLayout);
+            std::vector<VkDescriptorSet> sets(setLayouts.size());
+            VkDescriptorSetAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = mDescriptorPool;
+            allocInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+            allocInfo.pSetLayouts = setLayouts.data();
+            if (vkAllocateDescriptorSets(mLogicalDevice, &allocInfo, sets.data()) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate culling descriptor sets!");
+            }
+            targets.cullSet = sets.back();
+            sets.pop_back();
+            targets.hizSets = std::move(sets);
+
+            std::vector<VkDescriptorImageInfo> imageInfos(levels * 2 + 1);
+            std::vector<VkWriteDescriptorSet> writes;
+            for (uint32_t level = 0; level < levels; level++) {
+                VkDescriptorImageInfo& src = imageInfos[level * 2];
+                src.sampler = mHizSampler;
+                src.imageView = level == 0 ? targets.depthView : targets.pyramidLevelViews[level - 1];
+                src.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+                VkDescriptorImageInfo& dst = imageInfos[level * 2 + 1];
+                dst.imageView = targets.pyramidLevelViews[level];
+                dst.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+                VkWriteDescriptorSet write{};
+                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.dstSet = targets.hizSets[level];
+                write.descriptorCount = 1;
+                write.dstBinding = 0;
+                write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                write.pImageInfo = &src;
+                writes.push_back(write);
+                write.dstBinding = 1;
+                write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                write.pImageInfo = &dst;
+                writes.push_back(write);
+            }
+
+            const GpuBuffer* cullBuffers[] = {&mCullCandidates, &mSectionBounds, &mSectionDrawCommands, &mVisibleDraws, &mCullCounters};
+            std::array<VkDescriptorBufferInfo, 5> bufferInfos{};
+            for (uint32_t i = 0; i < bufferInfos.size(); i++) {
+                bufferInfos[i].buffer = cullBuffers[i]->buffer;
+                bufferInfos[i].offset = 0;
+                bufferInfos[i].range = VK_WHOLE_SIZE;
+
+                VkWriteDescriptorSet write{};
+                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.dstSet = targets.cullSet;
+                write.dstBinding = i;
+                write.descriptorCount = 1;
+                write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                write.pBufferInfo = &bufferInfos[i];
+                writes.push_back(write);
+            }
+            VkDescriptorImageInfo& pyramid = imageInfos.back();
+            pyramid.sampler = mHizSampler;
+            pyramid.imageView = targets.pyramidView;
+            pyramid.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            VkWriteDescriptorSet pyramidWrite{};
+            pyramidWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            pyramidWrite.dstSet = targets.cullSet;
+            pyramidWrite.dstBinding = 5;
+            pyramidWrite.descriptorCount = 1;
+            pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            pyramidWrite.pImageInfo = &pyramid;
+            writes.push_back(pyramidWrite);
+
+            vkUpdateDescriptorSets(mLogicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+
+        void destroyDepthTargets(const DepthTargets& targets) {
+            std::vector<VkDescriptorSet> sets = targets.hizSets;
+            sets.push_back(targets.cullSet);
+            vkFreeDescriptorSets(mLogicalDevice, mDescriptorPool, static_cast<uint32_t>(sets.size()), sets.data());
+            for (VkImageView view : targets.pyramidLevelViews) {
+                vkDestroyImageView(mLogicalDevice, view, nullptr);
+            }
+            vkDestroyImageView(mLogicalDevice, targets.pyramidView, nullptr);
+            vkDestroyImage(mLogicalDevice, targets.pyramidImage, nullptr);
+            vkFreeMemory(mLogicalDevice, targets.pyramidMemory, nullptr);
+            vkDestroyFramebuffer(mLogicalDevice, targets.prepassFramebuffer, nullptr);
+            vkDestroyImageView(mLogicalDevice, targets.depthView, nullptr);
+            vkDestroyImage(mLogicalDevice, targets.depthImage, nullptr);
+            vkFreeMemory(mLogicalDevice, targets.depthMemory, nullptr);
+        }
+
+        void createCommandPool() {
+            VkCommandPoolCreateInfo poolInfo {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            poolInfo.queueFamilyIndex = mQueueFamilies.graphicsFamily.value();
+
+            if (vkCreateCommandPool(mLogicalDevice, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create command pool!");
+            }
+
+            poolInfo.queueFamilyIndex = mQueueFamilies.computeFamily.value();
+            if (vkCreateCommandPool(mLogicalDevice, &poolInfo, nullptr, &mComputeCommandPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create compute command pool!");
+            }
+
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            poolInfo.queueFamilyIndex = mQueueFamilies.transferFamily.value();
+            if (vkCreateCommandPool(mLogicalDevice, &poolInfo, nullptr, &mTransferCommandPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create transfer command pool!");
+            }
+        }
+
+        void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory,
+                          bool sharedWithCompute = false) {
+            VkBufferCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            createInfo.size = size;
+            createInfo.usage = usage;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            // Long-lived buffers written by compute and read by graphics every frame are shared
+            // concurrently instead of ping-ponging ownership.
+            uint32_t families[] = {mQueueFamilies.graphicsFamily.value(), mQueueFamilies.computeFamily.value()};
+            if (sharedWithCompute && families[0] != families[1]) {
+                createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+                createInfo.queueFamilyIndexCount = 2;
+                createInfo.pQueueFamilyIndices = families;
+            }
+
+            if (vkCreateBuffer(mLogicalDevice, &createInfo, nullptr, &buffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create buffer!");
+            }
+
+            VkMemoryRequirements memReqs;
+            vkGetBufferMemoryRequirements(mLogicalDevice, buffer, &memReqs);
+
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = memReqs.size;
+            allocInfo.memoryTypeIndex = findMemReqs(memReqs.memoryTypeBits, properties);
+
+            if (vkAllocateMemory(mLogicalDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to alloc memory!");
+            }
+            vkBindBufferMemory(mLogicalDevice, buffer, memory, 0);
+        }
+
+        void createBuffer(GpuBuffer& out, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                          bool sharedWithCompute = false) {
+            createBuffer(size, usage, properties, out.buffer, out.memory, sharedWithCompute);
+            out.size = size;
+            if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+                vkMapMemory(mLogicalDevice, out.memory, 0, size, 0, &out.mapped);
+            }
+        }
+
+        void destroyBuffer(GpuBuffer& buffer) {
+            if (buffer.mapped != nullptr) {
+                vkUnmapMemory(mLogicalDevice, buffer.memory);
+            }
+            vkDestroyBuffer(mLogicalDevice, buffer.buffer, nullptr);
+            vkFreeMemory(mLogicalDevice, buffer.memory, nullptr);
+            buffer = {};
+        }
+
+        // Copies data into a device-local buffer on the transfer queue without waiting for it,
+        // unless the staging ring is full of earlier uploads.
+        // When the transfer family is dedicated, the copy releases the buffer and the next
+        // submission by owner acquires it (see takePendingAcquires).
+        void uploadBuffer(VkBuffer dst, const void* data, VkDeviceSize size, BufferOwner owner,
+                          VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, VkDeviceSize dstOffset = 0) {
+            const uint32_t dstFamily = owner == BufferOwner::Compute ? mQueueFamilies.computeFamily.value() : mQueueFamilies.graphicsFamily.value();
+            const VkDeviceSize stagingOffset = reserveUploadStaging(size);
+            InFlightUpload upload = takeUpload();
+            upload.stagingOffset = stagingOffset;
+            memcpy(static_cast<char*>(mUploadStaging.mapped) + stagingOffset, data, size);
+            mUploadHead = stagingOffset + size;
+
+            // The pool resets the command buffer when it's begun again.
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(upload.commandBuffer, &beginInfo);
+
+            VkBufferCopy region{};
+            region.srcOffset = stagingOffset;
+            region.dstOffset = dstOffset;
+            region.size = size;
+            vkCmdCopyBuffer(upload.commandBuffer, mUploadStaging.buffer, dst, 1, &region);
+
+            const uint32_t transferFamily = mQueueFamilies.transferFamily.value();
+            VkBufferMemoryBarrier release{};
+            release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            release.dstAccessMask = 0;
+            release.srcQueueFamilyIndex = transferFamily != dstFamily ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+            release.dstQueueFamilyIndex = transferFamily != dstFamily ? dstFamily : VK_QUEUE_FAMILY_IGNORED;
+            release.buffer = dst;
+            release.offset = dstOffset;
+            release.size = size;
+            vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0, 0, nullptr, 1, &release, 0, nullptr);
+
+            if (vkEndCommandBuffer(upload.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to record transfer command buffer");
+            }
+
+            PendingAcquire acquire{dst, dstOffset, size, takeSemaphore(), dstStage, dstAccess};
+
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &upload.commandBuffer;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &acquire.transferDone;
+            if (vkQueueSubmit(mTransferQueue, 1, &submitInfo, upload.fence) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to submit transfer");
+            }
+
+            mInFlightUploads.push_back(upload);
+            if (owner == BufferOwner::Compute) {
+                mPendingComputeAcquires.push_back(acquire);
+            } else {
+                mPendingGraphicsAcquires.push_back(acquire);
+            }
+        }
+
+        void createUploadStaging() {
+            static_assert(UPLOAD_STAGING_BYTES >= sizeof(uint32_t) * Section::VOLUME * MAX_MESH_BATCH_ENTRIES,
+                "a mesh batch's blocks must fit the upload staging ring");
+            createBuffer(mUploadStaging, UPLOAD_STAGING_BYTES, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+
+        // Finds size contiguous bytes of mUploadStaging after the newest upload's, waiting for the
+        // oldest uploads to retire while the ring is full.
+        VkDeviceSize reserveUploadStaging(VkDeviceSize size) {
+            if (size > UPLOAD_STAGING_BYTES) {
+                throw std::runtime_error("upload larger than the staging ring");
+            }
+            while (!mInFlightUploads.empty()) {
+                const VkDeviceSize tail = mInFlightUploads.front().stagingOffset;
+                // The head never catches up with the tail, so head == tail only when the ring is empty.
+                if (mUploadHead >= tail) {
+                    if (mUploadHead + size <= UPLOAD_STAGING_BYTES) {
+                        return mUploadHead;
+                    }
+                    if (size < tail) {
+                        return 0;
+                    }
+                } else if (mUploadHead + size < tail) {
+                    return mUploadHead;
+                }
+                vkWaitForFences(mLogicalDevice, 1, &mInFlightUploads.front().fence, VK_TRUE, UINT64_MAX);
+                collectFinishedUploads(false);
+            }
+            mUploadHead = 0;
+            return 0;
+        }
+
+        InFlightUpload takeUpload() {
+            if (!mIdleUploads.empty()) {
+                InFlightUpload upload = mIdleUploads.back();
+                mIdleUploads.pop_back();
+                return upload;
+            }
+            InFlightUpload upload{};
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = mTransferCommandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(mLogicalDevice, &allocInfo, &upload.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate transfer command buffer");
+            }
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(mLogicalDevice, &fenceInfo, nullptr, &upload.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload fence!");
+            }
+            return upload;
+        }
+
+        VkSemaphore takeSemaphore() {
+            if (!mIdleSemaphores.empty()) {
+                VkSemaphore semaphore = mIdleSemaphores.back();
+                mIdleSemaphores.pop_back();
+                return semaphore;
+            }
+            VkSemaphore semaphore;
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            if (vkCreateSemaphore(mLogicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create semaphore!");
+            }
+            return semaphore;
+        }
+
+        void createTerrainBuffers() {
+            const VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            const VkBufferUsageFlags input = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+            createBuffer(mMeshBlocks, sizeof(uint32_t) * Section::VOLUME * MAX_MESH_BATCH_ENTRIES, input, deviceLocal);
+            createBuffer(mMeshNeighbors, sizeof(int32_t) * FACE_COUNT * MAX_MESH_BATCH_SECTIONS, input, deviceLocal);
+            createBuffer(mMeshSlots, sizeof(uint32_t) * MAX_MESH_BATCH_SECTIONS, input, deviceLocal);
+            createBuffer(mMeshFaceCounts, sizeof(uint32_t) * MAX_MESH_BATCH_SECTIONS, input, hostVisible);
+            createBuffer(mMeshFirstVertices, sizeof(uint32_t) * MAX_MESH_BATCH_SECTIONS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+
+            createBuffer(mBlockTable, sizeof(glm::vec4) * BLOCK_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+            auto* table = static_cast<glm::vec4*>(mBlockTable.mapped);
+            for (BlockId id = 0; id < BLOCK_COUNT; id++) {
+                const BlockInfo& info = blockInfo(id);
+                table[id] = glm::vec4(info.color[0], info.color[1], info.color[2], info.opaque ? 1.0f : 0.0f);
+            }
+
+            createBuffer(mSectionDrawCommands, sizeof(VkDrawIndirectCommand) * MAX_SECTION_DRAWS,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                deviceLocal, true);
+            createBuffer(mTerrainArena, TERRAIN_ARENA_BYTES,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                deviceLocal, true);
+            createBuffer(mLodStaging, LOD_STAGING_BYTES * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostVisible);
+            mFullResArena.reset(GPU_MESH_ARENA_VERTICES);
+            mLodArena.reset(static_cast<uint32_t>(LOD_ARENA_BYTES / sizeof(MeshVertex)));
+
+            VkDescriptorSetAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = mDescriptorPool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &mMesherSetLayout;
+            if (vkAllocateDescriptorSets(mLogicalDevice, &allocInfo, &mMesherSet) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate mesher descriptor set!");
+            }
+
+            const GpuBuffer* bound[] = {&mMeshBlocks, &mMeshNeighbors, &mMeshSlots, &mMeshFaceCounts,
+                &mSectionDrawCommands, &mTerrainArena, &mMeshFirstVertices, &mBlockTable};
+            std::array<VkDescriptorBufferInfo, 8> bufferInfos{};
+            std::array<VkWriteDescriptorSet, 8> writes{};
+            for (uint32_t i = 0; i < writes.size(); i++) {
+                bufferInfos[i].buffer = bound[i]->buffer;
+                bufferInfos[i].offset = 0;
+                bufferInfos[i].range = VK_WHOLE_SIZE;
+
+                writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[i].dstSet = mMesherSet;
+                writes[i].dstBinding = i;
+                writes[i].descriptorCount = 1;
+                writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                writes[i].pBufferInfo = &bufferInfos[i];
+            }
+            vkUpdateDescriptorSets(mLogicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+            mValidateMesher = std::getenv("MC_VALIDATE_MESHER") != nullptr;
+        }
+
+        void createCullingBuffers() {
+            const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            createBuffer(mSectionBounds, sizeof(SectionBounds) * MAX_SECTION_DRAWS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+            // One candidate list per frame in flight, indexed by mCurrentFrame.
+            createBuffer(mCullCandidates, sizeof(uint32_t) * MAX_SECTION_DRAWS * MAX_FRAMES_IN_FLIGHT,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+            createBuffer(mVisibleDraws, sizeof(VkDrawIndirectCommand) * MAX_SECTION_DRAWS,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            createBuffer(mCullCounters, sizeof(CullCounters),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            createBuffer(mCullReadback, sizeof(CullCounters) * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible);
+
+            VkDescriptorSetAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = mDescriptorPool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &mTerrainSetLayout;
+            if (vkAllocateDescriptorSets(mLogicalDevice, &allocInfo, &mTerrainSet) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate terrain descriptor set!");
+            }
+            VkDescriptorBufferInfo boundsInfo{mSectionBounds.buffer, 0, VK_WHOLE_SIZE};
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = mTerrainSet;
+            write.dstBinding = 0;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.pBufferInfo = &boundsInfo;
+            vkUpdateDescriptorSets(mLogicalDevice, 1, &write, 0, nullptr);
+
+            // The first prepass draws "last frame's" visible list, so it has to start out empty.
+            std::vector<VkDrawIndirectCommand> noDraws(MAX_SECTION_DRAWS);
+            CullCounters noCounters{};
+            uploadBuffer(mVisibleDraws.buffer, noDraws.data(), mVisibleDraws.size, BufferOwner::Graphics,
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+            uploadBuffer(mCullCounters.buffer, &noCounters, sizeof(noCounters), BufferOwner::Graphics,
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+        }
+
+        void createModelBuffers() {
+            std::vector<MeshVertex> vertices;
+            for (uint32_t mesh = 0; mesh < MODEL_MESH_COUNT; mesh++) {
+                std::vector<MeshVertex> built = buildModelMesh(static_cast<ModelMesh>(mesh));
+                mModelDraws[mesh].firstVertex = static_cast<uint32_t>(vertices.size());
+                mModelDraws[mesh].vertexCount = static_cast<uint32_t>(built.size());
+                vertices.insert(vertices.end(), built.begin(), built.end());
+            }
+            const VkDeviceSize size = sizeof(MeshVertex) * vertices.size();
+            createBuffer(mModelVertices, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            uploadBuffer(mModelVertices.buffer, vertices.data(), size, BufferOwner::Graphics,
+                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+            createBuffer(mModelInstances, sizeof(ModelInstance) * MAX_MODEL_INSTANCES * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+
+        // Records the acquire half of each pending ownership transfer into commandBuffer and
+        // returns the semaphores the submission has to wait on.
+        std::vector<VkSemaphore> takePendingAcquires(std::vector<PendingAcquire>& pending, VkCommandBuffer commandBuffer,
+                                                     uint32_t family, std::vector<VkPipelineStageFlags>& waitStages) {
+            std::vector<VkSemaphore> semaphores;
+            std::vector<VkBufferMemoryBarrier> barriers;
+            VkPipelineStageFlags dstStages = 0;
+            const uint32_t transferFamily = mQueueFamilies.transferFamily.value();
+            for (const PendingAcquire& acquire : pending) {
+                semaphores.push_back(acquire.transferDone);
+                waitStages.push_back(acquire.dstStage);
+                if (acquire.buffer == VK_NULL_HANDLE) {
+                    continue;
+                }
+                VkBufferMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = acquire.dstAccess;
+                barrier.srcQueueFamilyIndex = transferFamily != family ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = transferFamily != family ? family : VK_QUEUE_FAMILY_IGNORED;
+                barrier.buffer = acquire.buffer;
+                barrier.offset = acquire.offset;
+                barrier.size = acquire.size;
+                barriers.push_back(barrier);
+                dstStages |= acquire.dstStage;
+            }
+            if (!barriers.empty()) {
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages,
+                    0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+            }
+            pending.clear();
+            return semaphores;
+        }
+
+        // Stops at the first unfinished upload, so staging space is only ever freed from the tail.
+        void collectFinishedUploads(bool wait) {
+            while (!mInFlightUploads.empty()) {
+                InFlightUpload& upload = mInFlightUploads.front();
+                if (wait) {
+                    vkWaitForFences(mLogicalDevice, 1, &upload.fence, VK_TRUE, UINT64_MAX);
+                } else if (vkGetFenceStatus(mLogicalDevice, upload.fence) != VK_SUCCESS) {
+                    break;
+                }
+                vkResetFences(mLogicalDevice, 1, &upload.fence);
+                mIdleUploads.push_back(upload);
+                mInFlightUploads.pop_front();
+            }
+            if (mInFlightUploads.empty()) {
+                mUploadHead = 0;
+            }
+        }
+
+        uint32_t findMemReqs(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+            VkPhysicalDeviceMemoryProperties physMemProps;
+            vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &physMemProps);
+
+            for (uint32_t i = 0; i < physMemProps.memoryTypeCount; i++) {
+                if ((typeFilter & (1 << i)) && (physMemProps.memoryTypes[i].propertyFlags & properties) == properties) {
+                    return i; //help
+                }
+            }
+            throw std::runtime_error("failed to find suitable memory type!");
+        }
+
+        void setupWorld() {
+            if (const char* env = std::getenv("MC_VIEW_RADIUS")) {
+                mViewRadius = std::max(1, std::atoi(env));
+            }
+            if (const char* env = std::getenv("MC_CAVE_CULLING")) {
+                mCaveCulling = std::strcmp(env, "0") != 0;
+            }
+            if (const char* env = std::getenv("MC_LOD_DISTANCE")) {
+                mLodDistance = std::max(1.0f, static_cast<float>(std::atof(env)));
+            }
+            if (const char* env = std::getenv("MC_COLUMN_CACHE_MB")) {
+                mColumnCache.setBudget(static_cast<size_t>(std::max(0, std::atoi(env))) << 20);
+            }
+            if (const char* env = std::getenv("MC_AUTOSAVE")) {
+                const double seconds = std::atof(env);
+                if (seconds > 0.0) {
+                    mAutosaveIntervalNs = static_cast<uint64_t>(seconds * 1e9);
+                    mSaver = std::make_unique<WorldSaver>("world");
+                }
+            }
+            mStreamer.setRadius(mViewRadius);
+            mStreamer.setCache(&mColumnCache);
+            mCamera.position = glm::vec3(8.0f, static_cast<float>(mTerrain.surfaceHeight(8, 8) + 2), 8.0f);
+            mCamera.pitch = -0.3f;
+            if (const char* env = std::getenv("MC_MODELS")) {
+                spawnModels(static_cast<uint32_t>(std::max(0, std::atoi(env))));
+            }
+        }
+
+        void updateCamera() {
+            const uint64_t now = SDL_GetTicksNS();
+            const float dt = mCameraUpdateNs == 0 ? 0.0f : std::min(0.1f, static_cast<float>(now - mCameraUpdateNs) / 1e9f);
+            mCameraUpdateNs = now;
+
+            const bool* keys = SDL_GetKeyboardState(nullptr);
+            auto axis = [keys](int positive, int negative) {
+                return (keys[positive] ? 1.0f : 0.0f) - (keys[negative] ? 1.0f : 0.0f);
+            };
+            mCamera.yaw += axis(SDL_SCANCODE_RIGHT, SDL_SCANCODE_LEFT) * CAMERA_TURN_SPEED * dt;
+            mCamera.pitch = std::clamp(mCamera.pitch + axis(SDL_SCANCODE_UP, SDL_SCANCODE_DOWN) * CAMERA_TURN_SPEED * dt, -1.55f, 1.55f);
+            const glm::vec3 walk = glm::normalize(glm::vec3(mCamera.forward().x, 0.0f, mCamera.forward().z));
+            mCamera.position += (walk * axis(SDL_SCANCODE_W, SDL_SCANCODE_S) + mCamera.right() * axis(SDL_SCANCODE_D, SDL_SCANCODE_A) +
+                glm::vec3(0.0f, axis(SDL_SCANCODE_SPACE, SDL_SCANCODE_LSHIFT), 0.0f)) * (CAMERA_SPEED * dt);
+
+            const float aspect = static_cast<float>(mSwapchainExtent.width) / static_cast<float>(std::max(1u, mSwapchainExtent.height));
+            mViewProj = mCamera.viewProjection(aspect);
+            const glm::vec3 block = glm::floor(mCamera.position);
+            mCameraPush.viewProj = mCamera.relativeViewProjection(aspect);
+            mCameraPush.cameraBlock = glm::ivec4(static_cast<int>(block.x), static_cast<int>(block.y), static_cast<int>(block.z), 0);
+            mCameraPush.cameraFraction = glm::vec4(mCamera.position - block, 0.0f);
+        }
+
+        // Called once this frame's fence has signalled, so its part of mModelInstances is free.
+        void updateModels() {
+            const uint64_t now = SDL_GetTicksNS();
+            const float dt = mModelUpdateNs == 0 ? 0.0f : std::min(0.1f, static_cast<float>(now - mModelUpdateNs) / 1e9f);
+            mModelUpdateNs = now;
+
+            // Counted and filled over the same query, so an entity with a Model but no Position
+            // can't hold a slot that is never written. Meshes out of range are skipped.
+            std::array<uint32_t, MODEL_MESH_COUNT> counts{};
+            mEntities.each<Position, Model>([&](size_t count, Position*, Model* models) {
+                for (size_t i = 0; i < count; i++) {
+                    models[i].yaw += models[i].spin * dt;
+                    if (models[i].mesh < MODEL_MESH_COUNT) {
+                        counts[models[i].mesh]++;
+                    }
+                }
+            });
+            // Counting sort: each mesh's instances end up contiguous without sorting entities.
+            const uint32_t frameBase = mCurrentFrame * MAX_MODEL_INSTANCES;
+            std::array<uint32_t, MODEL_MESH_COUNT> next{};
+            std::array<uint32_t, MODEL_MESH_COUNT> end{};
+            uint32_t total = 0;
+            for (uint32_t mesh = 0; mesh < MODEL_MESH_COUNT; mesh++) {
+                mModelDraws[mesh].firstInstance = frameBase + total;
+                next[mesh] = total;
+                total += std::min(counts[mesh], MAX_MODEL_INSTANCES - total);
+                end[mesh] = total;
+            }
+
+            auto* instances = static_cast<ModelInstance*>(mModelInstances.mapped) + frameBase;
+            const glm::vec3 camera = mCamera.position;
+            mEntities.each<Position, Model>([&](size_t count, Position* positions, Model* models) {
+                for (size_t i = 0; i < count; i++) {
+                    const Model& model = models[i];
+                    if (model.mesh >= MODEL_MESH_COUNT || next[model.mesh] >= end[model.mesh]) {
+                        continue;
+                    }
+                    instances[next[model.mesh]++] = {
+                        glm::vec4(positions[i].x - camera.x, positions[i].y - camera.y, positions[i].z - camera.z, model.yaw),
+                        glm::vec4(model.tint[0], model.tint[1], model.tint[2], model.scale)};
+                }
+            });
+            // What was actually written, which is all that gets drawn.
+            for (uint32_t mesh = 0; mesh < MODEL_MESH_COUNT; mesh++) {
+                mModelDraws[mesh].instanceCount = frameBase + next[mesh] - mModelDraws[mesh].firstInstance;
+            }
+        }
+
+        void drawModels(VkCommandBuffer commandBuffer) {
+            bool any = false;
+            for (const ModelDraw& draw : mModelDraws) {
+                any = any || draw.instanceCount > 0;
+            }
+            if (!any) {
+                return;
+            }
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineVariant(PASS_OPAQUE, mDebugView, true));
+            bindCamera(commandBuffer);
+            VkBuffer buffers[] = {mModelVertices.buffer, mModelInstances.buffer};
+            VkDeviceSize offsets[] = {0, 0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+            for (const ModelDraw& draw : mModelDraws) {
+                if (draw.instanceCount > 0) {
+                    vkCmdDraw(commandBuffer, draw.vertexCount, draw.instanceCount, draw.firstVertex, draw.firstInstance);
+                }
+            }
+        }
+
+        // Binds what the terrain pipelines read besides vertices; call after binding one of them.
+        void bindCamera(VkCommandBuffer commandBuffer) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &mTerrainSet, 0, nullptr);
+            vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mCameraPush), &mCameraPush);
+        }
+
+        void pushDrawOrigin(VkCommandBuffer commandBuffer, const glm::ivec4& origin) {
+            vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(CameraPushConstants, drawOrigin),
+                sizeof(origin), &origin);
+        }
+
+        // Scatters count models over the terrain around the spawn point, mostly foliage.
+        void spawnModels(uint32_t count) {
+            std::mt19937 rng(static_cast<uint32_t>(WORLD_SEED));
+            const float spread = static_cast<float>(mViewRadius * Section::SIZE);
+            std::uniform_real_distribution<float> offset(-spread, spread);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            for (uint32_t i = 0; i < count; i++) {
+                const float x = mCamera.position.x + offset(rng);
+                const float z = mCamera.position.z + offset(rng);
+                const float y = static_cast<float>(mTerrain.surfaceHeight(static_cast<int32_t>(std::floor(x)), static_cast<int32_t>(std::floor(z))) + 1);
+                const float roll = unit(rng);
+                Model model{};
+                model.yaw = unit(rng) * 6.2831853f;
+                model.scale = 1.0f;
+                if (roll < 0.7f) {
+                    model.mesh = MODEL_FOLIAGE;
+                    model.scale = 0.6f + 0.6f * unit(rng);
+                    model.tint[0] = 0.2f;
+                    model.tint[1] = 0.5f + 0.3f * unit(rng);
+                    model.tint[2] = 0.15f;
+                } else if (roll < 0.9f) {
+                    model.mesh = MODEL_ITEM_DROP;
+                    model.spin = 1.5f;
+                    model.tint[0] = unit(rng);
+                    model.tint[1] = unit(rng);
+                    model.tint[2] = unit(rng);
+                } else {
+                    model.mesh = MODEL_MOB;
+                    model.tint[0] = 0.4f;
+                    model.tint[1] = 0.6f;
+                    model.tint[2] = 0.3f;
+                }
+                mEntities.create(Position{x, y, z}, model);
+            }
+            if (count > 0) {
+                pipelineVariant(PASS_OPAQUE, mDebugView, true);
+            }
+            printf("models: %u spawned, %u mesh draws at most\n", count, static_cast<uint32_t>(MODEL_MESH_COUNT));
+        }
+
+        void updateStreaming() {
+            const ChunkStreamer::Stats stats = mStreamer.update(mCamera.position.x, mCamera.position.z, mCamera.forward().x, mCamera.forward().z,
+                [this](ColumnPos pos) { mColumnLods[pos]; },
+                [this](ColumnPos pos) { return releaseColumn(pos); });
+            mStreamTotals += stats;
+            mStreamFrames++;
+
+            const uint64_t now = SDL_GetTicksNS();
+            if (mStreamReportNs == 0) {
+                mStreamReportNs = now;
+            }
+            const double seconds = static_cast<double>(now - mStreamReportNs) / 1e9;
+            if (seconds < 1.0) {
+                return;
+            }
+            const ChunkStreamer::Stats& totals = mStreamTotals;
+            if (totals.generated + totals.meshed + totals.unloaded + totals.cancelled > 0 || !mStreamer.idle()) {
+                const auto frames = static_cast<double>(mStreamFrames);
+                printf("streaming: queued %zu generate, %zu mesh, %zu unload | %.1f loaded/s (%zu from cache), %.1f meshed/s, %.1f unloaded/s, %zu cancelled | %.2f + %.2f + %.2f ms/frame, %zu columns loaded\n",
+                    totals.generateQueue, totals.meshQueue, totals.unloadQueue,
+                    static_cast<double>(totals.generated) / seconds, totals.cached, static_cast<double>(totals.meshed) / seconds,
+                    static_cast<double>(totals.unloaded) / seconds, totals.cancelled,
+                    totals.generateMs / frames, totals.meshMs / frames, totals.unloadMs / frames, mWorld.columnCount());
+                const ColumnCache::Stats& cache = mColumnCache.stats();
+                printf("column cache: %.1f MiB in %zu entries, %.0f%% column hits, %.0f%% LOD mesh hits, %zu evictions\n",
+                    static_cast<double>(cache.bytes) / (1 << 20), cache.entries, 100.0 * cache.blockHitRate(),
+                    100.0 * cache.meshHitRate(), cache.evictions);
+            }
+            mStreamTotals = {};
+            mStreamFrames = 0;
+            mStreamReportNs = now;
+        }
+
+        void reportAutosave() {
+            if (mSaver->completedSaves() == mReportedSaves) {
+                return;
+            }
+            mReportedSaves = mSaver->completedSaves();
+            const WorldSaver::SaveStats stats = mSaver->lastSave();
+            printf("autosave: %zu columns into %zu regions (%.1f MiB), snapshot %.2f ms, written in %.1f ms\n",
+                stats.columns, stats.regions, static_cast<double>(stats.bytes) / (1 << 20), stats.snapshotMs, stats.writeMs);
+        }
+
+        void autosave() {
+            if (mSaver == nullptr) {
+                return;
+            }
+            reportAutosave();
+            const uint64_t now = SDL_GetTicksNS();
+            if (mLastAutosaveNs == 0) {
+                mLastAutosaveNs = now;
+            }
+            if (now - mLastAutosaveNs >= mAutosaveIntervalNs && mSaver->save(mWorld)) {
+                mLastAutosaveNs = now;
+            }
+        }
+
+        // Drops everything the renderer holds for a column the streamer is unloading. Slots and
+        // arena space are recycled once the frames drawing them finish. Refused while a mesh
+        // batch writes the column's slots.
+        bool releaseColumn(ColumnPos pos) {
+            if (mMeshBatch.has_value()) {
+                for (const SectionPos& section : mMeshBatch->sections) {
+                    if (section.x == pos.x && section.z == pos.z) {
+                        return false;
+                    }
+                }
+            }
+            auto it = mColumnLods.find(pos);
+            if (it == mColumnLods.end()) {
+                return true;
+            }
+            std::vector<uint32_t> slots = it->second.fullResSlots;
+            std::vector<std::pair<uint32_t, uint32_t>> fullResRanges = it->second.fullResRanges;
+            std::vector<std::pair<uint32_t, uint32_t>> ranges;
+            for (const LodMesh& mesh : it->second.meshes) {
+                if (mesh.built) {
+                    slots.insert(slots.end(), mesh.slots.begin(), mesh.slots.end());
+                    ranges.emplace_back(mesh.firstVertex, mesh.vertexCount);
+                }
+            }
+            for (uint32_t slot : slots) {
+                mSlotActive[slot] = 0;
+            }
+            deferDestroy([this, slots, fullResRanges, ranges]() {
+                for (const auto& [first, count] : fullResRanges) {
+                    mFullResArena.free(first, count);
+                }
+                for (const auto& [first, count] : ranges) {
+                    if (count > 0) {
+                        mLodArena.free(first - GPU_MESH_ARENA_VERTICES, count);
+                    }
+                }
+                mFreeSlots.insert(mFreeSlots.end(), slots.begin(), slots.end());
+            });
+            mColumnLods.erase(it);
+            // Otherwise a reload of the column before they're popped would mesh them against its
+            // new ColumnLod twice over.
+            mMeshQueue.erase(std::remove_if(mMeshQueue.begin(), mMeshQueue.end(),
+                [pos](const SectionPos& section) { return section.x == pos.x && section.z == pos.z; }), mMeshQueue.end());
+
+            for (int sy = 0; sy < Column::SECTIONS; sy++) {
+                mVisibilityGraph.erase({pos.x, sy, pos.z});
+            }
+            size_t kept = 0;
+            for (size_t i = 0; i < mOccluders.size(); i++) {
+                if (mOccluderColumns[i] != pos) {
+                    mOccluders[kept] = mOccluders[i];
+                    mOccluderColumns[kept] = mOccluderColumns[i];
+                    kept++;
+                }
+            }
+            mOccluders.resize(kept);
+            mOccluderColumns.resize(kept);
+            mReachableFrom.reset();
+            return true;
+        }
+
+        [[nodiscard]] size_t freeSlotCount() const {
+            return mFreeSlots.size() + (MAX_SECTION_DRAWS - mSectionSlots.size());
+        }
+
+        // Released slots are reused before new ones are appended.
+        uint32_t allocateSlot(SectionPos pos) {
+            uint32_t slot;
+            if (!mFreeSlots.empty()) {
+                slot = mFreeSlots.back();
+                mFreeSlots.pop_back();
+                mSectionSlots[slot] = pos;
+            } else {
+                slot = static_cast<uint32_t>(mSectionSlots.size());
+                mSectionSlots.push_back(pos);
+                mSlotBounds.emplace_back();
+                mSlotActive.push_back(0);
+            }
+            const SectionBounds bounds{glm::ivec4(pos.x * Section::SIZE, pos.y * Section::SIZE, pos.z * Section::SIZE, 0)};
+            static_cast<SectionBounds*>(mSectionBounds.mapped)[slot] = bounds;
+            mSlotBounds[slot] = bounds;
+            mSlotActive[slot] = 0;
+            mDrawnSectionSlots = static_cast<uint32_t>(mSectionSlots.size());
+            mReachableFrom.reset();
+            return slot;
+        }
+
+        // Picks every column's level, queues full-resolution meshing or builds LOD meshes for the
+        // nearest columns that need them, then switches the columns whose target level is ready.
+        void updateLod() {
+            mLodStagingUsed = 0;
+            mLodVertexCopies.clear();
+            mLodDrawCopies.clear();
+
+            const float cameraX = mCamera.position.x / Section::SIZE;
+            const float cameraZ = mCamera.position.z / Section::SIZE;
+            std::vector<std::pair<float, ColumnPos>> fullRes;
+            std::vector<std::pair<float, ColumnPos>> builds;
+            for (auto& [pos, column] : mColumnLods) {
+                const float dx = static_cast<float>(pos.x) + 0.5f - cameraX;
+                const float dz = static_cast<float>(pos.z) + 0.5f - cameraZ;
+                const float distance = std::sqrt(dx * dx + dz * dz);
+                column.target = selectLod(column.target, distance, mLodDistance, LOD_HYSTERESIS);
+                if (column.target == 0 && !column.fullResQueued) {
+                    fullRes.emplace_back(distance, pos);
+                } else if (column.target > 0 && !column.meshes[column.target].built) {
+                    builds.emplace_back(distance, pos);
+                }
+            }
+
+            auto nearer = [](const auto& a, const auto& b) { return a.first < b.first; };
+            std::sort(fullRes.begin(), fullRes.end(), nearer);
+            for (const auto& [distance, pos] : fullRes) {
+                queueFullRes(pos, mColumnLods[pos]);
+            }
+            if (builds.size() > MAX_LOD_BUILDS_PER_FRAME) {
+                std::partial_sort(builds.begin(), builds.begin() + MAX_LOD_BUILDS_PER_FRAME, builds.end(), nearer);
+                builds.resize(MAX_LOD_BUILDS_PER_FRAME);
+            }
+            buildLodMeshes(builds);
+
+            for (auto& [pos, column] : mColumnLods) {
+                if (column.target != column.displayed && lodReady(column, column.target)) {
+                    displayLod(column, column.target);
+                }
+            }
+        }
+
+        void queueFullRes(ColumnPos pos, ColumnLod& column) {
+            column.fullResQueued = true;
+            const Column* data = mWorld.column(pos);
+            for (int sy = Column::SECTIONS - 1; sy >= 0; sy--) {
+                if (!data->section(sy).isEmpty()) {
+                    mMeshQueue.push_back({pos.x, sy, pos.z});
+                    column.fullResPending++;
+                }
+            }
+        }
+
+        static bool lodReady(const ColumnLod& column, int lod) {
+            return lod == 0 ? column.fullResQueued && column.fullResPending == 0 : column.meshes[lod].built;
+        }
+
+        void buildLodMeshes(const std::vector<std::pair<float, ColumnPos>>& builds) {
+            std::vector<int> levels;
+            for (const auto& build : builds) {
+                levels.push_back(mColumnLods[build.second].target);
+            }
+            std::vector<std::shared_ptr<const LodColumnMesh>> meshes(builds.size());
+            std::vector<std::shared_ptr<LodColumnMesh>> built(builds.size());
+            for (size_t i = 0; i < builds.size(); i++) {
+                meshes[i] = mColumnCache.mesh(builds[i].second, levels[i]);
+                if (meshes[i] == nullptr) {
+                    built[i] = std::make_shared<LodColumnMesh>();
+                    meshes[i] = built[i];
+                }
+            }
+            mJobs.parallelFor(builds.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    if (built[i] != nullptr) {
+                        meshLodColumn(mWorld, builds[i].second, levels[i], *built[i]);
+                    }
+                }
+            });
+            for (size_t i = 0; i < builds.size(); i++) {
+                if (built[i] != nullptr) {
+                    mColumnCache.putMesh(builds[i].second, levels[i], built[i]);
+                }
+            }
+            // Whatever doesn't fit this frame's staging is staged again next frame.
+            for (size_t i = 0; i < builds.size(); i++) {
+                if (!stageLodMesh(builds[i].second, levels[i], *meshes[i])) {
+                    break;
+                }
+            }
+        }
+
+        // Allocates arena space and slots for a built mesh and stages its vertices and draw commands.
+        bool stageLodMesh(ColumnPos pos, int lod, const LodColumnMesh& mesh) {
+            const auto vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+            uint32_t sections = 0;
+            for (int sy = 0; sy < Column::SECTIONS; sy++) {
+                sections += mesh.sectionOffsets[sy + 1] > mesh.sectionOffsets[sy] ? 1 : 0;
+            }
+            const VkDeviceSize vertexBytes = vertexCount * sizeof(MeshVertex);
+            if (mLodStagingUsed + vertexBytes + sections * sizeof(VkDrawIndirectCommand) > LOD_STAGING_BYTES ||
+                freeSlotCount() < sections) {
+                return false;
+            }
+            uint32_t first = 0;
+            if (vertexCount > 0) {
+                std::optional<uint32_t> range = mLodArena.allocate(vertexCount);
+                if (!range.has_value()) {
+                    return false;
+                }
+                first = GPU_MESH_ARENA_VERTICES + range.value();
+            }
+
+            LodMesh& out = mColumnLods[pos].meshes[lod];
+            out.built = true;
+            out.firstVertex = first;
+            out.vertexCount = vertexCount;
+            const VkDeviceSize frameBase = mCurrentFrame * LOD_STAGING_BYTES;
+            char* staging = static_cast<char*>(mLodStaging.mapped) + frameBase;
+            if (vertexCount > 0) {
+                memcpy(staging + mLodStagingUsed, mesh.vertices.data(), vertexBytes);
+                mLodVertexCopies.push_back({frameBase + mLodStagingUsed, static_cast<VkDeviceSize>(first) * sizeof(MeshVertex), vertexBytes});
+                mLodStagingUsed += vertexBytes;
+            }
+            for (int sy = 0; sy < Column::SECTIONS; sy++) {
+                const uint32_t count = mesh.sectionOffsets[sy + 1] - mesh.sectionOffsets[sy];
+                if (count == 0) {
+                    continue;
+                }
+                const uint32_t slot = allocateSlot({pos.x, sy, pos.z});
+                out.slots.push_back(slot);
+                const VkDrawIndirectCommand draw{count, 1, first + mesh.sectionOffsets[sy], 0};
+                memcpy(staging + mLodStagingUsed, &draw, sizeof(draw));
+                mLodDrawCopies.push_back({frameBase + mLodStagingUsed, slot * sizeof(VkDrawIndirectCommand), sizeof(draw)});
+                mLodStagingUsed += sizeof(draw);
+            }
+            return true;
+        }
+
+        void displayLod(ColumnLod& column, int lod) {
+            auto setActive = [this](const std::vector<uint32_t>& slots, uint8_t active) {
+                for (uint32_t slot : slots) {
+                    mSlotActive[slot] = active;
+                }
+            };
+            if (column.displayed >= 0) {
+                setActive(column.displayed == 0 ? column.fullResSlots : column.meshes[column.displayed].slots, 0);
+            }
+            setActive(lod == 0 ? column.fullResSlots : column.meshes[lod].slots, 1);
+            column.displayed = lod;
+
+            // Full-resolution meshes stay until the column unloads, so it can switch back without
+            // remeshing; LOD meshes that are no longer shown go back to the allocator once the
+            // frames drawing them have finished.
+            for (int level = 1; level < LOD_LEVELS; level++) {
+                LodMesh& mesh = column.meshes[level];
+                if (level == lod || !mesh.built) {
+                    continue;
+                }
+                deferDestroy([this, first = mesh.firstVertex, count = mesh.vertexCount, slots = mesh.slots]() {
+                    if (count > 0) {
+                        mLodArena.free(first - GPU_MESH_ARENA_VERTICES, count);
+                    }
+                    mFreeSlots.insert(mFreeSlots.end(), slots.begin(), slots.end());
+                });
+                mesh = {};
+            }
+        }
+
+        void recordLodUploads(VkCommandBuffer commandBuffer) {
+            if (mLodVertexCopies.empty() && mLodDrawCopies.empty()) {
+                return;
+            }
+            if (!mLodVertexCopies.empty()) {
+                vkCmdCopyBuffer(commandBuffer, mLodStaging.buffer, mTerrainArena.buffer,
+                    static_cast<uint32_t>(mLodVertexCopies.size()), mLodVertexCopies.data());
+            }
+            if (!mLodDrawCopies.empty()) {
+                vkCmdCopyBuffer(commandBuffer, mLodStaging.buffer, mSectionDrawCommands.buffer,
+                    static_cast<uint32_t>(mLodDrawCopies.size()), mLodDrawCopies.data());
+            }
+            memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        }
+
+        bool isSolidSection(SectionPos pos) const {
+            const Section* section = mWorld.section(pos);
+            return section != nullptr && section->isUniform() && isOpaque(section->palette()[0]);
+        }
+
+        // A uniform opaque section enclosed by uniform opaque neighbours has no visible faces.
+        bool isBuried(SectionPos pos) const {
+            if (!isSolidSection(pos)) {
+                return false;
+            }
+            for (const auto& offset : FACE_OFFSETS) {
+                if (!isSolidSection({pos.x + offset[0], pos.y + offset[1], pos.z + offset[2]})) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Faces of a solid section that don't touch another solid section.
+        void addOccluderFaces(SectionPos pos) {
+            const float origin[3] = {static_cast<float>(pos.x * Section::SIZE), static_cast<float>(pos.y * Section::SIZE),
+                                     static_cast<float>(pos.z * Section::SIZE)};
+            for (int face = 0; face < FACE_COUNT; face++) {
+                const int* offset = FACE_OFFSETS[face];
+                if (!isSolidSection({pos.x + offset[0], pos.y + offset[1], pos.z + offset[2]})) {
+                    mOccluders.push_back(OcclusionRasterizer::cubeFace(origin, Section::SIZE, face / 2, (face & 1) != 0));
+                    mOccluderColumns.push_back({pos.x, pos.z});
+                }
+            }
+        }
+
+        static void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                                   VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   VkAccessFlags dstAccess = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT) {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = dstAccess;
+            vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        void pumpMesher() {
+            if (mMeshBatch.has_value() && vkGetFenceStatus(mLogicalDevice, mMeshBatch->fence) == VK_SUCCESS) {
+                if (mMeshBatch->emitting) {
+                    finishMeshBatch();
+                } else {
+                    submitMeshEmit();
+                }
+            }
+            if (!mMeshBatch.has_value() && !mMeshQueue.empty()) {
+                submitMeshBatch();
+            }
+        }
+
+        // Packs up to MAX_MESH_BATCH_SECTIONS queued sections, plus the neighbours their border
+        // faces depend on, and counts their faces on the compute queue.
+        void submitMeshBatch() {
+            MeshBatch batch;
+            std::unordered_map<SectionPos, int32_t, SectionPosHash> entries;
+            auto appendEntry = [&](SectionPos pos, const Section& section) {
+                auto entry = static_cast<int32_t>(entries.size());
+                batch.blocks.resize(batch.blocks.size() + Section::VOLUME);
+                section.decode(batch.blocks.data() + static_cast<size_t>(entry) * Section::VOLUME);
+                entries[pos] = entry;
+                return entry;
+            };
+
+            while (!mMeshQueue.empty() && batch.sections.size() < MAX_MESH_BATCH_SECTIONS && freeSlotCount() > 0) {
+                SectionPos pos = mMeshQueue.front();
+                mMeshQueue.pop_front();
+                // releaseColumn() drops a column's queued sections along with it.
+                ColumnLod& column = mColumnLods.at({pos.x, pos.z});
+                const Section* section = mWorld.section(pos);
+                if (section == nullptr || section->isEmpty() || isBuried(pos)) {
+                    column.fullResPending--;
+                    continue;
+                }
+                appendEntry(pos, *section);
+                const uint32_t slot = allocateSlot(pos);
+                column.fullResSlots.push_back(slot);
+                if (isSolidSection(pos)) {
+                    addOccluderFaces(pos);
+                }
+                batch.sections.push_back(pos);
+                batch.slots.push_back(slot);
+            }
+            if (batch.sections.empty()) {
+                return;
+            }
+
+            // Batch sections were appended first, so section i is entry i.
+            std::vector<uint16_t> connectivity(batch.sections.size());
+            mJobs.parallelFor(batch.sections.size(), 8, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    connectivity[i] = computeConnectivity(batch.blocks.data() + i * Section::VOLUME);
+                }
+            });
+            for (size_t i = 0; i < batch.sections.size(); i++) {
+                mVisibilityGraph.setConnectivity(batch.sections[i], connectivity[i]);
+            }
+            mReachableFrom.reset();
+
+            batch.neighbors.assign(batch.sections.size() * FACE_COUNT, -1);
+            for (size_t i = 0; i < batch.sections.size(); i++) {
+                for (int face = 0; face < FACE_COUNT; face++) {
+                    const SectionPos& pos = batch.sections[i];
+                    SectionPos neighbor{pos.x + FACE_OFFSETS[face][0], pos.y + FACE_OFFSETS[face][1], pos.z + FACE_OFFSETS[face][2]};
+                    auto it = entries.find(neighbor);
+                    if (it != entries.end()) {
+                        batch.neighbors[i * FACE_COUNT + face] = it->second;
+                    } else if (const Section* section = mWorld.section(neighbor); section != nullptr && !section->isEmpty()) {
+                        batch.neighbors[i * FACE_COUNT + face] = appendEntry(neighbor, *section);
+                    }
+                }
+            }
+
+            const auto sectionCount = static_cast<uint32_t>(batch.sections.size());
+            uploadBuffer(mMeshBlocks.buffer, batch.blocks.data(), batch.blocks.size() * sizeof(uint32_t), BufferOwner::Compute,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            uploadBuffer(mMeshNeighbors.buffer, batch.neighbors.data(), batch.neighbors.size() * sizeof(int32_t), BufferOwner::Compute,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            uploadBuffer(mMeshSlots.buffer, batch.slots.data(), batch.slots.size() * sizeof(uint32_t), BufferOwner::Compute,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = mComputeCommandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(mLogicalDevice, &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate mesher command buffer");
+            }
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(mLogicalDevice, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create mesher fence!");
+            }
+            batch.pipeline = mMesherPipeline;
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+            std::vector<VkPipelineStageFlags> waitStages;
+            batch.uploadSemaphores = takePendingAcquires(mPendingComputeAcquires, batch.commandBuffer,
+                mQueueFamilies.computeFamily.value(), waitStages);
+
+            vkCmdFillBuffer(batch.commandBuffer, mMeshFaceCounts.buffer, 0, sizeof(uint32_t) * sectionCount, 0);
+            memoryBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+            recordMesherPass(batch, 0);
+            memoryBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+
+            if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to record mesher command buffer");
+            }
+
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.waitSemaphoreCount = static_cast<uint32_t>(batch.uploadSemaphores.size());
+            submitInfo.pWaitSemaphores = batch.uploadSemaphores.data();
+            submitInfo.pWaitDstStageMask = waitStages.data();
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &batch.commandBuffer;
+            if (vkQueueSubmit(mComputeQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to submit mesher");
+            }
+            mMeshBatch = std::move(batch);
+        }
+
+        void recordMesherPass(const MeshBatch& batch, uint32_t pass) {
+            const auto sectionCount = static_cast<uint32_t>(batch.sections.size());
+            const MesherParams params{pass, sectionCount};
+            vkCmdBindPipeline(batch.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, batch.pipeline);
+            vkCmdBindDescriptorSets(batch.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mMesherPipelineLayout, 0, 1, &mMesherSet, 0, nullptr);
+            vkCmdPushConstants(batch.commandBuffer, mMesherPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+            vkCmdDispatch(batch.commandBuffer, pass == 1 ? (sectionCount + 63) / 64 : sectionCount * Section::VOLUME / 64, 1, 1);
+        }
+
+        // The face counts are back: gives every section its range of mFullResArena and emits the
+        // vertices there.
+        void submitMeshEmit() {
+            MeshBatch& batch = mMeshBatch.value();
+            auto* faceCounts = static_cast<uint32_t*>(mMeshFaceCounts.mapped);
+            auto* firstVertices = static_cast<uint32_t*>(mMeshFirstVertices.mapped);
+            for (size_t i = 0; i < batch.sections.size(); i++) {
+                const uint32_t vertexCount = faceCounts[i] * VERTICES_PER_QUAD;
+                firstVertices[i] = 0;
+                if (vertexCount == 0) {
+                    continue;
+                }
+                const std::optional<uint32_t> range = mFullResArena.allocate(vertexCount);
+                if (!range.has_value()) {
+                    // Drawn with zero instances; emits nothing.
+                    faceCounts[i] = 0;
+                    firstVertices[i] = NO_RANGE;
+                    batch.overflowed++;
+                    continue;
+                }
+                firstVertices[i] = range.value();
+                const SectionPos& pos = batch.sections[i];
+                mColumnLods[{pos.x, pos.z}].fullResRanges.emplace_back(range.value(), vertexCount);
+            }
+
+            vkResetFences(mLogicalDevice, 1, &batch.fence);
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+            recordMesherPass(batch, 1);
+            memoryBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+            recordMesherPass(batch, 2);
+            memoryBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+            if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to record mesher command buffer");
+            }
+
+            const VkSemaphore meshDone = takeSemaphore();
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &batch.commandBuffer;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &meshDone;
+            if (vkQueueSubmit(mComputeQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to submit mesher");
+            }
+
+            // The next frame waits for the mesher before it culls or draws the new sections.
+            mPendingGraphicsAcquires.push_back({VK_NULL_HANDLE, 0, 0, meshDone,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0});
+            batch.emitting = true;
+        }
+
+        void finishMeshBatch() {
+            MeshBatch& batch = mMeshBatch.value();
+            for (const SectionPos& pos : batch.sections) {
+                mColumnLods[{pos.x, pos.z}].fullResPending--;
+            }
+
+            // Sections that didn't fit stay invisible until their column is meshed again.
+            if (batch.overflowed > 0) {
+                printf("mesher: %zu of %zu sections didn't fit, arena %.1f / %.1f MiB\n", batch.overflowed, batch.sections.size(),
+                    static_cast<double>(mFullResArena.used() * sizeof(MeshVertex)) / (1 << 20),
+                    static_cast<double>(mFullResArena.capacity() * sizeof(MeshVertex)) / (1 << 20));
+            }
+
+            if (mValidateMesher) {
+                validateMeshBatch(batch);
+            }
+            releaseMeshBatch(batch);
+            mMeshBatch.reset();
+        }
+
+        void releaseMeshBatch(MeshBatch& batch) {
+            mIdleSemaphores.insert(mIdleSemaphores.end(), batch.uploadSemaphores.begin(), batch.uploadSemaphores.end());
+            vkDestroyFence(mLogicalDevice, batch.fence, nullptr);
+            vkFreeCommandBuffers(mLogicalDevice, mComputeCommandPool, 1, &batch.commandBuffer);
+            vkDestroyPipeline(mLogicalDevice, batch.retiredPipeline, nullptr);
+        }
+
+        // Copies a range of a device-local buffer back to the host through the compute queue and
+        // waits for it. Only used for validation and debugging.
+        void readBuffer(const GpuBuffer& src, VkDeviceSize offset, VkDeviceSize size, void* out) {
+            GpuBuffer staging;
+            createBuffer(staging, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = mComputeCommandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            VkCommandBuffer commandBuffer;
+            vkAllocateCommandBuffers(mLogicalDevice, &allocInfo, &commandBuffer);
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(commandBuffer, &beginInfo);
+            VkBufferCopy region{offset, 0, size};
+            vkCmdCopyBuffer(commandBuffer, src.buffer, staging.buffer, 1, &region);
+            memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+            vkEndCommandBuffer(commandBuffer);
+
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &commandBuffer;
+            vkQueueSubmit(mComputeQueue, 1, &submitInfo, VK_NULL_HANDLE);
+            vkQueueWaitIdle(mComputeQueue);
+
+            memcpy(out, staging.mapped, size);
+            vkFreeCommandBuffers(mLogicalDevice, mComputeCommandPool, 1, &commandBuffer);
+            destroyBuffer(staging);
+        }
+
+        // MC_VALIDATE_MESHER: compares every section of the batch against the CPU reference
+        // mesher, e.g. when running under a software Vulkan driver.
+        void validateMeshBatch(const MeshBatch& batch) {
+            std::vector<VkDrawIndirectCommand> draws(batch.slots.size());
+            for (size_t i = 0; i < batch.slots.size(); i++) {
+                readBuffer(mSectionDrawCommands, batch.slots[i] * sizeof(VkDrawIndirectCommand), sizeof(VkDrawIndirectCommand), &draws[i]);
+            }
+
+            size_t matching = 0;
+            size_t overflowed = 0;
+            std::vector<MeshVertex> reference;
+            std::vector<MeshVertex> gpu;
+            for (size_t i = 0; i < batch.sections.size(); i++) {
+                SectionNeighbors neighbors{};
+                for (int face = 0; face < FACE_COUNT; face++) {
+                    int32_t entry = batch.neighbors[i * FACE_COUNT + face];
+                    neighbors[face] = entry < 0 ? nullptr : batch.blocks.data() + static_cast<size_t>(entry) * Section::VOLUME;
+                }
+                reference.clear();
+                meshSectionReference(batch.blocks.data() + i * Section::VOLUME, neighbors, reference);
+
+                if (draws[i].instanceCount == 0) {
+                    overflowed++;
+                    continue;
+                }
+                if (draws[i].vertexCount != reference.size()) {
+                    const SectionPos& pos = batch.sections[i];
+                    printf("mesher mismatch at section (%d, %d, %d): gpu %u vertices, cpu %zu\n",
+                        pos.x, pos.y, pos.z, draws[i].vertexCount, reference.size());
+                    continue;
+                }
+                gpu.resize(reference.size());
+                if (!gpu.empty()) {
+                    readBuffer(mTerrainArena, draws[i].firstVertex * sizeof(MeshVertex), gpu.size() * sizeof(MeshVertex), gpu.data());
+                }
+                if (meshesMatch(gpu.data(), reference.data(), reference.size())) {
+                    matching++;
+                } else {
+                    const SectionPos& pos = batch.sections[i];
+                    printf("mesher mismatch at section (%d, %d, %d): vertex data differs\n", pos.x, pos.y, pos.z);
+                }
+            }
+            printf("mesher validation: %zu / %zu sections match the CPU reference (%zu skipped, arena full)\n",
+                matching, batch.sections.size() - overflowed, overflowed);
+        }
+
+        void updateReachableSlots() {
+            const SectionPos start{
+                blockToSection(static_cast<int32_t>(std::floor(mCamera.position.x))),
+                std::clamp(blockToSection(static_cast<int32_t>(std::floor(mCamera.position.y))), 0, Column::SECTIONS - 1),
+                blockToSection(static_cast<int32_t>(std::floor(mCamera.position.z))),
+            };
+            if (mReachableFrom == start && mSlotReachable.size() == mSectionSlots.size()) {
+                return;
+            }
+            mReachableFrom = start;
+            mReachableSections.clear();
+            if (mCaveCulling) {
+                mVisibilityGraph.traverse(mWorld, start, mViewRadius, mReachableSections);
+            }
+            // Outside the loaded world there is nothing to traverse from.
+            if (mReachableSections.empty()) {
+                mSlotReachable.assign(mSectionSlots.size(), 1);
+                return;
+            }
+            const std::unordered_set<SectionPos, SectionPosHash> reached(mReachableSections.begin(), mReachableSections.end());
+            mSlotReachable.resize(mSectionSlots.size());
+            for (size_t slot = 0; slot < mSectionSlots.size(); slot++) {
+                mSlotReachable[slot] = reached.count(mSectionSlots[slot]) != 0 ? 1 : 0;
+            }
+        }
+
+        // Active slots reachable from the camera are candidates, unless software occlusion hides them.
+        uint32_t writeCullCandidates(uint32_t frame) {
+            updateReachableSlots();
+            auto* candidates = static_cast<uint32_t*>(mCullCandidates.mapped) + static_cast<size_t>(frame) * MAX_SECTION_DRAWS;
+            uint32_t active = 0;
+            uint32_t reachable = 0;
+            for (uint32_t slot = 0; slot < mDrawnSectionSlots; slot++) {
+                if (mSlotActive[slot] == 0) {
+                    continue;
+                }
+                active++;
+                if (mSlotReachable[slot] != 0) {
+                    candidates[reachable++] = slot;
+                }
+            }
+            mCaveCulled[frame] = active - reachable;
+            if (!mCpuOcclusion) {
+                return reachable;
+            }
+
+            const uint64_t start = SDL_GetTicksNS();
+            mOcclusionRasterizer.begin(&mViewProj[0][0], mOccluders, MAX_OCCLUDERS);
+            mJobs.parallelFor(OcclusionRasterizer::BANDS, 1, [this](size_t begin, size_t end) {
+                for (size_t band = begin; band < end; band++) {
+                    mOcclusionRasterizer.rasterizeBand(static_cast<int>(band));
+                }
+            });
+            mSlotVisible.resize(reachable);
+            mJobs.parallelFor(reachable, 128, [this, candidates](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    const glm::ivec4& origin = mSlotBounds[candidates[i]].origin;
+                    const float minCorner[3] = {static_cast<float>(origin.x), static_cast<float>(origin.y), static_cast<float>(origin.z)};
+                    const float maxCorner[3] = {minCorner[0] + Section::SIZE, minCorner[1] + Section::SIZE, minCorner[2] + Section::SIZE};
+                    mSlotVisible[i] = mOcclusionRasterizer.isVisible(minCorner, maxCorner) ? 1 : 0;
+                }
+            });
+
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < reachable; i++) {
+                if (mSlotVisible[i] != 0) {
+                    candidates[count++] = candidates[i];
+                }
+            }
+            mCpuOccluded[frame] = reachable - count;
+            mFrameStats.addCpuCulling(static_cast<double>(SDL_GetTicksNS() - start) / 1e6);
+            return count;
+        }
+
+        void drawVisibleSections(VkCommandBuffer commandBuffer) {
+            if (mDrawnSectionSlots == 0) {
+                return;
+            }
+            VkBuffer arenaBuffers[] = {mTerrainArena.buffer};
+            VkDeviceSize offsets[] = {0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, arenaBuffers, offsets);
+            if (!mDrawIndirectFirstInstance) {
+                // The instance index can't carry the slot, so every meshed section is drawn on its
+                // own with its origin pushed, and the culled list goes unused.
+                for (uint32_t slot = 0; slot < mDrawnSectionSlots; slot++) {
+                    if (mSlotActive[slot] == 0) {
+                        continue;
+                    }
+                    const glm::ivec4& origin = mSlotBounds[slot].origin;
+                    pushDrawOrigin(commandBuffer, glm::ivec4(origin.x, origin.y, origin.z, 1));
+                    vkCmdDrawIndirect(commandBuffer, mSectionDrawCommands.buffer, slot * sizeof(VkDrawIndirectCommand), 1, sizeof(VkDrawIndirectCommand));
+                }
+                return;
+            }
+            pushDrawOrigin(commandBuffer, glm::ivec4(0));
+            if (mCmdDrawIndirectCount != nullptr) {
+                mCmdDrawIndirectCount(commandBuffer, mVisibleDraws.buffer, 0, mCullCounters.buffer, offsetof(CullCounters, visible),
+                    mDrawnSectionSlots, sizeof(VkDrawIndirectCommand));
+            } else if (mMultiDrawIndirect) {
+                // Entries past the visible count are zero-vertex draws.
+                vkCmdDrawIndirect(commandBuffer, mVisibleDraws.buffer, 0, mDrawnSectionSlots, sizeof(VkDrawIndirectCommand));
+            } else {
+                for (uint32_t i = 0; i < mDrawnSectionSlots; i++) {
+                    vkCmdDrawIndirect(commandBuffer, mVisibleDraws.buffer, i * sizeof(VkDrawIndirectCommand), 1, sizeof(VkDrawIndirectCommand));
+                }
+            }
+        }
+
+        void recordDepthPrepass(VkCommandBuffer commandBuffer, const VkViewport& viewport, const VkRect2D& scissor) {
+            VkClearValue clearValue{};
+            clearValue.depthStencil = {1.0f, 0};
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = mDepthPrepassRenderPass;
+            renderPassInfo.framebuffer = mDepthTargets.prepassFramebuffer;
+            renderPassInfo.renderArea.offset = {0, 0};
+            renderPassInfo.renderArea.extent = mSwapchainExtent;
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearValue;
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineVariant(PASS_DEPTH_PREPASS, DEBUG_NONE));
+            bindCamera(commandBuffer);
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+            drawVisibleSections(commandBuffer);
+            vkCmdEndRenderPass(commandBuffer);
+        }
+
+        void recordHizBuild(VkCommandBuffer commandBuffer) {
+            DepthTargets& targets = mDepthTargets;
+            const auto levels = static_cast<uint32_t>(targets.pyramidLevelExtents.size());
+            if (!targets.pyramidInitialized) {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = targets.pyramidImage;
+                barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1};
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    0, 0, nullptr, 0, nullptr, 1, &barrier);
+                targets.pyramidInitialized = true;
+            } else {
+                // Last frame's culling pass is still reading the pyramid.
+                memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0);
+            }
+            if (mCpuOcclusion) {
+                // The cull pass never samples the pyramid; it only needs a valid layout.
+                return;
+            }
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mHizPipeline);
+            VkExtent2D src = mSwapchainExtent;
+            for (uint32_t level = 0; level < levels; level++) {
+                const VkExtent2D dst = targets.pyramidLevelExtents[level];
+                HizParams params{{static_cast<int32_t>(src.width), static_cast<int32_t>(src.height)},
+                                 {static_cast<int32_t>(dst.width), static_cast<int32_t>(dst.height)}};
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mHizPipelineLayout, 0, 1, &targets.hizSets[level], 0, nullptr);
+                vkCmdPushConstants(commandBuffer, mHizPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+                vkCmdDispatch(commandBuffer, (dst.width + 7) / 8, (dst.height + 7) / 8, 1);
+                memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+                src = dst;
+            }
+        }
+
+        void recordCulling(VkCommandBuffer commandBuffer, uint32_t candidateCount) {
+            // The prepass has consumed last frame's list; clear it before this frame's survivors go in.
+            memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+            vkCmdFillBuffer(commandBuffer, mCullCounters.buffer, 0, sizeof(CullCounters), 0);
+            if (mCmdDrawIndirectCount == nullptr && mDrawnSectionSlots > 0) {
+                vkCmdFillBuffer(commandBuffer, mVisibleDraws.buffer, 0, sizeof(VkDrawIndirectCommand) * mDrawnSectionSlots, 0);
+            }
+            memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+            if (candidateCount > 0) {
+                const VkExtent2D extent = mSwapchainExtent;
+                CullParams params{};
+                params.viewProj = mCameraPush.viewProj;
+                params.cameraBlock = mCameraPush.cameraBlock;
+                params.cameraFraction = mCameraPush.cameraFraction;
+                params.candidateOffset = mCurrentFrame * MAX_SECTION_DRAWS;
+                params.candidateCount = candidateCount;
+                params.pyramidLevels = static_cast<uint32_t>(mDepthTargets.pyramidLevelExtents.size());
+                params.occlusionTest = mCpuOcclusion ? 0 : 1;
+                params.depthSize[0] = static_cast<int32_t>(extent.width);
+                params.depthSize[1] = static_cast<int32_t>(extent.height);
+
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipeline);
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipelineLayout, 0, 1, &mDepthTargets.cullSet, 0, nullptr);
+                vkCmdPushConstants(commandBuffer, mCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+                vkCmdDispatch(commandBuffer, (candidateCount + 63) / 64, 1, 1);
+            }
+            memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+
+            VkBufferCopy region{0, mCurrentFrame * sizeof(CullCounters), sizeof(CullCounters)};
+            vkCmdCopyBuffer(commandBuffer, mCullCounters.buffer, mCullReadback.buffer, 1, &region);
+            memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+            mCullReadbackPending[mCurrentFrame] = true;
+        }
+
+        void createCommandBuffers() {
+            mCommandBuffers.resize(mProfile.framesInFlight);
+
+            VkCommandBufferAllocateInfo allocInfo{};
             allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
             allocInfo.commandPool = mCommandPool;
             allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-            allocInfo.commandBufferCount = MAX_FRAMES_IN_FLIGHT;
+            allocInfo.commandBufferCount = mProfile.framesInFlight;
 
             if (vkAllocateCommandBuffers(mLogicalDevice, &allocInfo, mCommandBuffers.data()) != VK_SUCCESS) {
                 throw std::runtime_error("Failed to create command buffer");
@@ -792,9 +3570,9 @@ class HelloTriangleApplication {
         }
 
         void createSyncObjects() {
-            mImageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-            mRenderFinishSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-            mFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+            mImageAvailableSemaphores.resize(mProfile.framesInFlight);
+            mRenderFinishSemaphores.resize(mProfile.framesInFlight);
+            mFlightFences.resize(mProfile.framesInFlight);
 
             VkSemaphoreCreateInfo semaphoreInfo{};
             semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -803,7 +3581,7 @@ class HelloTriangleApplication {
             fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
             fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-            for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            for (uint32_t i = 0; i < mProfile.framesInFlight; i++) {
                 if (
                 vkCreateSemaphore(mLogicalDevice, &semaphoreInfo, nullptr, &mImageAvailableSemaphores[i]) != VK_SUCCESS ||
                 vkCreateSemaphore(mLogicalDevice, &semaphoreInfo, nullptr, &mRenderFinishSemaphores[i]) != VK_SUCCESS ||
@@ -814,7 +3592,19 @@ class HelloTriangleApplication {
 
         }
 
-        void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        void destroySyncObjects() {
+            for (size_t i = 0; i < mFlightFences.size(); i++) {
+                vkDestroySemaphore(mLogicalDevice, mImageAvailableSemaphores[i], nullptr);
+                vkDestroySemaphore(mLogicalDevice, mRenderFinishSemaphores[i], nullptr);
+                vkDestroyFence(mLogicalDevice, mFlightFences[i], nullptr);
+            }
+            mImageAvailableSemaphores.clear();
+            mRenderFinishSemaphores.clear();
+            mFlightFences.clear();
+        }
+
+        void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex,
+                                 std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages) {
             VkCommandBufferBeginInfo beginInfo{};
             beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
             beginInfo.flags = 0;
@@ -824,15 +3614,10 @@ class HelloTriangleApplication {
                 throw std::runtime_error("Failed to begin recording command buffer");
             }
 
-            VkClearValue clearValue = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-            VkRenderPassBeginInfo renderPassInfo{};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = mRenderPass;
-            renderPassInfo.framebuffer = mSwapchainFrameBuffers[imageIndex];
-            renderPassInfo.renderArea.offset = {0,0};
-            renderPassInfo.renderArea.extent = mSwapchainExtent;
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearValue;
+            std::vector<VkSemaphore> acquired = takePendingAcquires(mPendingGraphicsAcquires, commandBuffer,
+                mQueueFamilies.graphicsFamily.value(), waitStages);
+            waitSemaphores.insert(waitSemaphores.end(), acquired.begin(), acquired.end());
+            recordLodUploads(commandBuffer);
 
             VkViewport viewport{};
             viewport.x = 0.0f;
@@ -846,17 +3631,30 @@ class HelloTriangleApplication {
             scissor.offset = {0, 0};
             scissor.extent = mSwapchainExtent;
 
-            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipeline);
+            const uint32_t candidateCount = writeCullCandidates(mCurrentFrame);
+            recordDepthPrepass(commandBuffer, viewport, scissor);
+            recordHizBuild(commandBuffer);
+            recordCulling(commandBuffer, candidateCount);
 
-            VkBuffer vertexBuffers[] = {mVertexBuffer};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+            // The depth attachment is loaded from the prepass, so only color is cleared.
+            VkClearValue clearValue = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = mRenderPass;
+            renderPassInfo.framebuffer = mSwapchainFrameBuffers[imageIndex];
+            renderPassInfo.renderArea.offset = {0,0};
+            renderPassInfo.renderArea.extent = mSwapchainExtent;
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearValue;
 
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineVariant(PASS_OPAQUE, mDebugView));
+            bindCamera(commandBuffer);
             vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
             vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-            vkCmdDraw(commandBuffer, mVertices.size(), 1, 0, 0);
+            drawVisibleSections(commandBuffer);
+            drawModels(commandBuffer);
 
             vkCmdEndRenderPass(commandBuffer);
 
@@ -865,30 +3663,145 @@ class HelloTriangleApplication {
             }
         }
 
-        void mainLoop() {
+        bool pollEvents() {
             SDL_Event e;
             bool quit = false;
-            while (!quit) {
-                while (SDL_PollEvent(&e) != 0) {
-                    if (e.type == SDL_EVENT_QUIT) {
-                        quit = true;
-                    }
-                    if (e.type == SDL_EVENT_WINDOW_RESIZED) {
-                        std::cout << "resizing window, w: " << e.window.data1 << " // h: " << e.window.data2 << std::endl;
-                    }
+            while (SDL_PollEvent(&e) != 0) {
+                if (e.type == SDL_EVENT_QUIT) {
+                    quit = true;
+                }
+                if (e.type == SDL_EVENT_WINDOW_RESIZED) {
+                    std::cout << "resizing window, w: " << e.window.data1 << " // h: " << e.window.data2 << std::endl;
+                }
+                if (e.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED) {
+                    mFramebufferResized = true;
                 }
-                drawFrame();
             }
+            mInputSampleNs = SDL_GetTicksNS();
+            return !quit;
+        }
+
+        void mainLoop() {
+            if (mSweepSeconds > 0.0) {
+                runProfileSweep();
+            } else {
+                while (pollEvents()) {
+                    drawFrame();
+                }
+                printProfileSummary(mProfile, mFrameStats.summarize());
+            }
+            if (mSaver != nullptr) {
+                mSaver->wait();
+                mSaver->save(mWorld);
+                mSaver->wait();
+                reportAutosave();
+            }
+            vkDeviceWaitIdle(mLogicalDevice);
+        }
+
+        void applyPresentProfile(const PresentProfile& profile) {
             vkDeviceWaitIdle(mLogicalDevice);
+            mCompletedSubmission = mSubmissionCount;
+            destroySyncObjects();
+            vkFreeCommandBuffers(mLogicalDevice, mCommandPool, static_cast<uint32_t>(mCommandBuffers.size()), mCommandBuffers.data());
+
+            mProfile = profile;
+            mCurrentFrame = 0;
+            recreateSwapchain();
+            flushDeletionQueue(mCompletedSubmission);
+            createCommandBuffers();
+            createSyncObjects();
+
+            mFrameStats.reset();
+            mCullReadbackPending = {};
+            mLastPresentNs = 0;
+        }
+
+        std::vector<PresentProfile> buildSweepProfiles() {
+            SwapChainSupportDetails details = querySwapChainSupport(mPhysicalDevice);
+            uint32_t minImages = details.capabilities.minImageCount;
+            uint32_t maxImages = details.capabilities.maxImageCount > 0 ? details.capabilities.maxImageCount : minImages + 2;
+
+            std::vector<PresentProfile> profiles;
+            for (VkPresentModeKHR mode : {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR}) {
+                if (std::find(details.presentModes.begin(), details.presentModes.end(), mode) == details.presentModes.end()) {
+                    continue;
+                }
+                for (uint32_t frames = 1; frames <= MAX_FRAMES_IN_FLIGHT; frames++) {
+                    for (uint32_t images = minImages; images <= std::min(minImages + 2, maxImages); images++) {
+                        profiles.push_back({mode, frames, images});
+                    }
+                }
+            }
+            return profiles;
+        }
+
+        void runProfileSweep() {
+            std::vector<std::pair<PresentProfile, FrameStats::Summary>> results;
+            for (const PresentProfile& profile : buildSweepProfiles()) {
+                applyPresentProfile(profile);
+                uint64_t start = SDL_GetTicksNS();
+                bool quit = false;
+                while (!quit && static_cast<double>(SDL_GetTicksNS() - start) / 1e9 < mSweepSeconds) {
+                    quit = !pollEvents();
+                    drawFrame();
+                }
+                results.emplace_back(mProfile, mFrameStats.summarize());
+                printProfileSummary(mProfile, results.back().second);
+                if (quit) {
+                    break;
+                }
+            }
+            if (results.empty()) {
+                return;
+            }
+
+            auto lowestLatency = std::min_element(results.begin(), results.end(), [](const auto& a, const auto& b) {
+                return a.second.latencyMsP99 < b.second.latencyMsP99;
+            });
+            auto highestThroughput = std::max_element(results.begin(), results.end(), [](const auto& a, const auto& b) {
+                return a.second.fps < b.second.fps;
+            });
+            std::cout << "lowest latency profile:" << std::endl;
+            printProfileSummary(lowestLatency->first, lowestLatency->second);
+            std::cout << "highest throughput profile:" << std::endl;
+            printProfileSummary(highestThroughput->first, highestThroughput->second);
+        }
+
+        static void printProfileSummary(const PresentProfile& profile, const FrameStats::Summary& summary) {
+            printf("MC_PRESENT_MODE=%-12s MC_FRAMES_IN_FLIGHT=%u MC_SWAPCHAIN_IMAGES=%u | %6.1f fps, frame p50 %6.2f ms p99 %6.2f ms | input->present mean %6.2f ms p50 %6.2f ms p99 %6.2f ms (%zu frames)\n",
+                presentModeName(profile.presentMode), profile.framesInFlight, profile.imageCount,
+                summary.fps, summary.frameMsP50, summary.frameMsP99,
+                summary.latencyMsMean, summary.latencyMsP50, summary.latencyMsP99, summary.frames);
+            printf("    sections per frame: %.1f visible, %.1f occluded, %.1f outside the frustum, %.1f unreachable\n",
+                summary.visibleMean, summary.occludedMean, summary.frustumCulledMean, summary.caveCulledMean);
+            if (summary.cpuCullMsP99 > 0.0) {
+                printf("    software occlusion: p50 %.3f ms p99 %.3f ms\n", summary.cpuCullMsP50, summary.cpuCullMsP99);
+            }
         }
 
         void drawFrame() {
             vkWaitForFences(mLogicalDevice, 1, &mFlightFences[mCurrentFrame], VK_TRUE, UINT64_MAX);
+            mCompletedSubmission = std::max(mCompletedSubmission, mFrameSubmissions[mCurrentFrame]);
+            flushDeletionQueue(mCompletedSubmission);
+            if (mCullReadbackPending[mCurrentFrame]) {
+                const CullCounters& counters = static_cast<const CullCounters*>(mCullReadback.mapped)[mCurrentFrame];
+                mFrameStats.addCulling(counters.visible, counters.occluded + mCpuOccluded[mCurrentFrame], counters.frustumCulled,
+                    mCaveCulled[mCurrentFrame]);
+                mCullReadbackPending[mCurrentFrame] = false;
+            }
+            updateShaderReload();
+
+            if (mFramebufferResized) {
+                mFramebufferResized = false;
+                if (!recreateSwapchain()) {
+                    return;
+                }
+            }
 
             uint32_t imageIndex;
             VkResult result = vkAcquireNextImageKHR(mLogicalDevice, mSwapChain, UINT64_MAX, mImageAvailableSemaphores[mCurrentFrame], VK_NULL_HANDLE, &imageIndex);
-            if (result == VK_ERROR_OUT_OF_DATE_KHR || mFramebufferResized) {
-                mFramebufferResized = false;
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
                 recreateSwapchain();
                 return;
             }
@@ -897,17 +3810,24 @@ class HelloTriangleApplication {
             }
             vkResetFences(mLogicalDevice, 1, &mFlightFences[mCurrentFrame]);
 
+            collectFinishedUploads(false);
+            updateCamera();
+            updateModels();
+            updateStreaming();
+            autosave();
+            updateLod();
+            pumpMesher();
+
+            std::vector<VkSemaphore> waitfor = {mImageAvailableSemaphores[mCurrentFrame]};
+            std::vector<VkPipelineStageFlags> waitStages = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
             vkResetCommandBuffer(mCommandBuffers[mCurrentFrame], 0);
-            recordCommandBuffer(mCommandBuffers[mCurrentFrame], imageIndex);
+            recordCommandBuffer(mCommandBuffers[mCurrentFrame], imageIndex, waitfor, waitStages);
 
             VkSubmitInfo submitInfo {};
             submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-            VkSemaphore waitfor[] = {mImageAvailableSemaphores[mCurrentFrame]};
-            VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-            submitInfo.waitSemaphoreCount = 1;
-            submitInfo.pWaitSemaphores = waitfor;
-            submitInfo.pWaitDstStageMask = waitStages;
+            submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitfor.size());
+            submitInfo.pWaitSemaphores = waitfor.data();
+            submitInfo.pWaitDstStageMask = waitStages.data();
             submitInfo.commandBufferCount = 1;
             submitInfo.pCommandBuffers = &mCommandBuffers[mCurrentFrame];
 
@@ -918,6 +3838,13 @@ class HelloTriangleApplication {
             if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, mFlightFences[mCurrentFrame]) != VK_SUCCESS) {
                 throw std::runtime_error("Failed to submit draw cmd buffer");
             }
+            mFrameSubmissions[mCurrentFrame] = ++mSubmissionCount;
+            if (waitfor.size() > 1) {
+                std::vector<VkSemaphore> transferSemaphores(waitfor.begin() + 1, waitfor.end());
+                deferDestroy([this, transferSemaphores]() {
+                    mIdleSemaphores.insert(mIdleSemaphores.end(), transferSemaphores.begin(), transferSemaphores.end());
+                });
+            }
 
             VkPresentInfoKHR presentInfo{};
             presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -929,29 +3856,79 @@ class HelloTriangleApplication {
             presentInfo.pImageIndices = &imageIndex;
 
             result = vkQueuePresentKHR(mPresentQueue, &presentInfo);
-            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || mFramebufferResized) {
-                mFramebufferResized = false;
-                recreateSwapchain();
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+                mFramebufferResized = true;
             } else if (result != VK_SUCCESS) {
                 throw std::runtime_error("Failed to queue present");
             }
-            mCurrentFrame = ++mCurrentFrame % MAX_FRAMES_IN_FLIGHT;
+
+            uint64_t presentNs = SDL_GetTicksNS();
+            mFrameStats.addLatency(static_cast<double>(presentNs - mInputSampleNs) / 1e6);
+            if (mLastPresentNs != 0) {
+                mFrameStats.addFrame(static_cast<double>(presentNs - mLastPresentNs) / 1e6);
+            }
+            mLastPresentNs = presentNs;
+
+            mCurrentFrame = (mCurrentFrame + 1) % mProfile.framesInFlight;
         }
 
         void cleanup() {
-            for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-                vkDestroySemaphore(mLogicalDevice, mImageAvailableSemaphores[i], nullptr);
-                vkDestroySemaphore(mLogicalDevice, mRenderFinishSemaphores[i], nullptr);
-                vkDestroyFence(mLogicalDevice, mFlightFences[i], nullptr);
+            if (mShaderReload.valid()) {
+                ShaderReload reload = mShaderReload.get();
+                destroyShaderReload(reload);
+            }
+            flushDeletionQueue(mSubmissionCount);
+            if (mMeshBatch.has_value()) {
+                vkWaitForFences(mLogicalDevice, 1, &mMeshBatch->fence, VK_TRUE, UINT64_MAX);
+                releaseMeshBatch(mMeshBatch.value());
+                mMeshBatch.reset();
+            }
+            collectFinishedUploads(true);
+            for (const PendingAcquire& acquire : mPendingGraphicsAcquires) {
+                vkDestroySemaphore(mLogicalDevice, acquire.transferDone, nullptr);
+            }
+            for (const PendingAcquire& acquire : mPendingComputeAcquires) {
+                vkDestroySemaphore(mLogicalDevice, acquire.transferDone, nullptr);
             }
+            for (VkSemaphore semaphore : mIdleSemaphores) {
+                vkDestroySemaphore(mLogicalDevice, semaphore, nullptr);
+            }
+            for (const InFlightUpload& upload : mIdleUploads) {
+                vkDestroyFence(mLogicalDevice, upload.fence, nullptr);
+            }
+            destroySyncObjects();
 
             vkDestroyCommandPool(mLogicalDevice, mCommandPool, nullptr);
-            vkDestroyBuffer(mLogicalDevice, mVertexBuffer, nullptr);
-            vkFreeMemory(mLogicalDevice, mDeviceMemory, nullptr);
+            vkDestroyCommandPool(mLogicalDevice, mComputeCommandPool, nullptr);
+            vkDestroyCommandPool(mLogicalDevice, mTransferCommandPool, nullptr);
+            for (GpuBuffer* buffer : {&mMeshBlocks, &mMeshNeighbors, &mMeshSlots, &mMeshFaceCounts, &mBlockTable,
+                                      &mSectionDrawCommands, &mTerrainArena, &mMeshFirstVertices, &mLodStaging,
+                                      &mSectionBounds, &mCullCandidates, &mVisibleDraws, &mCullCounters, &mCullReadback,
+                                      &mModelVertices, &mModelInstances, &mUploadStaging}) {
+                destroyBuffer(*buffer);
+            }
+            destroyDepthTargets(mDepthTargets);
+            vkDestroyPipeline(mLogicalDevice, mHizPipeline, nullptr);
+            vkDestroyPipeline(mLogicalDevice, mCullPipeline, nullptr);
+            vkDestroyPipelineLayout(mLogicalDevice, mHizPipelineLayout, nullptr);
+            vkDestroyPipelineLayout(mLogicalDevice, mCullPipelineLayout, nullptr);
+            vkDestroyDescriptorSetLayout(mLogicalDevice, mHizSetLayout, nullptr);
+            vkDestroyDescriptorSetLayout(mLogicalDevice, mCullSetLayout, nullptr);
+            vkDestroyDescriptorSetLayout(mLogicalDevice, mTerrainSetLayout, nullptr);
+            vkDestroySampler(mLogicalDevice, mHizSampler, nullptr);
+            vkDestroyPipeline(mLogicalDevice, mMesherPipeline, nullptr);
+            vkDestroyPipelineLayout(mLogicalDevice, mMesherPipelineLayout, nullptr);
+            vkDestroyDescriptorSetLayout(mLogicalDevice, mMesherSetLayout, nullptr);
+            vkDestroyDescriptorPool(mLogicalDevice, mDescriptorPool, nullptr);
             cleanupSwapchain();
-            vkDestroyPipeline(mLogicalDevice, mGraphicsPipeline, nullptr);
+            for (auto& variant : mPipelineVariants) {
+                vkDestroyPipeline(mLogicalDevice, variant.second, nullptr);
+            }
             vkDestroyPipelineLayout(mLogicalDevice, mPipelineLayout, nullptr);
             vkDestroyRenderPass(mLogicalDevice, mRenderPass, nullptr);
+            vkDestroyRenderPass(mLogicalDevice, mDepthPrepassRenderPass, nullptr);
+            savePipelineCache();
+            vkDestroyPipelineCache(mLogicalDevice, mPipelineCache, nullptr);
             vkDestroyDevice(mLogicalDevice, nullptr);
             vkDestroySurfaceKHR(gInstance, mSurface, nullptr);
             vkDestroyInstance(gInstance, nullptr);